@@ -3,274 +3,400 @@
 //
 
 #include "ast.h"
+#include "visitor.h"
 
-#include <type_traits>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
 
-#define INDENT(d) std::string(d, ' ')
-
-#define PREVENT_NULL(name) do {                             \
-    if (this == nullptr) {                                  \
-        return INDENT(d) + name + "()";                     \
-    }                                                       \
-} while (0);
+void AstWriter::Write(const AstNode *root) {
+    Field(root);
+    if (format_ == Format::SEXPR) {
+        out_ << '\n';
+    }
+}
 
-#define TO_STRING(d, name, args...) do {              \
-        PREVENT_NULL(name);                           \
-        return ToStringCommon(d, name, ##args);       \
-    } while (0);
+void AstWriter::Open(const char *name, bool empty) {
+    if (format_ == Format::SEXPR) {
+        out_ << '(' << name;
+        return;
+    }
+    Indent();
+    if (empty) {
+        out_ << name << "()\n";
+    } else {
+        out_ << name << "(\n";
+        ++depth_;
+    }
+}
 
-template <typename F, typename T, typename... Args>
-std::string ArgsToString(F f, T &&first, Args &&...args) {
-    return f(std::move(first)) + ArgsToString(f, std::forward<Args>(args)...);
+void AstWriter::Close(bool empty) {
+    if (format_ == Format::SEXPR) {
+        out_ << ')';
+    } else if (!empty) {
+        --depth_;
+        Indent();
+        out_ << ")\n";
+    }
 }
 
-template <typename F>
-std::string ArgsToString(F f) {
-    return "";
+// between a node's name and each of its fields
+void AstWriter::Separate() {
+    if (format_ == Format::SEXPR) {
+        out_ << ' ';
+    }
 }
 
-template <typename F, typename T>
-std::string ArgsToString(F f, T &&first) {
-    return f(std::move(first));
+// names are printed from the current SymbolPool
+void AstWriter::Field(Symbol symbol) {
+    Indent();
+    out_ << symbol.Name();
+    if (format_ == Format::TEXT) {
+        out_ << '\n';
+    }
 }
 
-template <typename T>
-class ToStringHelper {
-public:
-    static std::string Fn(T &&t, int d) {
-        return "unknown type";
+void AstWriter::Field(std::string_view s) {
+    Indent();
+    if (format_ == Format::TEXT) {
+        out_ << s << '\n';
+        return;
     }
-};
-
-template <typename T>
-class ToStringHelper<std::unique_ptr<T>> {
-public:
-    static std::string Fn(std::unique_ptr<T> &&p, int d) {
-        if (p.get() != nullptr) {
-            return p->ToString(d);
+    static const char *HEX = "0123456789abcdef";
+    out_ << '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out_ << '\\' << c;
+        } else if (c < 0x20 || c >= 0x7f) {
+            out_ << "\\x" << HEX[c >> 4] << HEX[c & 15];
         } else {
-            return "";
-        }
-    }
-};
-
-template <typename T>
-class ToStringHelper<std::vector<T>> {
-public:
-    static std::string Fn(std::vector<T> &&t, int d) {
-        auto result = std::string();
-        auto fn = [d](auto t){
-            return ToStringHelper<decltype(t)>::Fn(std::move(t), d);
-        };
-        for (auto &x : t) {
-            result += ArgsToString(fn, x);
+            out_ << c;
         }
-        return result;
     }
-};
+    out_ << '"';
+}
 
-template <>
-class ToStringHelper<std::string> {
-public:
-    static std::string Fn(std::string &&t, int d) {
-        return INDENT(d) + t + "\n";
+void AstWriter::Field(i64 num) {
+    Indent();
+    out_ << num;
+    if (format_ == Format::TEXT) {
+        out_ << '\n';
     }
-};
+}
 
-template <>
-class ToStringHelper<long long> {
-public:
-    static std::string Fn(long long t, int d) {
-        return INDENT(d) + std::to_string(t) + "\n";
+void AstWriter::Indent() {
+    static const char SPACES[] = "                                ";
+    if (format_ == Format::TEXT) {
+        for (u32 n = depth_; n != 0;) {
+            auto chunk = std::min<u32>(n, sizeof(SPACES) - 1);
+            out_.write(SPACES, chunk);
+            n -= chunk;
+        }
     }
-};
+}
 
-template <>
-class ToStringHelper<int> {
-public:
-    static std::string Fn(int t, int d) {
-        return INDENT(d) + std::to_string(t);
-    }
-};
+std::string AstNode::ToString(u32 depth) {
+    auto out = std::ostringstream();
+    AstWriter(out, AstWriter::Format::TEXT, depth).Write(this);
+    return out.str();
+}
 
-// generic used ToString function for AstNode's derived classes
-template <typename... Args>
-std::string ToStringCommon(u32 d, const std::string &name, Args &&...args) {
-    if constexpr (sizeof...(args) == 0) {
-        return INDENT(d) + name + "()\n";
-    }
-    auto fn = [d](auto x){
-        return ToStringHelper<decltype(x)>::Fn(std::move(x), d+1);
+void Identifier::Write(AstWriter &w) const {
+    w.Node("Id", name_);
+}
+
+std::string_view Operator::Spelling(Op op) {
+    static constexpr std::string_view SPELLINGS[] = {
+        "+", "-", "*", "/", "=", "<>", "<", ">", "<=", ">=", "&", "|",
     };
-    return INDENT(d) + name + "(\n"
-           + ArgsToString(fn, args...)
-           + INDENT(d) + ")\n";
+    static_assert(std::size(SPELLINGS) == static_cast<size_t>(Op::OR) + 1);
+    return SPELLINGS[static_cast<u8>(op)];
 }
 
-std::string Identifier::ToString(u32 d) {
-    TO_STRING(d, "Id", name_)
+void Operator::Write(AstWriter &w) const {
+    w.Node("Op", Spelling(op_));
 }
 
-std::string Operator::ToString(u32 d) {
-    TO_STRING(d, "Op", op_);
+void TypeId::Write(AstWriter &w) const {
+    w.Node("TypeId", name_);
 }
 
-std::string TypeId::ToString(u32 d) {
-    TO_STRING(d, "TypeId", name_);
+void BinaryExpr::Write(AstWriter &w) const {
+    w.Node("BinaryExpr", &op_, lhs_, rhs_);
 }
 
-std::string Expr::ToString(u32 d) {
-    TO_STRING(d, "Expr");
+void NilExpr::Write(AstWriter &w) const {
+    w.Node("NilExpr");
 }
 
-std::string PrimeExpr::ToString(u32 d) {
-    TO_STRING(d, "PrimeExpr");
+void IntExpr::Write(AstWriter &w) const {
+    w.Node("IntExpr", num_);
 }
 
-std::string BinaryExpr::ToString(u32 d) {
-    TO_STRING(d, "BinaryExpr", op_, lhs_, rhs_);
+void UnaryExpr::Write(AstWriter &w) const {
+    w.Node("UnaryExpr", &op_, expr_);
 }
 
-std::string NilExpr::ToString(u32 d) {
-    TO_STRING(d, "NilExpr");
+void StrExpr::Write(AstWriter &w) const {
+    w.Node("StrExpr", str_);
 }
 
-std::string IntExpr::ToString(u32 d) {
-    TO_STRING(d, "IntExpr", num_);
+void ArrayCreate::Write(AstWriter &w) const {
+    w.Node("ArrayCreate", type_id_, len_, init_);
 }
 
-std::string UnaryExpr::ToString(u32 d) {
-    TO_STRING(d, "UnaryExpr", op_, expr_);
+void RecordCreate::Write(AstWriter &w) const {
+    w.Node("RecordCreate", type_id_, types_, vars_);
 }
 
-std::string StrExpr::ToString(u32 d) {
-    TO_STRING(d, "StrExpr", str_);
+void FnCall::Write(AstWriter &w) const {
+    w.Node("FnCall", name_, args_);
 }
 
-std::string ArrayCreate::ToString(u32 d) {
-    TO_STRING(d, "ArrayCreate", type_id_, len_, init_)
+void MethodCall::Write(AstWriter &w) const {
+    w.Node("MethodCall", lvar_, method_, args_);
 }
 
-std::string RecordCreate::ToString(u32 d) {
-    TO_STRING(d, "RecordCreate", type_id_, types_, vars_)
+void Exprs::Write(AstWriter &w) const {
+    w.Node("Exprs", exprs_);
 }
 
-std::string FnCall::ToString(u32 d) {
-    TO_STRING(d, "FnCall", name_, args_);
+void ExprSeq::Write(AstWriter &w) const {
+    w.Node("ExprsExpr", exprs_);
 }
 
-std::string MethodCall::ToString(u32 d) {
-    TO_STRING(d, "MethodCall", lvar_, method_, args_);
+void Assignment::Write(AstWriter &w) const {
+    w.Node("AssignExpr", lval_, expr_);
 }
 
-std::string Exprs::ToString(u32 d) {
-    TO_STRING(d, "Exprs", exprs_);
+void IfStmt::Write(AstWriter &w) const {
+    w.Node("IfExpr", if_, then_, else_);
 }
 
-std::string ExprSeq::ToString(u32 d) {
-    TO_STRING(d, "ExprsExpr", exprs_);
+void WhileStmt::Write(AstWriter &w) const {
+    w.Node("WhileExpr", while_, do_);
 }
 
-std::string Assignment::ToString(u32 d) {
-    TO_STRING(d, "AssignExpr", lval_, expr_);
+void ForStmt::Write(AstWriter &w) const {
+    w.Node("ForExpr", id_, from_, to_, do_);
 }
 
-std::string IfStmt::ToString(u32 d) {
-    TO_STRING(d, "IfExpr", if_, then_, else_);
+void BreakStmt::Write(AstWriter &w) const {
+    w.Node("BreakExpr");
 }
 
-std::string WhileStmt::ToString(u32 d) {
-    TO_STRING(d, "WhileExpr", while_, do_);
+void LetStmt::Write(AstWriter &w) const {
+    w.Node("LetExpr", decs_, exprs_);
 }
 
-std::string ForStmt::ToString(u32 d) {
-    TO_STRING(d, "ForExpr", id_, from_, to_, do_);
+void Decs::Write(AstWriter &w) const {
+    w.Node("Decs", decs_);
 }
 
-std::string BreakStmt::ToString(u32 d) {
-    TO_STRING(d, "BreakExpr");
+void TypeDec::Write(AstWriter &w) const {
+    w.Node("TypeDec", name_, type_);
 }
 
-std::string LetStmt::ToString(u32 d) {
-    TO_STRING(d, "LetExpr", decs_, exprs_);
+void ClassDef::Write(AstWriter &w) const {
+    w.Node("ClassDef", name_, parent_, fields_);
 }
 
-std::string Decs::ToString(u32 d) {
-    TO_STRING(d, "Decs", decs_);
+void VarDec::Write(AstWriter &w) const {
+    w.Node("VarDec", name_, type_, var_);
 }
 
-std::string TypeDec::ToString(u32 d) {
-    TO_STRING(d, "TypeDec", name_, type_);
+void FnDec::Write(AstWriter &w) const {
+    w.Node("FnDec", name_, args_, ret_, body_);
 }
 
-std::string ClassDef::ToString(u32 d) {
-    TO_STRING(d, "ClassDef", name_, parent_, fields_);
+void PrimDec::Write(AstWriter &w) const {
+    w.Node("PrimDec", name_, args_, ret_);
 }
 
-std::string VarDec::ToString(u32 d) {
-    TO_STRING(d, "VarDec", name_, type_, var_);
+void ImportDec::Write(AstWriter &w) const {
+    w.Node("ImportDec", import_);
 }
 
-std::string FnDec::ToString(u32 d) {
-    TO_STRING(d, "FnDec", name_, args_, body_);
+void ClassFields::Write(AstWriter &w) const {
+    w.Node("ClassFields", fields_);
 }
 
-std::string PrimDec::ToString(u32 d) {
-    TO_STRING(d, "PrimDec", name_, args_, ret_);
+void AttrDec::Write(AstWriter &w) const {
+    w.Node("AttrDec", attr_);
 }
 
-std::string ImportDec::ToString(u32 d) {
-    TO_STRING(d, "ImportDec", import_);
+void MethodDec::Write(AstWriter &w) const {
+    w.Node("MethodDec", name_, args_, ret_, body_);
 }
 
-std::string ClassField::ToString(u32 d) {
-    TO_STRING(d, "ClassField");
+void TypeAlias::Write(AstWriter &w) const {
+    w.Node("TypeAlias", alias_);
 }
 
-std::string ClassFields::ToString(u32 d) {
-    TO_STRING(d, "ClassFields", fields_);
+void RecordDef::Write(AstWriter &w) const {
+    w.Node("RecordDef", records_);
 }
 
-std::string AttrDec::ToString(u32 d) {
-    TO_STRING(d, "AttrDec", attr_);
+void ArrayDef::Write(AstWriter &w) const {
+    w.Node("ArrayDef", type_);
 }
 
-std::string MethodDec::ToString(u32 d) {
-    TO_STRING(d, "MethodDec", name_, args_, ret_, body_);
+void ClassTypeDef::Write(AstWriter &w) const {
+    w.Node("ClassTypeDef", parent_, fields_);
 }
 
-std::string Type::ToString(u32 d) {
-    TO_STRING(d, "Type");
+void TypeFields::Write(AstWriter &w) const {
+    w.Node("TypeFields", names_, types_);
 }
 
-std::string TypeAlias::ToString(u32 d) {
-    TO_STRING(d, "TypeAlias", alias_);
+void ObjectNew::Write(AstWriter &w) const {
+    w.Node("ObjectNew", type_);
 }
 
-std::string RecordDef::ToString(u32 d) {
-    TO_STRING(d, "RecordDef", records_);
+void Elem::Write(AstWriter &w) const {
+    w.Node("Elem", name_, idxs_);
 }
 
-std::string ArrayDef::ToString(u32 d) {
-    TO_STRING(d, "ArrayDef", type_);
+void Lvar::Write(AstWriter &w) const {
+    w.Node("Lvar", elems_);
 }
 
-std::string ClassTypeDef::ToString(u32 d) {
-    TO_STRING(d, "ClassTypeDef", parent_, fields_);
+void IntExpr::Accept(Visitor &v) {
+    v.Visit(this);
 }
 
-std::string TypeFields::ToString(u32 d) {
-    TO_STRING(d, "TypeFields", names_, types_);
+void StrExpr::Accept(Visitor &v) {
+    v.Visit(this);
 }
 
-std::string ObjectNew::ToString(u32 d) {
-    TO_STRING(d, "ObjectNew", type_);
+void NilExpr::Accept(Visitor &v) {
+    v.Visit(this);
 }
 
-std::string Elem::ToString(u32 d) {
-    TO_STRING(d, "Elem", name_, idxs_);
+void ExprSeq::Accept(Visitor &v) {
+    v.Visit(this);
 }
 
-std::string Lvar::ToString(u32 d) {
-    TO_STRING(d, "Lvar", elems_);
-}
\ No newline at end of file
+void Assignment::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void UnaryExpr::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void Exprs::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void BinaryExpr::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ArrayCreate::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void RecordCreate::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ObjectNew::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void MethodCall::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void FnCall::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void IfStmt::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void WhileStmt::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ForStmt::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void BreakStmt::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void LetStmt::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void Elem::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void Lvar::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ClassFields::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void TypeFields::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void TypeDec::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void VarDec::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void Decs::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void MethodDec::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void AttrDec::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void FnDec::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void PrimDec::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ImportDec::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void TypeAlias::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void RecordDef::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ArrayDef::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ClassDef::Accept(Visitor &v) {
+    v.Visit(this);
+}
+
+void ClassTypeDef::Accept(Visitor &v) {
+    v.Visit(this);
+}
@@ -2,20 +2,29 @@
 #define TIGER_CC_AST_H
 
 #include "token.h"
+#include "symbol.h"
+#include "../utils/arena.h"
 #include "../utils/stringfy.h"
 
+#include <cassert>
+#include <ostream>
 #include <vector>
 #include <memory>
 #include <string>
 
-#define DEFINE_PTR(x) using x##Ptr = std::unique_ptr<x>;
-#define DEFINE_VEC(x) using x##Vec = std::vector<x>;
+// nodes live in the Arena of their compilation unit and are released
+// with it, a node only points at its children and never owns them
+#define DEFINE_PTR(x) using x##Ptr = x *;
+#define DEFINE_VEC(x) using x##Vec = Span<x>;
 
 /**
  * @brief pre declarations
  */
+class FlatAst;
+class FlatAstBuilder;
+class AstWriter;
+class Visitor;
 class AstNode;
-class Operator;
 
 class Expr;
 class PrimeExpr;
@@ -60,11 +69,12 @@ class Dec;
 class ClassField;
 class ClassFields;
 class Identifier;
-class Type;
+class TypeDef;
 class TypeId;
 class TypeFields;
 class VarDec;
 class Decs;
+class TypeDec;
 class MethodDec;
 class AttrDec;
 class FnDec;
@@ -81,11 +91,10 @@ class ClassTypeDef;
  * @brief type. Although using macro can make these
  * `using and pre-declaration` shorter, I don't like it.
  */
-using IdPtr = std::unique_ptr<Identifier>;
+using IdPtr = Identifier *;
 
 DEFINE_PTR(TypeId);
 DEFINE_PTR(AstNode);
-DEFINE_PTR(Operator);
 DEFINE_PTR(Expr);
 DEFINE_PTR(PrimeExpr);
 DEFINE_PTR(BinaryExpr);
@@ -108,11 +117,12 @@ DEFINE_PTR(Dec);
 DEFINE_PTR(ClassField);
 DEFINE_PTR(ClassFields);
 DEFINE_PTR(Identifier);
-DEFINE_PTR(Type);
+DEFINE_PTR(TypeDef);
 DEFINE_PTR(TypeId);
 DEFINE_PTR(TypeFields);
 DEFINE_PTR(VarDec);
 DEFINE_PTR(Decs);
+DEFINE_PTR(TypeDec);
 DEFINE_PTR(MethodDec);
 DEFINE_PTR(AttrDec);
 DEFINE_PTR(FnDec);
@@ -133,105 +143,221 @@ DEFINE_VEC(TypeIdPtr);
 DEFINE_VEC(ExprPtr);
 DEFINE_VEC(DecPtr);
 DEFINE_VEC(ClassFieldPtr);
-DEFINE_VEC(TypePtr);
-DEFINE_VEC(OperatorPtr);
+DEFINE_VEC(TypeDefPtr);
 DEFINE_VEC(ElemPtr);
 
 
-// mapping operator to it's precedence.
-// comparison operators are not associative,
-// others are left-associative
-static Map<std::string, u64> OP_PREC_MAP = {
-        {"*", 80},
-        {"/", 80},
-        {"+", 40},
-        {"-", 40},
-        {">=", 20},
-        {"<=", 20},
-        {"=", 20},
-        {"<>", 20},
-        {">", 20},
-        {"<", 20},
-        {"&", 10},
-        {"|", 0},
+/**
+ * @brief streams an ast into `out` in one pass without touching it.
+ * TEXT is the indented dump, one node or value per line. SEXPR is one
+ * line per tree for tools: `(Kind field...)`, `_` for a missing field,
+ * `[...]` for a list, strings quoted.
+ */
+class AstWriter {
+public:
+    enum class Format {
+        TEXT,
+        SEXPR,
+    };
+
+    explicit AstWriter(std::ostream &out, Format format = Format::TEXT, u32 depth = 0):
+        out_(out), format_(format), depth_(depth) {}
+
+    void Write(const AstNode *root);
+    // same output as writing the tree `flat` was built from
+    void Write(const FlatAst &flat);
+
+    // one node and its fields, in declaration order
+    template <typename... Fields>
+    void Node(const char *name, const Fields &...fields);
+
+private:
+    void Open(const char *name, bool empty);
+    void Close(bool empty);
+    void Separate();
+    void WriteFlat(const FlatAst &flat, u32 node);
+
+    template <typename T>
+    void Field(const T *node);
+    template <typename T>
+    void Field(const Span<T> &list);
+    void Field(Symbol symbol);
+    void Field(std::string_view s);
+    void Field(i64 num);
+
+    void Indent();
+
+private:
+    std::ostream &out_;
+    Format format_;
+    u32 depth_;
+};
+
+/**
+ * @brief where a node starts in its source, set by the parser once the
+ * node is made. 4 bytes per node.
+ */
+class Located {
+public:
+    SourceLoc Loc() const {
+        return loc_;
+    }
+
+    void SetLoc(SourceLoc loc) {
+        loc_ = loc;
+    }
+
+    void ShiftLoc(i32 delta) {
+        if (loc_.IsValid()) {
+            loc_ = SourceLoc(loc_.Offset() + delta);
+        }
+    }
+
+private:
+    SourceLoc loc_;
 };
 
 /**
  * @brief id
  */
-class Identifier: public Stringfy {
+class Identifier: public Located {
 public:
-    explicit Identifier(std::string name): name_(std::move(name)) {}
+    explicit Identifier(Symbol name): name_(name) {}
     ~Identifier() = default;
-    std::string ToString(u32 depth);
+
+    Symbol GetName() const {
+        return name_;
+    }
+
+    void Write(AstWriter &w) const;
+    u32 Flatten(FlatAstBuilder &flat);
+    void Shift(i32 delta);
 
 private:
-    std::string name_;
+    Symbol name_;
 };
 
-class Operator: public Stringfy {
+// binary and unary operators, in the order of their token tags
+enum class Op: u8 {
+    PLUS,
+    MINUS,
+    STAR,
+    DIV,
+    EQ,
+    NOT_EQAL,
+    LESS,
+    GREATER,
+    LEQ,
+    GEQ,
+    AND,
+    OR,
+};
+
+/**
+ * @brief an operator is a one byte value kept inside its expression,
+ * it is not a node of its own.
+ */
+class Operator {
 public:
-    Operator(std::string op):
-        op_(std::move(op)),
-        precedence_(OP_PREC_MAP[op_]) {}
-    
-    ~Operator() = default;
-    std::string ToString(u32 depth);
+    explicit Operator(Op op): op_(op) {}
+
+    // `tag` must be an operator token
+    static Operator FromTag(Token::Tag tag) {
+        assert(tag >= Token::Tag::PLUS && tag <= Token::Tag::OR);
+        return Operator(static_cast<Op>(static_cast<u8>(tag) - static_cast<u8>(Token::Tag::PLUS)));
+    }
 
-    u64 GetPrecedence() {
-        return precedence_;
+    Op GetOp() const {
+        return op_;
     }
 
+    static std::string_view Spelling(Op op);
+
+    void Write(AstWriter &w) const;
+    u32 Flatten(FlatAstBuilder &flat);
+
 private:
-    std::string op_;
-    u64 precedence_;
+    Op op_;
 };
 
-class TypeId: public Stringfy {
+class TypeId: public Located {
 public:
-    explicit TypeId(std::string name): name_(std::move(name)) {}
+    explicit TypeId(Symbol name): name_(name) {}
     ~TypeId() = default;
-    std::string ToString(u32 depth);
+
+    Symbol GetName() const {
+        return name_;
+    }
+
+    void Write(AstWriter &w) const;
+    u32 Flatten(FlatAstBuilder &flat);
+    void Shift(i32 delta);
 
 private:
-    std::string name_;
+    Symbol name_;
 };
 
-class AstNode: public Stringfy {
+class AstNode: public Stringfy, public Located {
 public:
     AstNode() = default;
     virtual ~AstNode() = default;
-    virtual std::string ToString(u32 depth) {
-        return "AstNode()";
-    }
+
+    // the indented text dump, `depth` levels deep
+    std::string ToString(u32 depth) final;
+
+    // dump this subtree through `w`, leaving the tree as it is
+    virtual void Write(AstWriter &w) const = 0;
+
+    // append this subtree to `flat` in preorder, return its index
+    virtual u32 Flatten(FlatAstBuilder &flat) = 0;
+
+    // move the loc of every node in this subtree `delta` bytes, after an
+    // edit in front of it (see IncrementalParser)
+    virtual void Shift(i32 delta) = 0;
+
+    // double dispatch to the `Visit` of `v` for the node's class
+    virtual void Accept(Visitor &v) = 0;
 };
 
 class Expr: public AstNode {
 public:
     Expr() = default;
     virtual ~Expr() = default;
-    virtual std::string ToString(u32 depth) override;
 };
 
 class PrimeExpr: public Expr {
 public:
     PrimeExpr() = default;
     virtual ~PrimeExpr() override = default;
-    virtual std::string ToString(u32 depth) override;
 };
 
 class BinaryExpr: public Expr {
 public:
-    BinaryExpr(OperatorPtr op, ExprPtr lhs, ExprPtr rhs):
-        op_(std::move(op)),
+    BinaryExpr(Operator op, ExprPtr lhs, ExprPtr rhs):
+        op_(op),
         lhs_(std::move(lhs)),
         rhs_(std::move(rhs)) {}
     ~BinaryExpr() = default;
 
-    std::string ToString(u32 depth) final;
+    Operator GetOp() const {
+        return op_;
+    }
+
+    ExprPtr GetLhs() const {
+        return lhs_;
+    }
+
+    ExprPtr GetRhs() const {
+        return rhs_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
-    OperatorPtr op_;
+    Operator op_;
     ExprPtr lhs_;
     ExprPtr rhs_;
 };
@@ -241,7 +367,10 @@ class NilExpr: public PrimeExpr {
 public:
     NilExpr() = default;
     ~NilExpr() final = default;
-    std::string ToString(u32 depth) final;
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 };
 
 // integer expression
@@ -249,7 +378,15 @@ class IntExpr: public PrimeExpr {
 public:
     IntExpr(i64 num): num_(num) {}
     ~IntExpr() final = default;
-    std::string ToString(u32 depth) final;
+
+    i64 GetNum() const {
+        return num_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     i64 num_;
@@ -258,25 +395,45 @@ private:
 // unary expression
 class UnaryExpr: public PrimeExpr {
 public:
-    UnaryExpr(OperatorPtr op, ExprPtr expr):
-        op_(std::move(op)), expr_(std::move(expr)) {}
+    UnaryExpr(Operator op, ExprPtr expr):
+        op_(op), expr_(std::move(expr)) {}
     ~UnaryExpr() final = default;
-    std::string ToString(u32 depth) final;
+
+    Operator GetOp() const {
+        return op_;
+    }
+
+    ExprPtr GetExpr() const {
+        return expr_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
-    OperatorPtr op_;
+    Operator op_;
     ExprPtr expr_;
 };
 
 // string expression
 class StrExpr: public PrimeExpr {
 public:
-    StrExpr(std::string s): str_(std::move(s)) {}
+    StrExpr(std::string_view s): str_(s) {}
     ~StrExpr() final = default;
-    std::string ToString(u32 depth) final;
+
+    std::string_view GetStr() const {
+        return str_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
-    std::string str_;
+    std::string_view str_;
 };
 
 // array creation
@@ -288,7 +445,23 @@ public:
         init_(std::move(init)) {}
 
     ~ArrayCreate() final = default;
-    std::string ToString(u32 depth) final;
+
+    TypeIdPtr GetTypeId() const {
+        return type_id_;
+    }
+
+    ExprPtr GetLen() const {
+        return len_;
+    }
+
+    ExprPtr GetInit() const {
+        return init_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     TypeIdPtr type_id_;
@@ -306,7 +479,23 @@ public:
     }
 
     ~RecordCreate() final = default;
-    std::string ToString(u32 depth) final;
+
+    TypeIdPtr GetTypeId() const {
+        return type_id_;
+    }
+
+    const TypeIdPtrVec &GetNames() const {
+        return types_;
+    }
+
+    const ExprPtrVec &GetVars() const {
+        return vars_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     TypeIdPtr type_id_;
@@ -318,7 +507,19 @@ class Elem: public AstNode {
 public:
     Elem(IdPtr name, ExprPtrVec idxs):
         name_(std::move(name)), idxs_(std::move(idxs)) {}
-    std::string ToString(u32 depth);
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    const ExprPtrVec &GetIdxs() const {
+        return idxs_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 private:
     IdPtr name_;
     ExprPtrVec idxs_;
@@ -327,7 +528,14 @@ private:
 class Lvar: public PrimeExpr {
 public:
     Lvar(ElemPtrVec elems): elems_(std::move(elems)) {}
-    std::string ToString(u32 depth);
+    const ElemPtrVec &GetElems() const {
+        return elems_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     ElemPtrVec elems_;
@@ -336,7 +544,15 @@ private:
 class ObjectNew: public PrimeExpr {
 public:
     explicit ObjectNew(TypeIdPtr type): type_(std::move(type)) {}
-    std::string ToString(u32 depth) final;
+
+    TypeIdPtr GetTypeId() const {
+        return type_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     TypeIdPtr type_;
@@ -349,7 +565,19 @@ public:
         args_(std::move(args)) {}
 
     ~FnCall() final = default;
-    std::string ToString(u32 depth) final;
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    const ExprPtrVec &GetArgs() const {
+        return args_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     IdPtr name_;
@@ -364,7 +592,23 @@ public:
         args_(std::move(args)) {}
 
     ~MethodCall() final = default;
-    std::string ToString(u32 depth) final;
+
+    LvarPtr GetLvar() const {
+        return lvar_;
+    }
+
+    IdPtr GetMethod() const {
+        return method_;
+    }
+
+    const ExprPtrVec &GetArgs() const {
+        return args_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     LvarPtr lvar_;
@@ -372,13 +616,20 @@ private:
     ExprPtrVec args_;
 };
 
-class Exprs {
+class Exprs: public Located {
 public:
     Exprs(ExprPtrVec exprs):
         exprs_(std::move(exprs)) {}
 
     ~Exprs() = default;
-    std::string ToString(u32 depth);
+    const ExprPtrVec &GetExprs() const {
+        return exprs_;
+    }
+
+    void Write(AstWriter &w) const;
+    u32 Flatten(FlatAstBuilder &flat);
+    void Shift(i32 delta);
+    void Accept(Visitor &v);
 
 private:
     ExprPtrVec exprs_;
@@ -387,7 +638,15 @@ private:
 class ExprSeq: public PrimeExpr {
 public:
     explicit ExprSeq(ExprsPtr exprs): exprs_(std::move(exprs)) {}
-    std::string ToString(u32 depth) final;
+
+    ExprsPtr GetExprs() const {
+        return exprs_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     ExprsPtr exprs_;
@@ -399,7 +658,18 @@ public:
         lval_(std::move(lvar)),
         expr_(std::move(expr)) {}
 
-    std::string ToString(u32 depth) final;
+    LvarPtr GetLvar() const {
+        return lval_;
+    }
+
+    ExprPtr GetExpr() const {
+        return expr_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     LvarPtr lval_;
@@ -414,7 +684,23 @@ public:
         else_(std::move(_else)) {}
 
     ~IfStmt() final = default;
-    std::string ToString(u32 depth) final;
+
+    ExprPtr GetIf() const {
+        return if_;
+    }
+
+    ExprPtr GetThen() const {
+        return then_;
+    }
+
+    ExprPtr GetElse() const {
+        return else_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     ExprPtr if_;
@@ -429,7 +715,19 @@ public:
         do_(std::move(_do)) {}
 
     ~WhileStmt() final = default;
-    std::string ToString(u32 depth) final;
+
+    ExprPtr GetWhile() const {
+        return while_;
+    }
+
+    ExprPtr GetDo() const {
+        return do_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     ExprPtr while_;
@@ -445,7 +743,27 @@ public:
         do_(std::move(_do)) {}
 
     ~ForStmt() final = default;
-    std::string ToString(u32 depth) final;
+
+    IdPtr GetId() const {
+        return id_;
+    }
+
+    ExprPtr GetFrom() const {
+        return from_;
+    }
+
+    ExprPtr GetTo() const {
+        return to_;
+    }
+
+    ExprPtr GetDo() const {
+        return do_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     IdPtr id_;
@@ -458,7 +776,10 @@ class BreakStmt: public PrimeExpr {
 public:
     BreakStmt() = default;
     ~BreakStmt() final = default;
-    std::string ToString(u32 depth) final;
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 };
 
 class LetStmt: public PrimeExpr {
@@ -468,7 +789,19 @@ public:
         exprs_(std::move(exprs)) {}
 
     ~LetStmt() final = default;
-    std::string ToString(u32 depth) final;
+
+    DecsPtr GetDecs() const {
+        return decs_;
+    }
+
+    ExprsPtr GetExprs() const {
+        return exprs_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     DecsPtr decs_;
@@ -480,16 +813,21 @@ class Dec: public AstNode {
 public:
     Dec() = default;
     virtual ~Dec() override = default;
-    virtual std::string ToString(u32 depth) {
-        return "Dec()";
-    }
 };
 
 class Decs: public AstNode {
 public:
     Decs(DecPtrVec decs): decs_(std::move(decs)) {}
     ~Decs() final = default;
-    std::string ToString(u32 depth) final;
+
+    const DecPtrVec &GetDecs() const {
+        return decs_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     DecPtrVec decs_;
@@ -498,16 +836,28 @@ private:
 // type declaration
 class TypeDec: public Dec {
 public:
-    TypeDec(IdPtr name, TypePtr type):
+    TypeDec(IdPtr name, TypeDefPtr type):
         name_(std::move(name)),
         type_(std::move(type)) {}
 
     ~TypeDec() final = default;
-    std::string ToString(u32 depth) final;
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    TypeDefPtr GetType() const {
+        return type_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     IdPtr name_;
-    TypePtr type_;
+    TypeDefPtr type_;
 };
 
 // class definition(alternative form)
@@ -521,7 +871,23 @@ public:
         fields_(std::move(fields)) {}
 
     ~ClassDef() = default;
-    std::string ToString(u32 depth);
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    TypeIdPtr GetParent() const {
+        return parent_;
+    }
+
+    ClassFieldsPtr GetFields() const {
+        return fields_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     IdPtr name_;
@@ -538,7 +904,23 @@ public:
         var_(std::move(var)) {}
         
      ~VarDec() = default;
-    std::string ToString(u32 depth);
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    TypeIdPtr GetTypeId() const {
+        return type_;
+    }
+
+    ExprPtr GetVar() const {
+        return var_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     IdPtr name_;
@@ -556,7 +938,27 @@ public:
         body_(std::move(body)) {}
 
     ~FnDec() = default;
-    std::string ToString(u32 depth);
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    TypeFieldsPtr GetArgs() const {
+        return args_;
+    }
+
+    TypeIdPtr GetRet() const {
+        return ret_;
+    }
+
+    ExprPtr GetBody() const {
+        return body_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     IdPtr name_;
@@ -574,7 +976,23 @@ public:
         ret_(std::move(ret)) {}
 
     ~PrimDec() = default;
-    std::string ToString(u32 depth);
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    TypeFieldsPtr GetArgs() const {
+        return args_;
+    }
+
+    TypeIdPtr GetRet() const {
+        return ret_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     IdPtr name_;
@@ -585,21 +1003,28 @@ private:
 // import declaration
 class ImportDec: public Dec {
 public:
-    ImportDec(std::string import_):
-        import_(std::move(import_)) {}
+    ImportDec(std::string_view import_):
+        import_(import_) {}
 
     ~ImportDec() = default;
-    std::string ToString(u32 depth);
+
+    std::string_view GetImport() const {
+        return import_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
-    std::string import_;
+    std::string_view import_;
 };
 
 class ClassField: public AstNode {
 public:
     ClassField() = default;
     virtual ~ClassField() = default;
-    virtual std::string ToString(u32 depth);
 };
 
 class ClassFields: public AstNode {
@@ -607,7 +1032,14 @@ public:
     explicit ClassFields(ClassFieldPtrVec fields):
         fields_(std::move(fields)) {}
     ~ClassFields() = default;
-    std::string ToString(u32 depth);
+    const ClassFieldPtrVec &GetFields() const {
+        return fields_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     ClassFieldPtrVec fields_;
@@ -620,7 +1052,15 @@ public:
         attr_(std::move(attr)) {}
         
     ~AttrDec() = default;
-    std::string ToString(u32 depth);
+
+    VarDecPtr GetAttr() const {
+        return attr_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     VarDecPtr attr_;
@@ -636,7 +1076,27 @@ public:
         body_(std::move(body)) {}
         
     ~MethodDec() = default;
-    std::string ToString(u32 depth);
+
+    IdPtr GetName() const {
+        return name_;
+    }
+
+    TypeFieldsPtr GetArgs() const {
+        return args_;
+    }
+
+    TypeIdPtr GetRet() const {
+        return ret_;
+    }
+
+    ExprPtr GetBody() const {
+        return body_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     IdPtr name_;
@@ -645,55 +1105,90 @@ private:
     ExprPtr body_;
 };
 
-class Type: public AstNode {
+class TypeDef: public AstNode {
 public:
-    Type() = default;
-    virtual ~Type() = default;
-    virtual std::string ToString(u32 depth);
+    TypeDef() = default;
+    virtual ~TypeDef() = default;
 };
 
-class TypeAlias: public Type {
+class TypeAlias: public TypeDef {
 public:
     TypeAlias(TypeIdPtr alias): 
         alias_(std::move(alias)) {}
     ~TypeAlias() = default;
-    std::string ToString(u32 depth);
+
+    TypeIdPtr GetAlias() const {
+        return alias_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     TypeIdPtr alias_;
 };
 
-class RecordDef: public Type {
+class RecordDef: public TypeDef {
 public:
     RecordDef(TypeFieldsPtr records):
         records_(std::move(records)) {}
     ~RecordDef() = default;
-    std::string ToString(u32 depth);
+
+    TypeFieldsPtr GetRecords() const {
+        return records_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     TypeFieldsPtr records_;
 };
 
-class ArrayDef: public Type {
+class ArrayDef: public TypeDef {
 public:
     ArrayDef(TypeIdPtr type):
         type_(std::move(type)) {}
     ~ArrayDef() = default;
-    std::string ToString(u32 depth);
+
+    TypeIdPtr GetTypeId() const {
+        return type_;
+    }
+
+    void Write(AstWriter &w) const override;
+    u32 Flatten(FlatAstBuilder &flat) override;
+    void Shift(i32 delta) override;
+    void Accept(Visitor &v) override;
 
 private:
     TypeIdPtr type_;
 };
 
 // class definition(canonical form)
-class ClassTypeDef: public Type {
+class ClassTypeDef: public TypeDef {
 public:
     ClassTypeDef(TypeIdPtr parent, ClassFieldsPtr fields):
         parent_(std::move(parent)),
         fields_(std::move(fields)) {}
         
     ~ClassTypeDef() = default;
-    std::string ToString(u32 depth) final;
+
+    TypeIdPtr GetParent() const {
+        return parent_;
+    }
+
+    ClassFieldsPtr GetFields() const {
+        return fields_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     TypeIdPtr parent_;
@@ -709,7 +1204,18 @@ public:
         assert(names_.size() == types_.size());
     }
     ~TypeFields() final = default;
-    std::string ToString(u32 depth) final;
+    const IdPtrVec &GetNames() const {
+        return names_;
+    }
+
+    const TypeIdPtrVec &GetTypes() const {
+        return types_;
+    }
+
+    void Write(AstWriter &w) const final;
+    u32 Flatten(FlatAstBuilder &flat) final;
+    void Shift(i32 delta) final;
+    void Accept(Visitor &v) final;
 
 private:
     IdPtrVec names_;
@@ -717,4 +1223,39 @@ private:
 };
 
 
+template <typename... Fields>
+void AstWriter::Node(const char *name, const Fields &...fields) {
+    Open(name, sizeof...(fields) == 0);
+    ((Separate(), Field(fields)), ...);
+    Close(sizeof...(fields) == 0);
+}
+
+template <typename T>
+void AstWriter::Field(const T *node) {
+    if (node != nullptr) {
+        node->Write(*this);
+    } else if (format_ == Format::SEXPR) {
+        out_ << '_';
+    }
+}
+
+// the text dump writes list elements at the depth of the list itself
+template <typename T>
+void AstWriter::Field(const Span<T> &list) {
+    if (format_ == Format::TEXT) {
+        for (auto &x : list) {
+            Field(x);
+        }
+        return;
+    }
+    out_ << '[';
+    for (u32 i = 0; i < list.size(); ++i) {
+        if (i != 0) {
+            out_ << ' ';
+        }
+        Field(list[i]);
+    }
+    out_ << ']';
+}
+
 #endif // TIGER_CC_AST_H
\ No newline at end of file
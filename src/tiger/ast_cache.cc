@@ -0,0 +1,99 @@
+#include "ast_cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::string AstCache::DefaultDir() {
+    if (auto dir = getenv("TIGER_CACHE_DIR"); dir != nullptr && *dir != '\0') {
+        return dir;
+    }
+    if (auto dir = getenv("XDG_CACHE_HOME"); dir != nullptr && *dir != '\0') {
+        return std::string(dir) + "/tiger";
+    }
+    if (auto home = getenv("HOME"); home != nullptr && *home != '\0') {
+        return std::string(home) + "/.cache/tiger";
+    }
+    return "/tmp/tiger-cache";
+}
+
+// 64 bit FNV-1a
+static u64 Hash(u64 hash, std::string_view bytes) {
+    for (unsigned char c : bytes) {
+        hash = (hash ^ c) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+u64 AstCache::Key(std::string_view source) {
+    auto version = std::string(TIGER_CC_VERSION) + "/" + std::to_string(FORMAT_VERSION)
+            + "/" + std::to_string(source.size()) + "/";
+    return Hash(Hash(0xcbf29ce484222325ull, version), source);
+}
+
+std::string AstCache::Path(u64 key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.ast", static_cast<unsigned long long>(key));
+    return dir_ + name;
+}
+
+std::optional<FlatAst> AstCache::Load(std::string_view source, SymbolPool &symbols) const {
+    auto key = Key(source);
+    auto image = SourceBuffer::TryFromFile(Path(key));
+    if (!image) {
+        return std::nullopt;
+    }
+    return FlatAst::Load(std::move(*image), key, symbols);
+}
+
+// mkdir -p
+static bool MakeDirs(const std::string &dir) {
+    for (size_t i = 1; i <= dir.size(); ++i) {
+        if (i == dir.size() || dir[i] == '/') {
+            auto prefix = dir.substr(0, i);
+            if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool AstCache::Store(std::string_view source, const FlatAst &flat) const {
+    if (!MakeDirs(dir_)) {
+        return false;
+    }
+    auto key = Key(source);
+    auto image = flat.Serialize(key);
+    auto path = Path(key);
+    // unique per process and thread, a batch may store the same file twice
+    auto thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    auto tmp = path + "." + std::to_string(getpid()) + "." + std::to_string(thread) + ".tmp";
+
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < image.size()) {
+        auto n = write(fd, image.data() + done, image.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    close(fd);
+    if (done != image.size() || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
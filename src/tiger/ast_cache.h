@@ -0,0 +1,41 @@
+#ifndef TIGER_CC_AST_CACHE_H
+#define TIGER_CC_AST_CACHE_H
+
+#include "flat_ast.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief on-disk cache of parsed modules. An entry is the FlatAst image
+ * of one source, named after a hash of the compiler version, the image
+ * format and the source bytes, so a change to any of them is a miss.
+ * A hit is one mmap plus a check of the image, nothing is re-lexed.
+ *
+ * Entries are written to a temporary file and renamed into place, so
+ * concurrent compilers never see half an entry.
+ */
+class AstCache {
+public:
+    // bump whenever FlatAst's layout or the meaning of a node changes
+    static constexpr u32 FORMAT_VERSION = 3;
+
+    explicit AstCache(std::string dir): dir_(std::move(dir)) {}
+
+    // $TIGER_CACHE_DIR, else $XDG_CACHE_HOME/tiger, else ~/.cache/tiger
+    static std::string DefaultDir();
+
+    static u64 Key(std::string_view source);
+
+    std::optional<FlatAst> Load(std::string_view source, SymbolPool &symbols) const;
+    bool Store(std::string_view source, const FlatAst &flat) const;
+
+private:
+    std::string Path(u64 key) const;
+
+private:
+    std::string dir_;
+};
+
+#endif // TIGER_CC_AST_CACHE_H
@@ -26,10 +26,9 @@ public:
     void Visit(LetStmtPtr node);
     void Visit(ElemPtr node);
     void Visit(LvarPtr node);
-    void Visit(ClassFieldPtr node);
     void Visit(ClassFieldsPtr node);
     void Visit(TypeFieldsPtr node);
-    void Visit(DecPtr node);
+    void Visit(TypeDecPtr node);
     void Visit(VarDecPtr node);
     void Visit(DecsPtr node);
     void Visit(MethodDecPtr node);
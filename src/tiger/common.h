@@ -15,4 +15,6 @@ using i64 = int64_t;
 using f32 = float;
 using f64 = double;
 
+#define TIGER_CC_VERSION "0.1.0"
+
 #endif // TIGER_CC_COMMON_H
\ No newline at end of file
@@ -0,0 +1,405 @@
+#include "constant_folder.h"
+#include "flat_ast.h"
+
+#include <limits>
+#include <vector>
+
+// the value of `expr` if it is an int literal in 32 bits
+static bool IntValue(ExprPtr expr, i32 &value) {
+    auto literal = dynamic_cast<IntExprPtr>(expr);
+    if (literal == nullptr || literal->GetNum() < std::numeric_limits<i32>::min()
+        || literal->GetNum() > std::numeric_limits<i32>::max()) {
+        return false;
+    }
+    value = static_cast<i32>(literal->GetNum());
+    return true;
+}
+
+// `op` over two ints the way a 32 bit machine does it, false for what
+// has to fail at run time
+static bool Evaluate(Op op, i32 lhs, i32 rhs, i32 &value) {
+    auto l = static_cast<u32>(lhs);
+    auto r = static_cast<u32>(rhs);
+    switch (op) {
+        case Op::PLUS:
+            value = static_cast<i32>(l + r);
+            return true;
+        case Op::MINUS:
+            value = static_cast<i32>(l - r);
+            return true;
+        case Op::STAR:
+            value = static_cast<i32>(l * r);
+            return true;
+        case Op::DIV:
+            if (rhs == 0 || (lhs == std::numeric_limits<i32>::min() && rhs == -1)) {
+                return false;
+            }
+            value = lhs / rhs;
+            return true;
+        case Op::EQ:
+            value = lhs == rhs;
+            return true;
+        case Op::NOT_EQAL:
+            value = lhs != rhs;
+            return true;
+        case Op::LESS:
+            value = lhs < rhs;
+            return true;
+        case Op::GREATER:
+            value = lhs > rhs;
+            return true;
+        case Op::LEQ:
+            value = lhs <= rhs;
+            return true;
+        case Op::GEQ:
+            value = lhs >= rhs;
+            return true;
+        case Op::AND:
+            value = lhs != 0 ? rhs : 0;
+            return true;
+        case Op::OR:
+            value = lhs != 0 ? 1 : rhs;
+            return true;
+    }
+    return false;
+}
+
+// a comparison of two strings, false for any other operator
+static bool Compare(Op op, std::string_view lhs, std::string_view rhs, i32 &value) {
+    auto order = lhs.compare(rhs);
+    switch (op) {
+        case Op::EQ:
+            value = order == 0;
+            return true;
+        case Op::NOT_EQAL:
+            value = order != 0;
+            return true;
+        case Op::LESS:
+            value = order < 0;
+            return true;
+        case Op::GREATER:
+            value = order > 0;
+            return true;
+        case Op::LEQ:
+            value = order <= 0;
+            return true;
+        case Op::GEQ:
+            value = order >= 0;
+            return true;
+        default:
+            return false;
+    }
+}
+
+AstNodePtr ConstantFolder::Fold(AstNodePtr root) {
+    return FoldNode(root);
+}
+
+template <typename T>
+T *ConstantFolder::FoldNode(T *node) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    node->Accept(*this);
+    return static_cast<T *>(result_);
+}
+
+ExprPtr ConstantFolder::FoldExpr(ExprPtr expr) {
+    return FoldNode(expr);
+}
+
+ExprsPtr ConstantFolder::FoldExprs(ExprsPtr exprs) {
+    exprs->Accept(*this);
+    return exprs_;
+}
+
+template <typename T>
+Span<T> ConstantFolder::FoldAll(const Span<T> &list) {
+    auto folded = std::vector<T>();
+    auto changed = false;
+    for (u32 i = 0; i < list.size(); ++i) {
+        auto node = FoldNode(list[i]);
+        if (node != list[i] && !changed) {
+            changed = true;
+            folded.reserve(list.size());
+            folded.insert(folded.end(), list.begin(), list.begin() + i);
+        }
+        if (changed) {
+            folded.push_back(node);
+        }
+    }
+    return changed ? nodes_.Copy(folded) : list;
+}
+
+ExprPtr ConstantFolder::Unit(SourceLoc loc) {
+    return Make<ExprSeq>(loc, Make<Exprs>(loc, ExprPtrVec()));
+}
+
+u64 ConstantFolder::Count(AstNodePtr node) {
+    return FlatAst::Build(node).Size();
+}
+
+void ConstantFolder::Visit(IntExprPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(StrExprPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(NilExprPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(BreakStmtPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(ObjectNewPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(ExprsPtr node) {
+    auto exprs = FoldAll(node->GetExprs());
+    exprs_ = exprs.begin() == node->GetExprs().begin() ? node : Make<Exprs>(node->Loc(), exprs);
+}
+
+// a literal in parentheses is the literal, so that it folds further
+void ConstantFolder::Visit(ExprSeqPtr node) {
+    auto exprs = FoldExprs(node->GetExprs());
+    auto &list = exprs->GetExprs();
+    if (list.size() == 1 && (dynamic_cast<IntExprPtr>(list[0]) != nullptr
+                             || dynamic_cast<StrExprPtr>(list[0]) != nullptr)) {
+        // the sequence, its Exprs and their list
+        removed_ += 3;
+        result_ = list[0];
+        return;
+    }
+    result_ = exprs == node->GetExprs() ? node : Make<ExprSeq>(node->Loc(), exprs);
+}
+
+void ConstantFolder::Visit(AssignmentPtr node) {
+    auto lvar = FoldNode(node->GetLvar());
+    auto expr = FoldExpr(node->GetExpr());
+    result_ = lvar == node->GetLvar() && expr == node->GetExpr()
+              ? node : Make<Assignment>(node->Loc(), lvar, expr);
+}
+
+void ConstantFolder::Visit(UnaryExprPtr node) {
+    auto expr = FoldExpr(node->GetExpr());
+    auto value = i32(0);
+    // the negation of the smallest int wraps to itself
+    if (IntValue(expr, value)) {
+        removed_ += 2;
+        result_ = Make<IntExpr>(node->Loc(), static_cast<i32>(0u - static_cast<u32>(value)));
+        return;
+    }
+    if (auto inner = dynamic_cast<UnaryExprPtr>(expr); inner != nullptr) {
+        removed_ += 4;
+        result_ = inner->GetExpr();
+        return;
+    }
+    result_ = expr == node->GetExpr() ? node : Make<UnaryExpr>(node->Loc(), node->GetOp(), expr);
+}
+
+void ConstantFolder::Visit(BinaryExprPtr node) {
+    auto op = node->GetOp().GetOp();
+    auto lhs = FoldExpr(node->GetLhs());
+    auto rhs = FoldExpr(node->GetRhs());
+    auto l = i32(0);
+    auto r = i32(0);
+    auto value = i32(0);
+    auto l_int = IntValue(lhs, l);
+    auto r_int = IntValue(rhs, r);
+    if (l_int && r_int && Evaluate(op, l, r, value)) {
+        removed_ += 3;
+        result_ = Make<IntExpr>(node->Loc(), value);
+        return;
+    }
+    auto l_str = dynamic_cast<StrExprPtr>(lhs);
+    auto r_str = dynamic_cast<StrExprPtr>(rhs);
+    if (l_str != nullptr && r_str != nullptr && Compare(op, l_str->GetStr(), r_str->GetStr(), value)) {
+        removed_ += 3;
+        result_ = Make<IntExpr>(node->Loc(), value);
+        return;
+    }
+
+    // what the operator leaves when one side is a literal
+    auto kept = ExprPtr(nullptr);
+    if (r_int && ((r == 0 && (op == Op::PLUS || op == Op::MINUS))
+                  || (r == 1 && (op == Op::STAR || op == Op::DIV)))) {
+        kept = lhs;
+    } else if (l_int && ((l == 0 && op == Op::PLUS) || (l == 1 && op == Op::STAR)
+                         || (l != 0 && op == Op::AND) || (l == 0 && op == Op::OR))) {
+        kept = rhs;
+    }
+    if (kept != nullptr) {
+        removed_ += 3;
+        result_ = kept;
+        return;
+    }
+    if (l_int && ((l == 0 && op == Op::AND) || (l != 0 && op == Op::OR))) {
+        removed_ += 2 + Count(rhs);
+        result_ = Make<IntExpr>(node->Loc(), op == Op::AND ? 0 : 1);
+        return;
+    }
+    result_ = lhs == node->GetLhs() && rhs == node->GetRhs()
+              ? node : Make<BinaryExpr>(node->Loc(), node->GetOp(), lhs, rhs);
+}
+
+void ConstantFolder::Visit(ArrayCreatePtr node) {
+    auto len = FoldExpr(node->GetLen());
+    auto init = FoldExpr(node->GetInit());
+    result_ = len == node->GetLen() && init == node->GetInit()
+              ? node : Make<ArrayCreate>(node->Loc(), node->GetTypeId(), len, init);
+}
+
+void ConstantFolder::Visit(RecordCreatePtr node) {
+    auto vars = FoldAll(node->GetVars());
+    result_ = vars.begin() == node->GetVars().begin()
+              ? node : Make<RecordCreate>(node->Loc(), node->GetTypeId(), node->GetNames(), vars);
+}
+
+void ConstantFolder::Visit(MethodCallPtr node) {
+    auto lvar = FoldNode(node->GetLvar());
+    auto args = FoldAll(node->GetArgs());
+    result_ = lvar == node->GetLvar() && args.begin() == node->GetArgs().begin()
+              ? node : Make<MethodCall>(node->Loc(), lvar, node->GetMethod(), args);
+}
+
+void ConstantFolder::Visit(FnCallPtr node) {
+    auto args = FoldAll(node->GetArgs());
+    result_ = args.begin() == node->GetArgs().begin() ? node : Make<FnCall>(node->Loc(), node->GetName(), args);
+}
+
+// the branch taken by an `if` on a literal replaces it, the condition
+// and the other branch go
+void ConstantFolder::Visit(IfStmtPtr node) {
+    auto cond = FoldExpr(node->GetIf());
+    auto then = FoldExpr(node->GetThen());
+    auto otherwise = FoldExpr(node->GetElse());
+    auto value = i32(0);
+    if (IntValue(cond, value)) {
+        auto taken = value != 0 ? then : otherwise;
+        auto dropped = value != 0 ? otherwise : then;
+        removed_ += 2 + (dropped != nullptr ? Count(dropped) : 0);
+        if (taken == nullptr) {
+            taken = Unit(node->Loc());
+            removed_ -= Count(taken);
+        }
+        result_ = taken;
+        return;
+    }
+    result_ = cond == node->GetIf() && then == node->GetThen() && otherwise == node->GetElse()
+              ? node : Make<IfStmt>(node->Loc(), cond, then, otherwise);
+}
+
+void ConstantFolder::Visit(WhileStmtPtr node) {
+    auto cond = FoldExpr(node->GetWhile());
+    auto body = FoldExpr(node->GetDo());
+    auto value = i32(0);
+    if (IntValue(cond, value) && value == 0) {
+        result_ = Unit(node->Loc());
+        removed_ += 2 + Count(body) - Count(result_);
+        return;
+    }
+    result_ = cond == node->GetWhile() && body == node->GetDo() ? node : Make<WhileStmt>(node->Loc(), cond, body);
+}
+
+void ConstantFolder::Visit(ForStmtPtr node) {
+    auto from = FoldExpr(node->GetFrom());
+    auto to = FoldExpr(node->GetTo());
+    auto body = FoldExpr(node->GetDo());
+    result_ = from == node->GetFrom() && to == node->GetTo() && body == node->GetDo()
+              ? node : Make<ForStmt>(node->Loc(), node->GetId(), from, to, body);
+}
+
+void ConstantFolder::Visit(LetStmtPtr node) {
+    auto decs = FoldNode(node->GetDecs());
+    auto exprs = FoldExprs(node->GetExprs());
+    result_ = decs == node->GetDecs() && exprs == node->GetExprs() ? node : Make<LetStmt>(node->Loc(), decs, exprs);
+}
+
+void ConstantFolder::Visit(ElemPtr node) {
+    auto idxs = FoldAll(node->GetIdxs());
+    result_ = idxs.begin() == node->GetIdxs().begin() ? node : Make<Elem>(node->Loc(), node->GetName(), idxs);
+}
+
+void ConstantFolder::Visit(LvarPtr node) {
+    auto elems = FoldAll(node->GetElems());
+    result_ = elems.begin() == node->GetElems().begin() ? node : Make<Lvar>(node->Loc(), elems);
+}
+
+void ConstantFolder::Visit(DecsPtr node) {
+    auto decs = FoldAll(node->GetDecs());
+    result_ = decs.begin() == node->GetDecs().begin() ? node : Make<Decs>(node->Loc(), decs);
+}
+
+void ConstantFolder::Visit(TypeDecPtr node) {
+    auto type = FoldNode(node->GetType());
+    result_ = type == node->GetType() ? node : Make<TypeDec>(node->Loc(), node->GetName(), type);
+}
+
+void ConstantFolder::Visit(ClassDefPtr node) {
+    auto fields = FoldNode(node->GetFields());
+    result_ = fields == node->GetFields()
+              ? node : Make<ClassDef>(node->Loc(), node->GetName(), node->GetParent(), fields);
+}
+
+void ConstantFolder::Visit(ClassTypeDefPtr node) {
+    auto fields = FoldNode(node->GetFields());
+    result_ = fields == node->GetFields() ? node : Make<ClassTypeDef>(node->Loc(), node->GetParent(), fields);
+}
+
+void ConstantFolder::Visit(ClassFieldsPtr node) {
+    auto fields = FoldAll(node->GetFields());
+    result_ = fields.begin() == node->GetFields().begin() ? node : Make<ClassFields>(node->Loc(), fields);
+}
+
+void ConstantFolder::Visit(AttrDecPtr node) {
+    auto attr = FoldNode(node->GetAttr());
+    result_ = attr == node->GetAttr() ? node : Make<AttrDec>(node->Loc(), attr);
+}
+
+void ConstantFolder::Visit(MethodDecPtr node) {
+    auto body = FoldExpr(node->GetBody());
+    result_ = body == node->GetBody()
+              ? node : Make<MethodDec>(node->Loc(), node->GetName(), node->GetArgs(), node->GetRet(), body);
+}
+
+void ConstantFolder::Visit(VarDecPtr node) {
+    auto var = FoldExpr(node->GetVar());
+    result_ = var == node->GetVar() ? node : Make<VarDec>(node->Loc(), node->GetName(), node->GetTypeId(), var);
+}
+
+void ConstantFolder::Visit(FnDecPtr node) {
+    auto body = FoldExpr(node->GetBody());
+    result_ = body == node->GetBody()
+              ? node : Make<FnDec>(node->Loc(), node->GetName(), node->GetArgs(), node->GetRet(), body);
+}
+
+// nothing below these folds
+
+void ConstantFolder::Visit(PrimDecPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(ImportDecPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(TypeFieldsPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(TypeAliasPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(RecordDefPtr node) {
+    result_ = node;
+}
+
+void ConstantFolder::Visit(ArrayDefPtr node) {
+    result_ = node;
+}
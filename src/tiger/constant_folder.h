@@ -0,0 +1,104 @@
+#ifndef TIGER_CC_CONSTANT_FOLDER_H
+#define TIGER_CC_CONSTANT_FOLDER_H
+
+#include "visitor.h"
+
+/**
+ * @brief folds the constant expressions of a checked tree:
+ *
+ *   - a binary or unary operator over int literals becomes its value,
+ *     in 32 bit two's complement arithmetic; a division by zero, or of
+ *     the smallest int by -1, is left for run time. Comparisons of string
+ *     literals become 0 or 1, and `(literal)` becomes the literal.
+ *   - `x + 0`, `0 + x`, `x - 0`, `x * 1`, `1 * x`, `x / 1` and `-(-x)`
+ *     become `x`. `0 & x` becomes 0 and `1 | x` becomes 1, `x` is never
+ *     evaluated; `1 & x` and `0 | x` become `x`, for any non zero 1.
+ *   - an `if` on a literal becomes the branch taken, `()` when that is a
+ *     missing `else`, and a `while` on 0 becomes `()`.
+ *
+ * The tree is not changed: a node with a child that folds is made again
+ * in `nodes`, every other node is shared with the tree folded, which
+ * stays valid. Folding assumes the tree type checks, `x + 0` is `x`
+ * only for an int `x`, and its result is for what comes after the
+ * checker: `if 1 then nil else r` leaves a `nil` without its record.
+ */
+class ConstantFolder: public Visitor {
+public:
+    explicit ConstantFolder(Arena &nodes): nodes_(nodes) {}
+
+    // the folded tree, `root` itself if nothing in it folds
+    AstNodePtr Fold(AstNodePtr root);
+
+    // nodes folded away so far, as FlatAst counts them
+    u64 Removed() const {
+        return removed_;
+    }
+
+    void Visit(IntExprPtr node) final;
+    void Visit(StrExprPtr node) final;
+    void Visit(NilExprPtr node) final;
+    void Visit(ExprSeqPtr node) final;
+    void Visit(AssignmentPtr node) final;
+    void Visit(UnaryExprPtr node) final;
+    void Visit(ExprsPtr node) final;
+    void Visit(BinaryExprPtr node) final;
+    void Visit(ArrayCreatePtr node) final;
+    void Visit(RecordCreatePtr node) final;
+    void Visit(ObjectNewPtr node) final;
+    void Visit(MethodCallPtr node) final;
+    void Visit(FnCallPtr node) final;
+    void Visit(IfStmtPtr node) final;
+    void Visit(WhileStmtPtr node) final;
+    void Visit(ForStmtPtr node) final;
+    void Visit(BreakStmtPtr node) final;
+    void Visit(LetStmtPtr node) final;
+    void Visit(ElemPtr node) final;
+    void Visit(LvarPtr node) final;
+    void Visit(ClassFieldsPtr node) final;
+    void Visit(TypeFieldsPtr node) final;
+    void Visit(TypeDecPtr node) final;
+    void Visit(VarDecPtr node) final;
+    void Visit(DecsPtr node) final;
+    void Visit(MethodDecPtr node) final;
+    void Visit(AttrDecPtr node) final;
+    void Visit(FnDecPtr node) final;
+    void Visit(PrimDecPtr node) final;
+    void Visit(ImportDecPtr node) final;
+    void Visit(TypeAliasPtr node) final;
+    void Visit(RecordDefPtr node) final;
+    void Visit(ArrayDefPtr node) final;
+    void Visit(ClassDefPtr node) final;
+    void Visit(ClassTypeDefPtr node) final;
+
+private:
+    // `node` folded, nullptr stays nullptr. Only an expression may fold
+    // into a node of another class.
+    template <typename T>
+    T *FoldNode(T *node);
+    ExprPtr FoldExpr(ExprPtr expr);
+    ExprsPtr FoldExprs(ExprsPtr exprs);
+    // the same span if no element changes
+    template <typename T>
+    Span<T> FoldAll(const Span<T> &list);
+
+    template <typename T, typename... Args>
+    T *Make(SourceLoc loc, Args&&... args) {
+        auto node = nodes_.New<T>(std::forward<Args>(args)...);
+        node->SetLoc(loc);
+        return node;
+    }
+
+    // `()` at `loc`
+    ExprPtr Unit(SourceLoc loc);
+    // nodes of the subtree `node`, as FlatAst counts them
+    static u64 Count(AstNodePtr node);
+
+private:
+    Arena &nodes_;
+    // the node visited last, folded
+    AstNodePtr result_ {nullptr};
+    ExprsPtr exprs_ {nullptr};
+    u64 removed_ {0};
+};
+
+#endif // TIGER_CC_CONSTANT_FOLDER_H
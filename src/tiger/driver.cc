@@ -0,0 +1,496 @@
+#include "driver.h"
+#include "ast_cache.h"
+#include "constant_folder.h"
+#include "escape_analysis.h"
+#include "parallel_lexer.h"
+#include "parallel_parser.h"
+#include "type_checker.h"
+#include "../utils/profile.h"
+#include "../utils/source_buffer.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::optional<Driver::Options> Driver::ParseArgs(const std::vector<std::string> &args, std::string &err) {
+    auto options = Options();
+    auto value = [](const std::string &arg, const char *option) -> std::optional<std::string> {
+        auto n = strlen(option);
+        if (arg.compare(0, n, option) == 0 && arg.size() > n && arg[n] == '=') {
+            return arg.substr(n + 1);
+        }
+        return std::nullopt;
+    };
+
+    for (auto &arg : args) {
+        if (arg.rfind("--", 0) != 0) {
+            options.files.push_back(arg);
+        } else if (arg == "--sexp") {
+            options.format = AstWriter::Format::SEXPR;
+        } else if (arg == "--check") {
+            options.check = true;
+        } else if (arg == "--fold") {
+            options.check = true;
+            options.fold = true;
+        } else if (arg == "--escapes") {
+            options.check = true;
+            options.escapes = true;
+        } else if (arg == "--cache") {
+            options.cache_dir = AstCache::DefaultDir();
+        } else if (arg == "--time-report") {
+            options.time_report = TimeReport::TEXT;
+        } else if (arg == "--time-report=json") {
+            options.time_report = TimeReport::JSON;
+        } else if (arg == "--shutdown") {
+            options.shutdown = true;
+        } else if (auto dir = value(arg, "--cache")) {
+            options.cache_dir = *dir;
+        } else if (auto jobs = value(arg, "--jobs")) {
+            options.jobs = static_cast<u32>(std::strtoul(jobs->c_str(), nullptr, 10));
+            options.jobs = options.jobs == 0 ? 1 : options.jobs;
+        } else if (auto dir = value(arg, "--out-dir")) {
+            options.out_dir = *dir;
+        } else if (auto socket = value(arg, "--serve")) {
+            options.serve = *socket;
+        } else if (auto socket = value(arg, "--connect")) {
+            options.connect = *socket;
+        } else if (auto list = value(arg, "--batch")) {
+            auto file = std::ifstream();
+            if (*list != "-") {
+                file.open(*list);
+                if (!file) {
+                    err += "error: cannot read " + *list + "\n";
+                    return std::nullopt;
+                }
+            }
+            auto &in = *list == "-" ? std::cin : file;
+            for (auto line = std::string(); std::getline(in, line);) {
+                if (!line.empty()) {
+                    options.files.push_back(line);
+                }
+            }
+        } else {
+            err += "unknown option " + arg + "\n";
+            return std::nullopt;
+        }
+    }
+    if (options.shutdown && !options.connect) {
+        err += "--shutdown needs --connect=<socket>\n";
+        return std::nullopt;
+    }
+    if (options.files.empty() && !options.serve && !options.shutdown) {
+        options.files.emplace_back("-");
+    }
+    return options;
+}
+
+int Driver::Run(const std::vector<std::string> &args) {
+    auto err = std::string();
+    auto options = ParseArgs(args, err);
+    if (!options) {
+        std::cerr << err;
+        return 1;
+    }
+    if (options->serve) {
+        return Serve(*options->serve);
+    }
+
+    auto result = Result();
+    if (options->connect) {
+        char cwd[PATH_MAX];
+        auto forward = ForwardArgs(args, *options, getcwd(cwd, sizeof(cwd)) != nullptr ? cwd : ".");
+        auto reply = Request(*options->connect, forward);
+        if (!reply) {
+            std::cerr << "error: no server at " << *options->connect << std::endl;
+            return 1;
+        }
+        result = std::move(*reply);
+    } else {
+        result = Compile(*options);
+    }
+    std::cout << result.out << std::flush;
+    std::cerr << result.err << std::flush;
+    return result.status;
+}
+
+// the server runs elsewhere: it gets absolute paths, and the files a
+// --batch list named instead of the list, which was read here already
+std::vector<std::string> Driver::ForwardArgs(const std::vector<std::string> &args, const Options &options,
+                                             const std::string &cwd) {
+    // a shutdown is a request of its own, nothing else in it is run
+    if (options.shutdown) {
+        return {"--shutdown"};
+    }
+    auto base = cwd + "/";
+    auto absolute = [&](const std::string &path) {
+        return path.empty() || path[0] == '/' || path == "-" ? path : base + path;
+    };
+    auto forward = std::vector<std::string>();
+    for (auto &arg : args) {
+        auto eq = arg.find('=');
+        auto option = arg.substr(0, eq);
+        if (arg.rfind("--", 0) != 0 || option == "--connect" || option == "--batch") {
+            continue;
+        }
+        if (eq != std::string::npos && (option == "--cache" || option == "--out-dir")) {
+            forward.push_back(option + "=" + absolute(arg.substr(eq + 1)));
+        } else {
+            forward.push_back(arg);
+        }
+    }
+    for (auto &file : options.files) {
+        forward.push_back(absolute(file));
+    }
+    return forward;
+}
+
+Driver::Result Driver::Compile(const Options &options) {
+    auto &files = options.files;
+    auto results = std::vector<Result>(files.size());
+    if (files.size() == 1) {
+        results[0] = CompileFile(files[0], options, options.jobs);
+    } else if (!files.empty()) {
+        // files go parallel, each one is lexed and parsed serially
+        Pool(options.jobs).ParallelFor(static_cast<u32>(files.size()), [&](u32 i) {
+            results[i] = CompileFile(files[i], options, 1);
+        });
+    }
+
+    auto all = Result();
+    for (size_t i = 0; i < files.size(); ++i) {
+        auto &result = results[i];
+        if (options.out_dir && result.status == 0) {
+            auto name = files[i].substr(files[i].rfind('/') + 1);
+            auto path = *options.out_dir + "/" + (name == "-" ? "stdin" : name) + ".ast";
+            auto out = std::ofstream(path, std::ios::binary);
+            if (!(out << result.out)) {
+                result.status = 1;
+                result.err += "error: cannot write " + path + "\n";
+            }
+        } else {
+            all.out += result.out;
+        }
+        all.err += result.err;
+        all.status = std::max(all.status, result.status);
+    }
+
+    // the reports go last, a json one as an array of files
+    if (options.time_report == TimeReport::JSON) {
+        all.err += "[";
+        for (size_t i = 0; i < results.size(); ++i) {
+            all.err += (i == 0 ? "" : ",\n ") + results[i].report;
+        }
+        all.err += "]\n";
+    } else {
+        for (auto &result : results) {
+            all.err += result.report;
+        }
+    }
+    return all;
+}
+
+// dump the ast of the file at `path`, status 1 after reporting syntax
+// errors, or type errors when checking. with `jobs` threads the file is
+// lexed, parsed and checked in parallel.
+// with a time report lexing is a phase of its own, ahead of the parser.
+Driver::Result Driver::CompileFile(const std::string &path, const Options &options, u32 jobs) {
+    auto result = Result();
+    auto profile = options.time_report != TimeReport::NONE ? std::optional(Profile(path)) : std::nullopt;
+    auto prof = profile ? &*profile : nullptr;
+
+    auto source = std::optional<SourceBuffer>();
+    {
+        auto phase = Profile::Scope(prof, "read");
+        source = path == "-" ? std::optional(SourceBuffer::FromStdin()) : SourceBuffer::TryFromFile(path);
+        phase.Count(source ? source->Size() : 0, "bytes");
+    }
+    if (!source) {
+        result.status = 1;
+        result.err = "error: cannot read " + path + "\n";
+        return result;
+    }
+
+    auto key = (((AstCache::Key(source->View()) * 31 + static_cast<u64>(options.format)) * 2 + options.check) * 2
+                + options.fold) * 2 + options.escapes;
+    if (remember_ && prof == nullptr) {
+        auto lock = std::lock_guard<std::mutex>(mu_);
+        auto it = results_.find(path);
+        if (it != results_.end() && it->second.first == key) {
+            return it->second.second;
+        }
+    }
+
+    auto out = std::ostringstream();
+    auto err = std::ostringstream();
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto cache = options.cache_dir ? std::optional(AstCache(*options.cache_dir)) : std::nullopt;
+    // an unchanged module comes straight from the cache, unless it is to
+    // be checked: that needs the tree
+    auto flat = std::optional<FlatAst>();
+    if (cache && !options.check) {
+        auto phase = Profile::Scope(prof, "load");
+        flat = cache->Load(source->View(), symbols);
+        phase.Count(flat ? flat->Size() : 0, "nodes");
+    }
+    auto nodes = Arena();
+    auto ast = AstNodePtr();
+    if (!flat) {
+        auto diags = Diagnostics(source->View(), source->Name());
+        if (jobs > 1) {
+            auto &pool = Pool(jobs);
+            auto tokens = TokenArena(source->View());
+            {
+                auto phase = Profile::Scope(prof, "lex");
+                tokens = ParallelLexer(pool).Lex(source->View(), symbols);
+                phase.Count(tokens.Tokens().size(), "tokens");
+            }
+            auto phase = Profile::Scope(prof, "parse");
+            ast = ParallelParser(pool).Parse(tokens, nodes, &diags);
+            phase.Count(nodes.Objects(), "nodes");
+        } else if (prof != nullptr) {
+            auto lexer = Lexer(source->View(), symbols);
+            {
+                auto phase = Profile::Scope(prof, "lex");
+                phase.Count(lexer.GetAllTokens().size(), "tokens");
+            }
+            auto phase = Profile::Scope(prof, "parse");
+            ast = Parser(lexer.Arena(), nodes, &diags).ParseResult();
+            phase.Count(nodes.Objects(), "nodes");
+        } else {
+            auto lexer = Lexer(source->View(), symbols);
+            ast = Parser(lexer, nodes, &diags).ParseResult();
+        }
+        if (options.check && !diags.HasErrors()) {
+            auto phase = Profile::Scope(prof, "check");
+            auto types = TypeContext();
+            TypeChecker(types, symbols, &diags, jobs > 1 ? &Pool(jobs) : nullptr).Check(ast);
+            phase.Count(types.Size(), "types");
+        }
+        if (options.fold && !diags.HasErrors()) {
+            auto phase = Profile::Scope(prof, "fold");
+            auto folder = ConstantFolder(nodes);
+            ast = folder.Fold(ast);
+            phase.Count(folder.Removed(), "removed");
+        }
+        if (options.escapes && !diags.HasErrors()) {
+            auto phase = Profile::Scope(prof, "escapes");
+            auto escapes = EscapeAnalysis(symbols);
+            escapes.Analyze(ast);
+            escapes.Print(err, source->Name(), diags.Lines());
+            phase.Count(escapes.Escaping(), "escaping");
+        }
+        if (diags.HasErrors()) {
+            diags.Print(err);
+            err << diags.ErrorCount() << (diags.ErrorCount() == 1 ? " error" : " errors")
+                << " generated." << std::endl;
+            result.status = 1;
+        }
+    }
+
+    if (result.status == 0) {
+        auto phase = Profile::Scope(prof, "dump");
+        if (options.format == AstWriter::Format::TEXT) {
+            out << '\n';
+        }
+        if (flat) {
+            AstWriter(out, options.format).Write(*flat);
+        } else {
+            AstWriter(out, options.format).Write(ast);
+        }
+        if (options.format == AstWriter::Format::TEXT) {
+            out << '\n';
+        }
+        phase.Count(out.tellp(), "bytes");
+    }
+    // the cache is for the tree as parsed
+    if (result.status == 0 && cache && !flat && !options.fold) {
+        auto phase = Profile::Scope(prof, "store");
+        auto image = FlatAst::Build(ast);
+        cache->Store(source->View(), image);
+        phase.Count(image.Size(), "nodes");
+    }
+    result.out = out.str();
+    result.err = err.str();
+
+    if (profile) {
+        auto report = std::ostringstream();
+        if (options.time_report == TimeReport::JSON) {
+            profile->PrintJson(report);
+        } else {
+            profile->Print(report);
+        }
+        result.report = report.str();
+    } else if (remember_ && path != "-") {
+        auto lock = std::lock_guard<std::mutex>(mu_);
+        results_[path] = {key, result};
+    }
+    return result;
+}
+
+// the pool, made again if it doesn't have `threads` threads
+ThreadPool &Driver::Pool(u32 threads) {
+    if (pool_ == nullptr || pool_->Size() != threads) {
+        pool_ = std::make_unique<ThreadPool>(threads);
+    }
+    return *pool_;
+}
+
+// `bytes` as its length on a line followed by the bytes, the way both
+// requests and replies carry what they hold
+static std::string Framed(const std::string &bytes) {
+    return std::to_string(bytes.size()) + "\n" + bytes;
+}
+
+// the number on the line of `data` at `pos`, which moves past it
+static bool ReadNumber(const std::string &data, size_t &pos, u64 &n) {
+    auto eol = data.find('\n', pos);
+    if (eol == std::string::npos || eol == pos) {
+        return false;
+    }
+    n = std::strtoull(data.c_str() + pos, nullptr, 10);
+    pos = eol + 1;
+    return true;
+}
+
+// what Framed made, at `pos` in `data`
+static bool ReadFramed(const std::string &data, size_t &pos, std::string &bytes) {
+    auto n = u64(0);
+    if (!ReadNumber(data, pos, n) || n > data.size() - pos) {
+        return false;
+    }
+    bytes = data.substr(pos, n);
+    pos += n;
+    return true;
+}
+
+static bool SendAll(int fd, const std::string &data) {
+    for (size_t done = 0; done < data.size();) {
+        auto n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+static std::string ReceiveAll(int fd) {
+    auto data = std::string();
+    char buffer[64 << 10];
+    for (;;) {
+        auto n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return data;
+        }
+        data.append(buffer, n);
+    }
+}
+
+static bool SocketAddress(const std::string &path, sockaddr_un &addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+int Driver::Serve(const std::string &socket_path) {
+    auto addr = sockaddr_un();
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || !SocketAddress(socket_path, addr)) {
+        std::cerr << "error: cannot serve on " << socket_path << std::endl;
+        return 1;
+    }
+    unlink(socket_path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        std::cerr << "error: cannot serve on " << socket_path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return 1;
+    }
+
+    remember_ = true;
+    for (auto stop = false; !stop;) {
+        auto conn = accept(fd, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        auto args = std::vector<std::string>();
+        auto request = ReceiveAll(conn);
+        auto framed = true;
+        for (size_t pos = 0; framed && pos < request.size();) {
+            auto arg = std::string();
+            framed = ReadFramed(request, pos, arg);
+            args.push_back(std::move(arg));
+        }
+        auto result = Result();
+        auto options = std::optional<Options>();
+        if (!framed) {
+            result.status = 1;
+            result.err = "error: malformed request\n";
+        } else if (args == std::vector<std::string> {"--shutdown"}) {
+            stop = true;
+        } else if (!(options = ParseArgs(args, result.err))) {
+            result.status = 1;
+        } else if (options->serve || options->connect
+                   || std::find(options->files.begin(), options->files.end(), "-") != options->files.end()) {
+            result.status = 1;
+            result.err = "error: a server compiles files, not stdin or other servers\n";
+        } else {
+            result = Compile(*options);
+        }
+
+        SendAll(conn, std::to_string(result.status) + "\n" + Framed(result.out) + Framed(result.err));
+        close(conn);
+    }
+    close(fd);
+    unlink(socket_path.c_str());
+    return 0;
+}
+
+std::optional<Driver::Result> Driver::Request(const std::string &socket_path, const std::vector<std::string> &args) {
+    auto addr = sockaddr_un();
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    if (!SocketAddress(socket_path, addr)
+        || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return std::nullopt;
+    }
+
+    auto request = std::string();
+    for (auto &arg : args) {
+        request += Framed(arg);
+    }
+    auto sent = SendAll(fd, request);
+    shutdown(fd, SHUT_WR);
+    auto reply = sent ? ReceiveAll(fd) : std::string();
+    close(fd);
+
+    // status, then stdout and stderr
+    auto result = Result();
+    auto pos = size_t(0);
+    auto status = u64(0);
+    if (!ReadNumber(reply, pos, status) || !ReadFramed(reply, pos, result.out)
+        || !ReadFramed(reply, pos, result.err)) {
+        return std::nullopt;
+    }
+    result.status = static_cast<int>(status);
+    return result;
+}
@@ -0,0 +1,118 @@
+#ifndef TIGER_CC_DRIVER_H
+#define TIGER_CC_DRIVER_H
+
+#include "ast.h"
+#include "../utils/thread_pool.h"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief the command line of tiger_compiler.
+ *
+ *   tiger_compiler [options] [file... | -]
+ *     --sexp            dump s-expressions instead of the indented tree
+ *     --check           type check each file after parsing it, see
+ *                       TypeChecker, a file with errors is not dumped
+ *     --fold            check, then dump the tree with its constants
+ *                       folded, see ConstantFolder
+ *     --escapes         check, then print to stderr how many variables
+ *                       of each function escape, see EscapeAnalysis
+ *     --cache[=dir]     reuse parsed modules, see AstCache
+ *     --jobs=n          threads for the files of a batch, or for the
+ *                       lexer, parser and checker of a single file
+ *     --batch=list      also compile the files named in `list`, one per
+ *                       line, `-` reads the names from stdin
+ *     --out-dir=dir     write the dump of each file to dir/<name>.ast
+ *     --time-report[=json]
+ *                       print what each phase of each file cost to
+ *                       stderr, see Profile
+ *     --serve=socket    stay up and compile what is sent to `socket`
+ *     --connect=socket  have the server at `socket` run this command
+ *     --shutdown        with --connect, stop the server
+ *
+ * Several files make a batch, compiled in one process on a pool of
+ * `jobs` threads. The output of each file is printed in the order the
+ * files were given, and the exit status is 1 if any of them failed.
+ *
+ * The server keeps its pool and the dump of every file it compiled, a
+ * file whose bytes and options are unchanged is answered from memory,
+ * unless a time report is asked for.
+ * Requests are served one at a time, send a batch to use the pool. What
+ * goes either way is framed as its length on a line followed by the
+ * bytes. A request is the arguments of a command line, each framed,
+ * ended by shutting down the writing side of the connection; `--shutdown`
+ * alone stops the server. The reply is the exit status on a line, then
+ * stdout and stderr, each framed.
+ */
+class Driver {
+public:
+    enum class TimeReport: u8 {
+        NONE,
+        TEXT,
+        JSON,
+    };
+
+    struct Options {
+        AstWriter::Format format {AstWriter::Format::TEXT};
+        bool check {false};
+        bool fold {false};
+        bool escapes {false};
+        std::optional<std::string> cache_dir;
+        u32 jobs {1};
+        std::optional<std::string> out_dir;
+        TimeReport time_report {TimeReport::NONE};
+        std::optional<std::string> serve;
+        std::optional<std::string> connect;
+        bool shutdown {false};
+        std::vector<std::string> files;
+    };
+
+    // what a command printed and its exit status
+    struct Result {
+        int status {0};
+        std::string out;
+        std::string err;
+        // the time report of one file, printed after all diagnostics
+        std::string report;
+    };
+
+    // nullopt after describing the problem in `err`
+    static std::optional<Options> ParseArgs(const std::vector<std::string> &args, std::string &err);
+
+    // run a command line the way main does
+    int Run(const std::vector<std::string> &args);
+
+    // compile `options.files`, concurrently when there are several
+    Result Compile(const Options &options);
+
+    // serve requests on `socket` until one asks for --shutdown
+    int Serve(const std::string &socket);
+
+    // what a client sends the server for the command line `args`, which
+    // parsed into `options`, run in the directory `cwd`
+    static std::vector<std::string> ForwardArgs(const std::vector<std::string> &args, const Options &options,
+                                                const std::string &cwd);
+
+    // have the server at `socket` run `args`, nullopt if it can't be reached
+    static std::optional<Result> Request(const std::string &socket, const std::vector<std::string> &args);
+
+private:
+    Result CompileFile(const std::string &path, const Options &options, u32 jobs);
+    ThreadPool &Pool(u32 threads);
+
+private:
+    std::unique_ptr<ThreadPool> pool_;
+
+    // only a server remembers results, by path: the hash of the source
+    // and options they were made from, and the result
+    bool remember_ {false};
+    std::mutex mu_;
+    std::unordered_map<std::string, std::pair<u64, Result>> results_;
+};
+
+#endif // TIGER_CC_DRIVER_H
@@ -3,76 +3,117 @@
 
 #include "symbol.h"
 #include "ast.h"
+#include "type.h"
 
-#include <list>
-#include <unordered_map>
+#include <memory>
+#include <vector>
 
 template <typename T>
 class EnvTable;
 
 using SymbolTable = EnvTable<AstNodePtr>;
-using TypeTable = EnvTable<TypePtr>;
+using TypeTable = EnvTable<const Type>;
 
+/**
+ * @brief scoped symbol table. There is one flat table of visible bindings
+ * indexed by symbol id, plus an undo log of the bindings each scope
+ * shadowed. Entering a scope records the log size, leaving it replays the
+ * log back to that size, so both cost only what the scope itself bound
+ * and lookup is a single index whatever the nesting depth.
+ *
+ * A table may be made over an `outer` one, which it only reads: a symbol
+ * it has no binding for is looked up there. Several threads can each
+ * keep their own scopes over one outer table that none of them changes.
+ * Remove hides only the bindings of this table, not those of `outer`.
+ */
 template <typename T>
 class EnvTable {
 public:
     using ValuePtr = std::shared_ptr<T>;
-    using ScopeMap = std::unordered_map<SymbolPtr, ValuePtr>;
-    using ScopeList = std::list<ScopeMap>;
 
 public:
+    EnvTable() = default;
+
+    explicit EnvTable(const EnvTable *outer): outer_(outer) {}
+
+    // a binding to a value owned elsewhere, an Arena or a TypeContext,
+    // it costs no allocation and no reference count
+    static ValuePtr Borrow(T *value) {
+        return ValuePtr(ValuePtr(), value);
+    }
+
     void BeginScope() {
-        auto new_scope = GetCurrScope();
-        scopes_.push_back(std::move(new_scope));
-        ++scope_cnt_;
+        marks_.push_back(log_.size());
     }
 
     void EndScope() {
-        if (!scopes_.empty()) {
-            scopes_.pop_back();
+        if (marks_.empty()) {
+            return;
+        }
+        auto mark = marks_.back();
+        marks_.pop_back();
+        while (log_.size() > mark) {
+            auto &undo = log_.back();
+            visible_[undo.symbol.Id()] = std::move(undo.prev);
+            log_.pop_back();
         }
     }
 
-    bool Remove(SymbolPtr symbol) {
-        auto curr_scope = GetCurrScope();
-        auto it = curr_scope.find(symbol);
-        if (it != curr_scope.end()) {
-            curr_scope.erase(it);
+    // hide `symbol` until the current scope ends
+    bool Remove(Symbol symbol) {
+        auto id = symbol.Id();
+        if (id >= visible_.size() || visible_[id] == nullptr) {
+            return false;
         }
+        Set(symbol, ValuePtr());
+        return true;
     }
 
-    bool Exist(SymbolPtr symbol) {
+    bool Exist(Symbol symbol) const {
         return Find(symbol).get() != nullptr;
     }
 
-    ValuePtr Find(SymbolPtr symbol) {
-        auto curr_scope = GetCurrScope();
-        auto it = curr_scope.find(symbol);
-        if (it != curr_scope.end()) {
-            return it->second;
-        } else {
-            return ValuePtr();
+    ValuePtr Find(Symbol symbol) const {
+        auto id = symbol.Id();
+        if (id < visible_.size() && visible_[id] != nullptr) {
+            return visible_[id];
         }
+        return outer_ != nullptr ? outer_->Find(symbol) : ValuePtr();
     }
 
-    void Add(SymbolPtr symbol, ValuePtr value) {
-        if (!scopes_.empty()) {
-            auto curr_scope = GetCurrScope();
-            curr_scope[symbol] = value;
+    // bind `symbol` in the current scope, shadowing outer bindings
+    void Add(Symbol symbol, ValuePtr value) {
+        if (!marks_.empty()) {
+            Set(symbol, std::move(value));
         }
     }
 
-    ScopeMap GetCurrScope() {
-        if (scopes_.empty()) {
-            return ScopeMap();
-        } else {
-            return scopes_.back();
+    u64 Depth() const {
+        return marks_.size();
+    }
+
+private:
+    void Set(Symbol symbol, ValuePtr value) {
+        auto id = symbol.Id();
+        if (id >= visible_.size()) {
+            visible_.resize(id + 1);
         }
+        log_.push_back({symbol, std::move(visible_[id])});
+        visible_[id] = std::move(value);
     }
 
 private:
-    ScopeList scopes_;
-    u64 scope_cnt_ {0};
+    struct Undo {
+        Symbol symbol;
+        ValuePtr prev;
+    };
+
+    const EnvTable *outer_ {nullptr};
+    // innermost binding of every symbol, indexed by id
+    std::vector<ValuePtr> visible_;
+    std::vector<Undo> log_;
+    // log size when each open scope began
+    std::vector<size_t> marks_;
 };
 
-#endif // TIGER_CC_ENV_H
\ No newline at end of file
+#endif // TIGER_CC_ENV_H
@@ -0,0 +1,280 @@
+#include "escape_analysis.h"
+
+#include <algorithm>
+#include <cstdio>
+
+EscapeAnalysis::EscapeAnalysis(const SymbolPool &symbols): self_(symbols.Find("self")) {}
+
+void EscapeAnalysis::Analyze(AstNodePtr root) {
+    frames_.clear();
+    escaping_.clear();
+    level_ = 0;
+    frame_ = 0;
+    frames_.push_back({Symbol(), root != nullptr ? root->Loc() : SourceLoc(), 0, 0});
+    env_.BeginScope();
+    if (root != nullptr) {
+        root->Accept(*this);
+    }
+    env_.EndScope();
+}
+
+void EscapeAnalysis::Print(std::ostream &out, const std::string &file, const LineTable &lines) const {
+    char line[160];
+    out << "===== escapes: " << file << " =====\n";
+    snprintf(line, sizeof(line), "%-24s %6s %10s %10s\n", "function", "line", "variables", "escaping");
+    out << line;
+    auto variables = u64(0);
+    for (auto &frame : frames_) {
+        auto name = frame.name.Valid() ? std::string(frame.name.Name()) : std::string("<program>");
+        auto at = frame.loc.IsValid() ? lines.LineColumn(frame.loc).first : 0;
+        snprintf(line, sizeof(line), "%-24s %6u %10u %10u\n", name.c_str(), at, frame.variables, frame.escaping);
+        out << line;
+        variables += frame.variables;
+    }
+    snprintf(line, sizeof(line), "%-24s %6s %10llu %10llu\n", "total", "", static_cast<unsigned long long>(variables),
+             static_cast<unsigned long long>(escaping_.size()));
+    out << line;
+}
+
+void EscapeAnalysis::Declare(Symbol name, const void *decl) {
+    auto binding = bindings_.New<Binding>(Binding{decl, level_, frame_});
+    env_.Add(name, EnvTable<const Binding>::Borrow(binding));
+    if (decl != nullptr) {
+        ++frames_[frame_].variables;
+    }
+}
+
+// a variable used in a function nested in the one that declares it
+// escapes
+void EscapeAnalysis::Use(Symbol name) {
+    auto binding = env_.Find(name);
+    if (binding == nullptr || binding->decl == nullptr || binding->level == level_) {
+        return;
+    }
+    if (escaping_.insert(binding->decl).second) {
+        ++frames_[binding->frame].escaping;
+    }
+}
+
+u32 EscapeAnalysis::EnterFrame(Symbol name, SourceLoc loc) {
+    auto outer = frame_;
+    frame_ = static_cast<u32>(frames_.size());
+    frames_.push_back({name, loc, 0, 0});
+    ++level_;
+    env_.BeginScope();
+    return outer;
+}
+
+void EscapeAnalysis::LeaveFrame(u32 outer) {
+    env_.EndScope();
+    --level_;
+    frame_ = outer;
+}
+
+// a body sees its parameters, and `self` in a method
+void EscapeAnalysis::Function(IdPtr name, TypeFieldsPtr params, ExprPtr body, MethodDecPtr method) {
+    auto outer = EnterFrame(name->GetName(), name->Loc());
+    if (method != nullptr && self_.Valid()) {
+        Declare(self_, method);
+    }
+    for (auto param : params->GetNames()) {
+        Declare(param->GetName(), param);
+    }
+    body->Accept(*this);
+    LeaveFrame(outer);
+}
+
+// the attributes are not variables, only their initial values are
+// analyzed, in a frame for the class if it has any
+void EscapeAnalysis::Class(IdPtr name, ClassFieldsPtr fields) {
+    auto &list = fields->GetFields();
+    auto has_attributes = std::any_of(list.begin(), list.end(), [](ClassFieldPtr field) {
+        return dynamic_cast<AttrDecPtr>(field) != nullptr;
+    });
+    if (has_attributes) {
+        auto outer = EnterFrame(name->GetName(), name->Loc());
+        for (auto field : list) {
+            if (auto attr = dynamic_cast<AttrDecPtr>(field); attr != nullptr) {
+                attr->GetAttr()->GetVar()->Accept(*this);
+            }
+        }
+        LeaveFrame(outer);
+    }
+    for (auto field : list) {
+        if (auto method = dynamic_cast<MethodDecPtr>(field); method != nullptr) {
+            Function(method->GetName(), method->GetArgs(), method->GetBody(), method);
+        }
+    }
+}
+
+void EscapeAnalysis::Visit(IntExprPtr node) {}
+
+void EscapeAnalysis::Visit(StrExprPtr node) {}
+
+void EscapeAnalysis::Visit(NilExprPtr node) {}
+
+void EscapeAnalysis::Visit(BreakStmtPtr node) {}
+
+void EscapeAnalysis::Visit(ObjectNewPtr node) {}
+
+void EscapeAnalysis::Visit(ExprSeqPtr node) {
+    node->GetExprs()->Accept(*this);
+}
+
+void EscapeAnalysis::Visit(ExprsPtr node) {
+    for (auto expr : node->GetExprs()) {
+        expr->Accept(*this);
+    }
+}
+
+void EscapeAnalysis::Visit(AssignmentPtr node) {
+    node->GetLvar()->Accept(*this);
+    node->GetExpr()->Accept(*this);
+}
+
+void EscapeAnalysis::Visit(UnaryExprPtr node) {
+    node->GetExpr()->Accept(*this);
+}
+
+void EscapeAnalysis::Visit(BinaryExprPtr node) {
+    node->GetLhs()->Accept(*this);
+    node->GetRhs()->Accept(*this);
+}
+
+void EscapeAnalysis::Visit(ArrayCreatePtr node) {
+    node->GetLen()->Accept(*this);
+    node->GetInit()->Accept(*this);
+}
+
+void EscapeAnalysis::Visit(RecordCreatePtr node) {
+    for (auto var : node->GetVars()) {
+        var->Accept(*this);
+    }
+}
+
+void EscapeAnalysis::Visit(MethodCallPtr node) {
+    node->GetLvar()->Accept(*this);
+    for (auto arg : node->GetArgs()) {
+        arg->Accept(*this);
+    }
+}
+
+void EscapeAnalysis::Visit(FnCallPtr node) {
+    for (auto arg : node->GetArgs()) {
+        arg->Accept(*this);
+    }
+}
+
+void EscapeAnalysis::Visit(IfStmtPtr node) {
+    node->GetIf()->Accept(*this);
+    node->GetThen()->Accept(*this);
+    if (node->GetElse() != nullptr) {
+        node->GetElse()->Accept(*this);
+    }
+}
+
+void EscapeAnalysis::Visit(WhileStmtPtr node) {
+    node->GetWhile()->Accept(*this);
+    node->GetDo()->Accept(*this);
+}
+
+// the index is a variable of the function the loop is in
+void EscapeAnalysis::Visit(ForStmtPtr node) {
+    node->GetFrom()->Accept(*this);
+    node->GetTo()->Accept(*this);
+    env_.BeginScope();
+    Declare(node->GetId()->GetName(), node);
+    node->GetDo()->Accept(*this);
+    env_.EndScope();
+}
+
+void EscapeAnalysis::Visit(LetStmtPtr node) {
+    env_.BeginScope();
+    node->GetDecs()->Accept(*this);
+    node->GetExprs()->Accept(*this);
+    env_.EndScope();
+}
+
+// only the first element of an lvalue names a variable, the others are
+// fields
+void EscapeAnalysis::Visit(ElemPtr node) {
+    for (auto idx : node->GetIdxs()) {
+        idx->Accept(*this);
+    }
+}
+
+void EscapeAnalysis::Visit(LvarPtr node) {
+    auto &elems = node->GetElems();
+    Use(elems[0]->GetName()->GetName());
+    for (auto elem : elems) {
+        elem->Accept(*this);
+    }
+}
+
+// the names of a function group hide the variables they shadow before
+// any of the bodies is analyzed
+void EscapeAnalysis::Visit(DecsPtr node) {
+    auto is_function = [](DecPtr dec) {
+        return dynamic_cast<FnDecPtr>(dec) != nullptr || dynamic_cast<PrimDecPtr>(dec) != nullptr;
+    };
+    auto &decs = node->GetDecs();
+    for (u32 i = 0; i < decs.size();) {
+        auto end = i + 1;
+        if (is_function(decs[i])) {
+            while (end < decs.size() && is_function(decs[end])) {
+                ++end;
+            }
+            for (auto j = i; j < end; ++j) {
+                auto fn = dynamic_cast<FnDecPtr>(decs[j]);
+                Declare(fn != nullptr ? fn->GetName()->GetName()
+                                      : static_cast<PrimDecPtr>(decs[j])->GetName()->GetName(), nullptr);
+            }
+        }
+        for (auto j = i; j < end; ++j) {
+            decs[j]->Accept(*this);
+        }
+        i = end;
+    }
+}
+
+void EscapeAnalysis::Visit(VarDecPtr node) {
+    node->GetVar()->Accept(*this);
+    Declare(node->GetName()->GetName(), node);
+}
+
+void EscapeAnalysis::Visit(FnDecPtr node) {
+    Function(node->GetName(), node->GetArgs(), node->GetBody(), nullptr);
+}
+
+void EscapeAnalysis::Visit(TypeDecPtr node) {
+    declaring_ = node->GetName();
+    node->GetType()->Accept(*this);
+}
+
+void EscapeAnalysis::Visit(ClassDefPtr node) {
+    Class(node->GetName(), node->GetFields());
+}
+
+void EscapeAnalysis::Visit(ClassTypeDefPtr node) {
+    Class(declaring_, node->GetFields());
+}
+
+// reached through Class, or declaring nothing that is a variable
+
+void EscapeAnalysis::Visit(ClassFieldsPtr node) {}
+
+void EscapeAnalysis::Visit(AttrDecPtr node) {}
+
+void EscapeAnalysis::Visit(MethodDecPtr node) {}
+
+void EscapeAnalysis::Visit(PrimDecPtr node) {}
+
+void EscapeAnalysis::Visit(ImportDecPtr node) {}
+
+void EscapeAnalysis::Visit(TypeFieldsPtr node) {}
+
+void EscapeAnalysis::Visit(TypeAliasPtr node) {}
+
+void EscapeAnalysis::Visit(RecordDefPtr node) {}
+
+void EscapeAnalysis::Visit(ArrayDefPtr node) {}
@@ -0,0 +1,140 @@
+#ifndef TIGER_CC_ESCAPE_ANALYSIS_H
+#define TIGER_CC_ESCAPE_ANALYSIS_H
+
+#include "env.h"
+#include "visitor.h"
+#include "../utils/source_loc.h"
+
+#include <ostream>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief finds the variables that escape: the `var` declarations,
+ * function and method parameters, `self` and `for` indices used from a
+ * function nested in the one that declares them. Only those need a slot
+ * in the frame that a static link reaches, the others can live in
+ * registers.
+ *
+ * A name binds the way the checker binds it, so the tree should check.
+ * The initial values of the attributes of a class are for its objects,
+ * which may be made in any function: they are analyzed as a function of
+ * their own, nested where the class is declared, and so are its methods.
+ */
+class EscapeAnalysis: public Visitor {
+public:
+    // the variables a function declares, not counting those of the
+    // functions in it
+    struct Frame {
+        // the function, method or class, invalid for the program itself
+        Symbol name;
+        SourceLoc loc;
+        u32 variables;
+        u32 escaping;
+    };
+
+    explicit EscapeAnalysis(const SymbolPool &symbols);
+
+    void Analyze(AstNodePtr root);
+
+    bool Escapes(VarDecPtr var) const {
+        return escaping_.count(var) != 0;
+    }
+
+    bool Escapes(ForStmtPtr loop) const {
+        return escaping_.count(loop) != 0;
+    }
+
+    // the parameter `i` of a function or method
+    bool Escapes(TypeFieldsPtr params, u32 i) const {
+        return escaping_.count(params->GetNames()[i]) != 0;
+    }
+
+    // `self` in `method`
+    bool Escapes(MethodDecPtr method) const {
+        return escaping_.count(method) != 0;
+    }
+
+    // the program first, then every function in the order it begins
+    const std::vector<Frame> &Frames() const {
+        return frames_;
+    }
+
+    u64 Escaping() const {
+        return escaping_.size();
+    }
+
+    // a line per frame, with the line it begins on
+    void Print(std::ostream &out, const std::string &file, const LineTable &lines) const;
+
+    void Visit(IntExprPtr node) final;
+    void Visit(StrExprPtr node) final;
+    void Visit(NilExprPtr node) final;
+    void Visit(ExprSeqPtr node) final;
+    void Visit(AssignmentPtr node) final;
+    void Visit(UnaryExprPtr node) final;
+    void Visit(ExprsPtr node) final;
+    void Visit(BinaryExprPtr node) final;
+    void Visit(ArrayCreatePtr node) final;
+    void Visit(RecordCreatePtr node) final;
+    void Visit(ObjectNewPtr node) final;
+    void Visit(MethodCallPtr node) final;
+    void Visit(FnCallPtr node) final;
+    void Visit(IfStmtPtr node) final;
+    void Visit(WhileStmtPtr node) final;
+    void Visit(ForStmtPtr node) final;
+    void Visit(BreakStmtPtr node) final;
+    void Visit(LetStmtPtr node) final;
+    void Visit(ElemPtr node) final;
+    void Visit(LvarPtr node) final;
+    void Visit(ClassFieldsPtr node) final;
+    void Visit(TypeFieldsPtr node) final;
+    void Visit(TypeDecPtr node) final;
+    void Visit(VarDecPtr node) final;
+    void Visit(DecsPtr node) final;
+    void Visit(MethodDecPtr node) final;
+    void Visit(AttrDecPtr node) final;
+    void Visit(FnDecPtr node) final;
+    void Visit(PrimDecPtr node) final;
+    void Visit(ImportDecPtr node) final;
+    void Visit(TypeAliasPtr node) final;
+    void Visit(RecordDefPtr node) final;
+    void Visit(ArrayDefPtr node) final;
+    void Visit(ClassDefPtr node) final;
+    void Visit(ClassTypeDefPtr node) final;
+
+private:
+    // what a name in an expression is bound to
+    struct Binding {
+        // the node that declares the variable, nullptr for a function
+        const void *decl;
+        // functions around the declaration
+        u32 level;
+        // index of the frame that declares it
+        u32 frame;
+    };
+
+    void Declare(Symbol name, const void *decl);
+    void Use(Symbol name);
+    // a frame one level in, the frame it is in comes back
+    u32 EnterFrame(Symbol name, SourceLoc loc);
+    void LeaveFrame(u32 outer);
+    void Function(IdPtr name, TypeFieldsPtr params, ExprPtr body, MethodDecPtr method);
+    void Class(IdPtr name, ClassFieldsPtr fields);
+
+private:
+    Symbol self_;
+    EnvTable<const Binding> env_;
+    // bindings live here, the table only borrows them
+    Arena bindings_;
+    std::vector<Frame> frames_;
+    // the declarations of the variables that escape
+    std::unordered_set<const void *> escaping_;
+    // functions around the node visited, and the frame of the innermost
+    u32 level_ {0};
+    u32 frame_ {0};
+    // the name of the type declaration visited
+    IdPtr declaring_ {nullptr};
+};
+
+#endif // TIGER_CC_ESCAPE_ANALYSIS_H
@@ -0,0 +1,521 @@
+#include "flat_ast.h"
+
+#include <cstring>
+
+using Kind = FlatAst::Kind;
+
+static const char *KIND_NAMES[] = {
+    "List",
+    "Id", "TypeId", "Op", "NilExpr", "IntExpr", "StrExpr", "BreakExpr", "ImportDec",
+    "BinaryExpr", "UnaryExpr", "ArrayCreate", "RecordCreate", "Elem", "Lvar",
+    "ObjectNew", "FnCall", "MethodCall", "Exprs", "ExprsExpr", "AssignExpr",
+    "IfExpr", "WhileExpr", "ForExpr", "LetExpr",
+    "Decs", "TypeDec", "ClassDef", "VarDec", "FnDec", "PrimDec",
+    "ClassFields", "AttrDec", "MethodDec",
+    "TypeAlias", "RecordDef", "ArrayDef", "ClassTypeDef", "TypeFields",
+};
+
+static_assert(sizeof(KIND_NAMES) / sizeof(KIND_NAMES[0])
+        == static_cast<size_t>(Kind::TYPE_FIELDS) + 1);
+
+const char *FlatAst::KindName(Kind kind) {
+    return KIND_NAMES[static_cast<u8>(kind)];
+}
+
+FlatAst FlatAst::Build(AstNodePtr root) {
+    auto builder = FlatAstBuilder();
+    if (root != nullptr) {
+        root->Flatten(builder);
+    }
+    return builder.Finish();
+}
+
+FlatAstBuilder::FlatAstBuilder() = default;
+
+u32 FlatAstBuilder::AddSym(Symbol symbol) {
+    auto id = symbol.Id();
+    if (id >= local_.size()) {
+        local_.resize(id + 1);
+    }
+    if (local_[id] == 0) {
+        symbols_.push_back(symbol);
+        local_[id] = static_cast<u32>(symbols_.size());
+    }
+    return local_[id] - 1;
+}
+
+// the builder itself becomes the storage the views point into
+FlatAst FlatAstBuilder::Finish() {
+    auto storage = std::make_shared<FlatAstBuilder>(std::move(*this));
+    auto &b = *storage;
+    auto flat = FlatAst();
+    flat.kinds_ = Span<const Kind>(b.kinds_.data(), b.kinds_.size());
+    flat.payloads_ = Span<const u32>(b.payloads_.data(), b.payloads_.size());
+    flat.locs_ = Span<const SourceLoc>(b.locs_.data(), b.locs_.size());
+    flat.firsts_ = Span<const u32>(b.firsts_.data(), b.firsts_.size());
+    flat.counts_ = Span<const u32>(b.counts_.data(), b.counts_.size());
+    flat.children_ = Span<const u32>(b.children_.data(), b.children_.size());
+    flat.ints_ = Span<const i64>(b.ints_.data(), b.ints_.size());
+    flat.strings_ = Span<const u32>(b.strings_.data(), b.strings_.size());
+    flat.chars_ = b.chars_;
+    flat.symbols_ = b.symbols_;
+    flat.storage_ = std::move(storage);
+    return flat;
+}
+
+/**
+ * image layout: the header, then each array in the order below, every
+ * one starting at a multiple of 8 bytes. Symbols are stored by name.
+ */
+namespace {
+
+constexpr char IMAGE_MAGIC[8] = {'T', 'I', 'G', 'E', 'R', 'A', 'S', 'T'};
+
+struct ImageHeader {
+    char magic[8];
+    u64 key;
+    u32 nodes;
+    u32 children;
+    u32 ints;
+    u32 strings;
+    u32 chars;
+    u32 symbols;
+    u32 symbol_chars;
+    u32 reserved;
+};
+
+size_t Align8(size_t n) {
+    return (n + 7) & ~size_t(7);
+}
+
+void Put(std::string &out, const void *data, size_t size) {
+    out.resize(Align8(out.size()));
+    out.append(static_cast<const char *>(data), size);
+}
+
+template <typename T>
+void Put(std::string &out, Span<const T> items) {
+    Put(out, items.begin(), sizeof(T) * items.size());
+}
+
+// reads the arrays back in order, as views into the image
+class ImageReader {
+public:
+    explicit ImageReader(std::string_view image): image_(image) {}
+
+    template <typename T>
+    Span<const T> Take(u64 n) {
+        auto at = Align8(pos_);
+        if (at > image_.size() || n * sizeof(T) > image_.size() - at) {
+            ok_ = false;
+            return Span<const T>();
+        }
+        pos_ = at + n * sizeof(T);
+        return Span<const T>(reinterpret_cast<const T *>(image_.data() + at), static_cast<u32>(n));
+    }
+
+    bool Ok() const {
+        return ok_ && pos_ == image_.size();
+    }
+
+private:
+    std::string_view image_;
+    size_t pos_ {sizeof(ImageHeader)};
+    bool ok_ {true};
+};
+
+// offsets start at 0, never decrease and stay inside `chars`
+bool CheckOffsets(Span<const u32> offsets, size_t chars) {
+    if (offsets.empty() || offsets[0] != 0) {
+        return false;
+    }
+    for (u32 i = 1; i < offsets.size(); ++i) {
+        if (offsets[i] < offsets[i - 1]) {
+            return false;
+        }
+    }
+    return offsets.back() <= chars;
+}
+
+}
+
+std::string FlatAst::Serialize(u64 key) const {
+    auto names = std::string();
+    auto offsets = std::vector<u32>{0};
+    for (auto symbol : symbols_) {
+        names += symbol.Name();
+        offsets.push_back(static_cast<u32>(names.size()));
+    }
+
+    auto header = ImageHeader{};
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.key = key;
+    header.nodes = Size();
+    header.children = children_.size();
+    header.ints = ints_.size();
+    header.strings = strings_.size();
+    header.chars = static_cast<u32>(chars_.size());
+    header.symbols = static_cast<u32>(symbols_.size());
+    header.symbol_chars = static_cast<u32>(names.size());
+
+    auto out = std::string();
+    Put(out, &header, sizeof(header));
+    Put(out, kinds_);
+    Put(out, payloads_);
+    Put(out, locs_);
+    Put(out, firsts_);
+    Put(out, counts_);
+    Put(out, children_);
+    Put(out, ints_);
+    Put(out, strings_);
+    Put(out, chars_.data(), chars_.size());
+    Put(out, offsets.data(), sizeof(u32) * offsets.size());
+    Put(out, names.data(), names.size());
+    out.resize(Align8(out.size()));
+    return out;
+}
+
+std::optional<FlatAst> FlatAst::Load(SourceBuffer image, u64 key, SymbolPool &symbols) {
+    auto storage = std::make_shared<SourceBuffer>(std::move(image));
+    auto bytes = storage->View();
+    auto header = ImageHeader{};
+    if (bytes.size() < sizeof(header)) {
+        return std::nullopt;
+    }
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 || header.key != key) {
+        return std::nullopt;
+    }
+
+    auto reader = ImageReader(bytes);
+    auto flat = FlatAst();
+    flat.kinds_ = reader.Take<Kind>(header.nodes);
+    flat.payloads_ = reader.Take<u32>(header.nodes);
+    flat.locs_ = reader.Take<SourceLoc>(header.nodes);
+    flat.firsts_ = reader.Take<u32>(header.nodes);
+    flat.counts_ = reader.Take<u32>(header.nodes);
+    flat.children_ = reader.Take<u32>(header.children);
+    flat.ints_ = reader.Take<i64>(header.ints);
+    flat.strings_ = reader.Take<u32>(header.strings);
+    auto chars = reader.Take<char>(header.chars);
+    auto offsets = reader.Take<u32>(u64(header.symbols) + 1);
+    auto names = reader.Take<char>(header.symbol_chars);
+    reader.Take<char>(0); // padding after the last array
+    if (!reader.Ok() || !CheckOffsets(offsets, names.size())) {
+        return std::nullopt;
+    }
+    flat.chars_ = std::string_view(chars.begin(), chars.size());
+
+    flat.symbols_.reserve(header.symbols);
+    for (u32 i = 0; i < header.symbols; ++i) {
+        auto name = std::string_view(names.begin() + offsets[i], offsets[i + 1] - offsets[i]);
+        flat.symbols_.push_back(symbols.Intern(name));
+    }
+    flat.storage_ = std::move(storage);
+    if (!flat.Check()) {
+        return std::nullopt;
+    }
+    return flat;
+}
+
+// every index stays in bounds and children come after their parent,
+// so walking a loaded image can neither read wild nor loop
+bool FlatAst::Check() const {
+    if (!CheckOffsets(strings_, chars_.size())) {
+        return false;
+    }
+    for (u32 n = 0; n < Size(); ++n) {
+        if (u64(firsts_[n]) + counts_[n] > children_.size()) {
+            return false;
+        }
+        for (auto child : Children(n)) {
+            if (child != NONE && (child <= n || child >= Size())) {
+                return false;
+            }
+        }
+        auto payload = payloads_[n];
+        switch (kinds_[n]) {
+            case Kind::ID:
+            case Kind::TYPE_ID:
+                if (payload >= symbols_.size()) {
+                    return false;
+                }
+                break;
+            case Kind::INT:
+                if (payload >= ints_.size()) {
+                    return false;
+                }
+                break;
+            case Kind::OP:
+                if (payload > static_cast<u32>(Op::OR)) {
+                    return false;
+                }
+                break;
+            case Kind::STR:
+            case Kind::IMPORT_DEC:
+                if (u64(payload) + 1 >= strings_.size()) {
+                    return false;
+                }
+                break;
+            default:
+                if (kinds_[n] > Kind::TYPE_FIELDS) {
+                    return false;
+                }
+        }
+    }
+    return true;
+}
+
+std::string FlatAst::ToString() const {
+    auto out = std::string();
+    if (Size() != 0) {
+        ToString(0, 0, out);
+    }
+    return out;
+}
+
+void FlatAst::ToString(u32 node, u32 depth, std::string &out) const {
+    out.append(depth, ' ');
+    out += KindName(GetKind(node));
+    switch (GetKind(node)) {
+        case Kind::ID:
+        case Kind::TYPE_ID:
+            out += " " + std::string(Sym(node).Name());
+            break;
+        case Kind::INT:
+            out += " " + std::to_string(Int(node));
+            break;
+        case Kind::OP:
+            out += " " + std::string(Operator::Spelling(GetOp(node)));
+            break;
+        case Kind::STR:
+        case Kind::IMPORT_DEC:
+            out += " " + std::string(Str(node));
+            break;
+        default:
+            break;
+    }
+    out += "\n";
+    for (auto child : Children(node)) {
+        if (child == NONE) {
+            out.append(depth + 1, ' ');
+            out += "-\n";
+        } else {
+            ToString(child, depth + 1, out);
+        }
+    }
+}
+
+void AstWriter::Write(const FlatAst &flat) {
+    if (flat.Size() != 0) {
+        WriteFlat(flat, 0);
+    } else {
+        Field(static_cast<const AstNode *>(nullptr));
+    }
+    if (format_ == Format::SEXPR) {
+        out_ << '\n';
+    }
+}
+
+// mirrors the Write methods of the tree nodes, child by child
+void AstWriter::WriteFlat(const FlatAst &flat, u32 node) {
+    if (node == FlatAst::NONE) {
+        Field(static_cast<const AstNode *>(nullptr));
+        return;
+    }
+
+    auto kind = flat.GetKind(node);
+    auto children = flat.Children(node);
+    if (kind == Kind::LIST) {
+        if (format_ == Format::SEXPR) {
+            out_ << '[';
+        }
+        for (u32 i = 0; i < children.size(); ++i) {
+            if (i != 0 && format_ == Format::SEXPR) {
+                out_ << ' ';
+            }
+            WriteFlat(flat, children[i]);
+        }
+        if (format_ == Format::SEXPR) {
+            out_ << ']';
+        }
+        return;
+    }
+
+    auto name = FlatAst::KindName(kind);
+    switch (kind) {
+        case Kind::ID:
+        case Kind::TYPE_ID:
+            Node(name, flat.Sym(node));
+            break;
+        case Kind::INT:
+            Node(name, flat.Int(node));
+            break;
+        case Kind::OP:
+            Node(name, Operator::Spelling(flat.GetOp(node)));
+            break;
+        case Kind::STR:
+        case Kind::IMPORT_DEC:
+            Node(name, flat.Str(node));
+            break;
+        default:
+            Open(name, children.empty());
+            for (auto child : children) {
+                Separate();
+                WriteFlat(flat, child);
+            }
+            Close(children.empty());
+    }
+}
+
+u32 Identifier::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::ID, Loc(), flat.AddSym(name_));
+}
+
+u32 Operator::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::OP, SourceLoc(), static_cast<u32>(op_));
+}
+
+u32 TypeId::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::TYPE_ID, Loc(), flat.AddSym(name_));
+}
+
+u32 BinaryExpr::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::BINARY, Loc(), &op_, lhs_, rhs_);
+}
+
+u32 NilExpr::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::NIL, Loc());
+}
+
+u32 IntExpr::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::INT, Loc(), flat.AddInt(num_));
+}
+
+u32 UnaryExpr::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::UNARY, Loc(), &op_, expr_);
+}
+
+u32 StrExpr::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::STR, Loc(), flat.AddStr(str_));
+}
+
+u32 ArrayCreate::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::ARRAY_CREATE, Loc(), type_id_, len_, init_);
+}
+
+u32 RecordCreate::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::RECORD_CREATE, Loc(), type_id_, types_, vars_);
+}
+
+u32 Elem::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::ELEM, Loc(), name_, idxs_);
+}
+
+u32 Lvar::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::LVAR, Loc(), elems_);
+}
+
+u32 ObjectNew::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::OBJECT_NEW, Loc(), type_);
+}
+
+u32 FnCall::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::FN_CALL, Loc(), name_, args_);
+}
+
+u32 MethodCall::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::METHOD_CALL, Loc(), lvar_, method_, args_);
+}
+
+u32 Exprs::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::EXPRS, Loc(), exprs_);
+}
+
+u32 ExprSeq::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::EXPR_SEQ, Loc(), exprs_);
+}
+
+u32 Assignment::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::ASSIGN, Loc(), lval_, expr_);
+}
+
+u32 IfStmt::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::IF, Loc(), if_, then_, else_);
+}
+
+u32 WhileStmt::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::WHILE, Loc(), while_, do_);
+}
+
+u32 ForStmt::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::FOR, Loc(), id_, from_, to_, do_);
+}
+
+u32 BreakStmt::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::BREAK, Loc());
+}
+
+u32 LetStmt::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::LET, Loc(), decs_, exprs_);
+}
+
+u32 Decs::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::DECS, Loc(), decs_);
+}
+
+u32 TypeDec::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::TYPE_DEC, Loc(), name_, type_);
+}
+
+u32 ClassDef::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::CLASS_DEF, Loc(), name_, parent_, fields_);
+}
+
+u32 VarDec::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::VAR_DEC, Loc(), name_, type_, var_);
+}
+
+u32 FnDec::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::FN_DEC, Loc(), name_, args_, ret_, body_);
+}
+
+u32 PrimDec::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::PRIM_DEC, Loc(), name_, args_, ret_);
+}
+
+u32 ImportDec::Flatten(FlatAstBuilder &flat) {
+    return flat.Leaf(Kind::IMPORT_DEC, Loc(), flat.AddStr(import_));
+}
+
+u32 ClassFields::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::CLASS_FIELDS, Loc(), fields_);
+}
+
+u32 AttrDec::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::ATTR_DEC, Loc(), attr_);
+}
+
+u32 MethodDec::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::METHOD_DEC, Loc(), name_, args_, ret_, body_);
+}
+
+u32 TypeAlias::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::TYPE_ALIAS, Loc(), alias_);
+}
+
+u32 RecordDef::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::RECORD_DEF, Loc(), records_);
+}
+
+u32 ArrayDef::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::ARRAY_DEF, Loc(), type_);
+}
+
+u32 ClassTypeDef::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::CLASS_TYPE_DEF, Loc(), parent_, fields_);
+}
+
+u32 TypeFields::Flatten(FlatAstBuilder &flat) {
+    return flat.Node(Kind::TYPE_FIELDS, Loc(), names_, types_);
+}
@@ -0,0 +1,250 @@
+#ifndef TIGER_CC_FLAT_AST_H
+#define TIGER_CC_FLAT_AST_H
+
+#include "ast.h"
+#include "../utils/source_buffer.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief the ast as parallel arrays. A node is an index into `kinds_`,
+ * `payloads_`, `firsts_` and `counts_`; its children are the `counts_`
+ * indices starting at `children_[firsts_]`, one per field of the tree
+ * node in declaration order, NONE for a missing one. A list field is a
+ * LIST node holding the elements.
+ *
+ * Nodes are numbered in preorder, so a pass walking the tree in source
+ * order also walks these arrays front to back. `locs_` keeps the
+ * SourceLoc of every node; LIST and OP nodes have none, an operator is
+ * located at its BINARY or UNARY parent. Leaves keep their value
+ * in the payload: an index into the symbol table for ID and TYPE_ID, an
+ * index into the literal tables for INT, STR and IMPORT_DEC, the Op
+ * itself for OP.
+ *
+ * The arrays are read-only views, either over the builder's vectors or
+ * straight over a mapped image written by Serialize, so loading an image
+ * costs one pass to check it and one Intern per distinct name.
+ */
+class FlatAst {
+public:
+    static constexpr u32 NONE = ~0u;
+
+    enum class Kind: u8 {
+        LIST,
+        // leaves
+        ID,
+        TYPE_ID,
+        OP,
+        NIL,
+        INT,
+        STR,
+        BREAK,
+        IMPORT_DEC,
+        // expressions
+        BINARY,
+        UNARY,
+        ARRAY_CREATE,
+        RECORD_CREATE,
+        ELEM,
+        LVAR,
+        OBJECT_NEW,
+        FN_CALL,
+        METHOD_CALL,
+        EXPRS,
+        EXPR_SEQ,
+        ASSIGN,
+        IF,
+        WHILE,
+        FOR,
+        LET,
+        // declarations
+        DECS,
+        TYPE_DEC,
+        CLASS_DEF,
+        VAR_DEC,
+        FN_DEC,
+        PRIM_DEC,
+        CLASS_FIELDS,
+        ATTR_DEC,
+        METHOD_DEC,
+        // types
+        TYPE_ALIAS,
+        RECORD_DEF,
+        ARRAY_DEF,
+        CLASS_TYPE_DEF,
+        TYPE_FIELDS,
+    };
+
+    static const char *KindName(Kind kind);
+
+    // flatten the tree under `root`, which becomes node 0
+    static FlatAst Build(AstNodePtr root);
+
+    // the image of this ast, tagged with `key`
+    std::string Serialize(u64 key) const;
+
+    // view an image made by Serialize(key), interning its names into
+    // `symbols`. nullopt if the image is damaged or has another key.
+    static std::optional<FlatAst> Load(SourceBuffer image, u64 key, SymbolPool &symbols);
+
+    u32 Size() const {
+        return kinds_.size();
+    }
+
+    Kind GetKind(u32 node) const {
+        return kinds_[node];
+    }
+
+    u32 Payload(u32 node) const {
+        return payloads_[node];
+    }
+
+    SourceLoc Loc(u32 node) const {
+        return locs_[node];
+    }
+
+    Span<const u32> Children(u32 node) const {
+        return Span<const u32>(children_.begin() + firsts_[node], counts_[node]);
+    }
+
+    Symbol Sym(u32 node) const {
+        return symbols_[payloads_[node]];
+    }
+
+    Op GetOp(u32 node) const {
+        return static_cast<Op>(payloads_[node]);
+    }
+
+    i64 Int(u32 node) const {
+        return ints_[payloads_[node]];
+    }
+
+    std::string_view Str(u32 node) const {
+        auto i = payloads_[node];
+        return chars_.substr(strings_[i], strings_[i + 1] - strings_[i]);
+    }
+
+    // one node per line, indented by depth
+    std::string ToString() const;
+
+private:
+    friend class FlatAstBuilder;
+
+    void ToString(u32 node, u32 depth, std::string &out) const;
+    bool Check() const;
+
+private:
+    Span<const Kind> kinds_;
+    Span<const u32> payloads_;
+    Span<const SourceLoc> locs_;
+    Span<const u32> firsts_;
+    Span<const u32> counts_;
+    Span<const u32> children_;
+
+    Span<const i64> ints_;
+    // string i is chars_[strings_[i], strings_[i + 1])
+    Span<const u32> strings_;
+    std::string_view chars_;
+
+    // symbol table of this ast, in the pool of the current compilation
+    std::vector<Symbol> symbols_;
+
+    // what the views above point into, builder vectors or an image
+    std::shared_ptr<const void> storage_;
+};
+
+/**
+ * @brief appends nodes for AstNode::Flatten.
+ */
+class FlatAstBuilder {
+public:
+    using Kind = FlatAst::Kind;
+
+    FlatAstBuilder();
+
+    FlatAst Finish();
+
+    u32 Leaf(Kind kind, SourceLoc loc, u32 payload = 0) {
+        auto node = static_cast<u32>(kinds_.size());
+        kinds_.push_back(kind);
+        payloads_.push_back(payload);
+        locs_.push_back(loc);
+        firsts_.push_back(0);
+        counts_.push_back(0);
+        return node;
+    }
+
+    u32 AddInt(i64 value) {
+        ints_.push_back(value);
+        return static_cast<u32>(ints_.size() - 1);
+    }
+
+    u32 AddStr(std::string_view s) {
+        chars_ += s;
+        strings_.push_back(static_cast<u32>(chars_.size()));
+        return static_cast<u32>(strings_.size() - 2);
+    }
+
+    // index of `symbol` in the ast's own symbol table
+    u32 AddSym(Symbol symbol);
+
+    // a node with one child per field, flattened left to right
+    template <typename... Fields>
+    u32 Node(Kind kind, SourceLoc loc, Fields... fields) {
+        auto node = Leaf(kind, loc);
+        u32 slots[] = {Slot(fields)..., FlatAst::NONE};
+        SetChildren(node, slots, sizeof...(fields));
+        return node;
+    }
+
+private:
+    template <typename T>
+    u32 Slot(T *child) {
+        return child != nullptr ? child->Flatten(*this) : FlatAst::NONE;
+    }
+
+    template <typename T>
+    u32 Slot(Span<T> list) {
+        auto node = Leaf(Kind::LIST, SourceLoc());
+        // nested lists push above `base` and pop back to it
+        auto base = scratch_.size();
+        for (auto child : list) {
+            auto slot = Slot(child);
+            scratch_.push_back(slot);
+        }
+        SetChildren(node, scratch_.data() + base, list.size());
+        scratch_.resize(base);
+        return node;
+    }
+
+    void SetChildren(u32 node, const u32 *slots, u32 n) {
+        firsts_[node] = static_cast<u32>(children_.size());
+        counts_[node] = n;
+        children_.insert(children_.end(), slots, slots + n);
+    }
+
+private:
+    friend class FlatAst;
+
+    std::vector<Kind> kinds_;
+    std::vector<u32> payloads_;
+    std::vector<SourceLoc> locs_;
+    std::vector<u32> firsts_;
+    std::vector<u32> counts_;
+    std::vector<u32> children_;
+
+    std::vector<i64> ints_;
+    std::vector<u32> strings_ {0};
+    std::string chars_;
+
+    std::vector<Symbol> symbols_;
+    // pool id -> index in symbols_ + 1, 0 if not added yet
+    std::vector<u32> local_;
+    std::vector<u32> scratch_;
+};
+
+#endif // TIGER_CC_FLAT_AST_H
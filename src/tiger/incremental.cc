@@ -0,0 +1,390 @@
+#include "incremental.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Shift of every node: its own loc, then every field that is a node
+// or a list of nodes. Operators have no loc of their own.
+
+static void ShiftAll(i32) {}
+
+template <typename T, typename... Rest>
+static void ShiftAll(i32 delta, T *node, Rest... rest);
+
+template <typename T, typename... Rest>
+static void ShiftAll(i32 delta, Span<T> nodes, Rest... rest);
+
+template <typename T, typename... Rest>
+static void ShiftAll(i32 delta, T *node, Rest... rest) {
+    if (node != nullptr) {
+        node->Shift(delta);
+    }
+    ShiftAll(delta, rest...);
+}
+
+template <typename T, typename... Rest>
+static void ShiftAll(i32 delta, Span<T> nodes, Rest... rest) {
+    for (auto node : nodes) {
+        if (node != nullptr) {
+            node->Shift(delta);
+        }
+    }
+    ShiftAll(delta, rest...);
+}
+
+void Identifier::Shift(i32 delta) {
+    ShiftLoc(delta);
+}
+
+void TypeId::Shift(i32 delta) {
+    ShiftLoc(delta);
+}
+
+void BinaryExpr::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, lhs_, rhs_);
+}
+
+void NilExpr::Shift(i32 delta) {
+    ShiftLoc(delta);
+}
+
+void IntExpr::Shift(i32 delta) {
+    ShiftLoc(delta);
+}
+
+void UnaryExpr::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, expr_);
+}
+
+void StrExpr::Shift(i32 delta) {
+    ShiftLoc(delta);
+}
+
+void ArrayCreate::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, type_id_, len_, init_);
+}
+
+void RecordCreate::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, type_id_, types_, vars_);
+}
+
+void Elem::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, idxs_);
+}
+
+void Lvar::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, elems_);
+}
+
+void ObjectNew::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, type_);
+}
+
+void FnCall::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, args_);
+}
+
+void MethodCall::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, lvar_, method_, args_);
+}
+
+void Exprs::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, exprs_);
+}
+
+void ExprSeq::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, exprs_);
+}
+
+void Assignment::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, lval_, expr_);
+}
+
+void IfStmt::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, if_, then_, else_);
+}
+
+void WhileStmt::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, while_, do_);
+}
+
+void ForStmt::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, id_, from_, to_, do_);
+}
+
+void BreakStmt::Shift(i32 delta) {
+    ShiftLoc(delta);
+}
+
+void LetStmt::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, decs_, exprs_);
+}
+
+void Decs::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, decs_);
+}
+
+void TypeDec::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, type_);
+}
+
+void ClassDef::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, parent_, fields_);
+}
+
+void VarDec::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, type_, var_);
+}
+
+void FnDec::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, args_, ret_, body_);
+}
+
+void PrimDec::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, args_, ret_);
+}
+
+void ImportDec::Shift(i32 delta) {
+    ShiftLoc(delta);
+}
+
+void ClassFields::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, fields_);
+}
+
+void AttrDec::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, attr_);
+}
+
+void MethodDec::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, name_, args_, ret_, body_);
+}
+
+void TypeAlias::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, alias_);
+}
+
+void RecordDef::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, records_);
+}
+
+void ArrayDef::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, type_);
+}
+
+void ClassTypeDef::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, parent_, fields_);
+}
+
+void TypeFields::Shift(i32 delta) {
+    ShiftLoc(delta);
+    ShiftAll(delta, names_, types_);
+}
+
+IncrementalParser::IncrementalParser(std::string text, SymbolPool &symbols, std::string name):
+    text_(std::move(text)),
+    name_(std::move(name)),
+    symbols_(symbols),
+    tokens_(text_),
+    diags_(text_, name_) {
+    auto lexer = Lexer(text_, symbols_);
+    lexer.GetAllTokens();
+    tokens_ = std::move(lexer.arena_);
+    ParseAll();
+}
+
+void IncrementalParser::ParseAll() {
+    nodes_ = Arena();
+    diags_ = Diagnostics(text_, name_);
+    ast_ = Parser(tokens_, nodes_, &diags_).ParseResult();
+    live_ = nodes_.Reserved();
+}
+
+void IncrementalParser::Apply(const TextEdit &edit) {
+    assert(edit.offset + edit.removed <= text_.size());
+    auto delta = static_cast<i32>(edit.inserted.size()) - static_cast<i32>(edit.removed);
+    auto clean = !diags_.HasErrors();
+    text_.replace(edit.offset, edit.removed, edit.inserted);
+
+    stats_ = Stats{};
+    auto [begin, end] = Relex(edit, delta);
+    // the old nodes stay in the arena, start over once they outweigh
+    // the live ones
+    if (clean && nodes_.Reserved() <= 2 * live_ + Arena::BLOCK_SIZE) {
+        diags_ = Diagnostics(text_, name_);
+        if (Reparse(begin, end, delta)) {
+            return;
+        }
+    }
+    ParseAll();
+    stats_.full = true;
+}
+
+// relex from the first token the edit touches until a new token starts
+// where an old one behind the edit did, from there on the text and so
+// the tokens are the same as before. The damaged range, [begin, end)
+// in old offsets.
+std::pair<u32, u32> IncrementalParser::Relex(const TextEdit &edit, i32 delta) {
+    auto &old = tokens_.Tokens();
+    auto old_size = static_cast<u32>(text_.size() - delta);
+    auto edit_end_old = edit.offset + edit.removed;
+    auto edit_end_new = static_cast<u32>(edit.offset + edit.inserted.size());
+
+    // a token ending right where the edit begins may grow into it
+    auto first = static_cast<u32>(std::partition_point(old.begin(), old.end(), [&](const Token &t) {
+        return t.Offset() + t.Length() < edit.offset;
+    }) - old.begin());
+    auto begin = first < old.size() ? std::min(old[first].Offset(), edit.offset) : edit.offset;
+    // candidates to line up with, the old tokens behind the edit
+    auto next = static_cast<u32>(std::partition_point(old.begin() + first, old.end(), [&](const Token &t) {
+        return t.Offset() < edit_end_old;
+    }) - old.begin());
+
+    auto lexer = Lexer(text_, symbols_, begin);
+    auto tokens = TokenVec();
+    auto last = static_cast<u32>(old.size());
+    while (auto token = lexer.GetNextToken()) {
+        auto offset = token->Offset();
+        if (offset >= edit_end_new) {
+            while (next < old.size() && static_cast<i64>(old[next].Offset()) + delta < offset) {
+                ++next;
+            }
+            if (next < old.size() && static_cast<i64>(old[next].Offset()) + delta == offset) {
+                last = next;
+                break;
+            }
+        }
+        if (token->Type() == Token::Tag::STR) {
+            auto slot = tokens_.AddLiteral(std::move(lexer.arena_.Literal(token->Slot())));
+            token = Token(token->Type(), offset, token->Length(), slot);
+        }
+        tokens.push_back(*token);
+    }
+
+    auto end = last < old.size() ? old[last].Offset() : old_size;
+    stats_.relexed = static_cast<u32>(tokens.size());
+    tokens_.Splice(text_, first, last, tokens, delta);
+    return {begin, end};
+}
+
+// parse the top level declarations again from the one before the
+// damage [begin, end), and take the old ones back as soon as the parser
+// reaches one behind the damage. False if this edit needs a full parse.
+bool IncrementalParser::Reparse(u32 begin, u32 end, i32 delta) {
+    auto let = dynamic_cast<LetStmtPtr>(ast_);
+    auto decs = let != nullptr ? let->GetDecs() : dynamic_cast<DecsPtr>(ast_);
+    if (decs == nullptr) {
+        return false;
+    }
+
+    auto &old = decs->GetDecs();
+    auto starts_before = [&](DecPtr dec, u32 offset) {
+        return dec->Loc().Offset() < offset;
+    };
+    // the damaged declaration is the last one starting at or before
+    // `begin`; the one in front of it looked at its first token when it
+    // decided where to stop, so it is parsed again too
+    auto damaged = static_cast<u32>(std::partition_point(old.begin(), old.end(), [&](DecPtr dec) {
+        return dec->Loc().Offset() <= begin;
+    }) - old.begin());
+    if (damaged == 0) {
+        return false;
+    }
+    auto from = damaged >= 2 ? damaged - 2 : 0;
+
+    auto &tokens = tokens_.Tokens();
+    auto start = old[from]->Loc().Offset();
+    auto index = static_cast<u32>(std::partition_point(tokens.begin(), tokens.end(), [&](const Token &t) {
+        return t.Offset() < start;
+    }) - tokens.begin());
+
+    auto parser = Parser(tokens_, nodes_, &diags_);
+    parser.Rewind(index);
+    auto list = std::vector<DecPtr>(old.begin(), old.begin() + from);
+    stats_.reused = from;
+    auto end_new = static_cast<i64>(end) + delta;
+    auto resumed = false;
+    try {
+        for (auto curr = parser.CurrToken(); curr != nullptr && Parser::IsDecStart(curr->Type()); curr = parser.CurrToken()) {
+            if (curr->Offset() >= end_new) {
+                auto offset = static_cast<u32>(curr->Offset() - delta);
+                auto it = std::lower_bound(old.begin() + from, old.end(), offset, starts_before);
+                if (it != old.end() && (*it)->Loc().Offset() == offset) {
+                    for (; it != old.end(); ++it) {
+                        (*it)->Shift(delta);
+                        list.push_back(*it);
+                        ++stats_.reused;
+                    }
+                    resumed = true;
+                    break;
+                }
+            }
+            try {
+                list.push_back(parser.ParseDec());
+                ++stats_.reparsed;
+            } catch (const Parser::SyntaxError &) {
+                parser.Synchronize(true);
+            }
+        }
+
+        auto new_decs = parser.Make<Decs>(decs->Loc(), nodes_.Copy(list));
+        auto exprs = let != nullptr ? let->GetExprs() : nullptr;
+        if (resumed) {
+            // everything behind the declarations is as before
+            ShiftAll(delta, exprs);
+        } else if (let != nullptr) {
+            parser.Expect(Token::Tag::IN);
+            auto curr = parser.CurrToken();
+            if (curr != nullptr && curr->Offset() >= end_new) {
+                exprs->Shift(delta);
+            } else {
+                exprs = parser.ParseExprs();
+                parser.Expect(Token::Tag::END);
+                // `let ... end` may have become the operand of something
+                if (parser.CurrToken() != nullptr) {
+                    return false;
+                }
+            }
+        } else if (parser.CurrToken() != nullptr) {
+            return false;
+        }
+
+        if (let != nullptr) {
+            ast_ = parser.Make<LetStmt>(let->Loc(), new_decs, exprs);
+        } else {
+            ast_ = new_decs;
+        }
+        return true;
+    } catch (const Parser::SyntaxError &) {
+        return false;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef TIGER_CC_INCREMENTAL_H
+#define TIGER_CC_INCREMENTAL_H
+
+#include "parser.h"
+#include "../utils/diagnostics.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+// replace `removed` bytes at `offset` with `inserted`
+struct TextEdit {
+    u32 offset;
+    u32 removed;
+    std::string inserted;
+};
+
+/**
+ * @brief keeps the text, tokens and ast of one file up to date across
+ * edits, for editors and watch mode.
+ *
+ * An edit is relexed from the first token it touches until a new token
+ * starts where an old one did, the old tokens after that only move.
+ * Then the top level declarations, of a `let` program or of a program
+ * of declarations, are parsed again from the one before the damage
+ * until the parser gets to where an old declaration behind the damage
+ * started. That declaration, the ones after it and the body of the let
+ * are kept, moved by Shift.
+ *
+ * An edit in front of the first declaration, a program of another
+ * shape or a previous version with syntax errors is parsed from scratch,
+ * and so is any edit once the arena holds more dead nodes than live ones.
+ *
+ * The ast and tokens handed out stay valid until the next Apply.
+ */
+class IncrementalParser {
+public:
+    struct Stats {
+        // tokens scanned again
+        u32 relexed;
+        // declarations parsed again and kept
+        u32 reparsed;
+        u32 reused;
+        // the whole program was parsed again
+        bool full;
+    };
+
+    IncrementalParser(std::string text, SymbolPool &symbols, std::string name = "<input>");
+
+    void Apply(const TextEdit &edit);
+
+    std::string_view Text() const {
+        return text_;
+    }
+
+    const TokenArena &Tokens() const {
+        return tokens_;
+    }
+
+    AstNodePtr Ast() const {
+        return ast_;
+    }
+
+    const Diagnostics &Diags() const {
+        return diags_;
+    }
+
+    const Stats &LastStats() const {
+        return stats_;
+    }
+
+private:
+    void ParseAll();
+    std::pair<u32, u32> Relex(const TextEdit &edit, i32 delta);
+    bool Reparse(u32 begin, u32 end, i32 delta);
+
+private:
+    std::string text_;
+    std::string name_;
+    SymbolPool &symbols_;
+    TokenArena tokens_;
+    Arena nodes_;
+    Diagnostics diags_;
+    AstNodePtr ast_ {nullptr};
+    // arena bytes right after the last full parse
+    size_t live_ {0};
+    Stats stats_ {};
+};
+
+#endif // TIGER_CC_INCREMENTAL_H
@@ -1,79 +1,88 @@
 #include "lexer.h"
+#include "scan_kernels.h"
 #include "../utils/error.h"
 
+#include <limits>
+
 // scan the next token and return it
-Lexer::TokenPtr Lexer::GetNextToken() {
+std::optional<Token> Lexer::GetNextToken() {
     SkipSpace();
+    return ScanToken();
+}
+
+// scan the token starting at the current character
+std::optional<Token> Lexer::ScanToken() {
+    start_ = index_;
     char c = Next();
     switch (c) {
         case ',':
-            return MakeToken(Token::Tag::COMMA, ",");
+            return MakeToken(Token::Tag::COMMA);
         case ':': {
             if (Try('=')) {
-                return MakeToken(Token::Tag::ASSIGN, ":=");
+                return MakeToken(Token::Tag::ASSIGN);
             } else {
-                return MakeToken(Token::Tag::COLON, ":");
+                return MakeToken(Token::Tag::COLON);
             }
         }
         case ';':
-            return MakeToken(Token::Tag::SEMI, ";");
+            return MakeToken(Token::Tag::SEMI);
         case '(':
-            return MakeToken(Token::Tag::LPAREN, "(");
+            return MakeToken(Token::Tag::LPAREN);
         case ')':
-            return MakeToken(Token::Tag::RPAREN, ")");
+            return MakeToken(Token::Tag::RPAREN);
         case '[':
-            return MakeToken(Token::Tag::LSQUB, "[");
+            return MakeToken(Token::Tag::LSQUB);
         case ']':
-            return MakeToken(Token::Tag::RSQUB, "]");
+            return MakeToken(Token::Tag::RSQUB);
         case '{':
-            return MakeToken(Token::Tag::LBRACE, "{");
+            return MakeToken(Token::Tag::LBRACE);
         case '}':
-            return MakeToken(Token::Tag::RBRACE, "}");
+            return MakeToken(Token::Tag::RBRACE);
         case '.':
-            return MakeToken(Token::Tag::DOT, ".");
+            return MakeToken(Token::Tag::DOT);
         case '+':
-            return MakeToken(Token::Tag::PLUS, "+");
+            return MakeToken(Token::Tag::PLUS);
         case '-':
-            return MakeToken(Token::Tag::MINUS, "-");
+            return MakeToken(Token::Tag::MINUS);
         case '*':
-            return MakeToken(Token::Tag::STAR, "*");
+            return MakeToken(Token::Tag::STAR);
         case '/':
             if (Try('*')) {
                 return ScanComment();
             } else {
-                return MakeToken(Token::Tag::DIV, "/");
+                return MakeToken(Token::Tag::DIV);
             }
         case '=':
-            return MakeToken(Token::Tag::EQ, "=");
+            return MakeToken(Token::Tag::EQ);
         case '<':
             if (Try('=')) {
-                return MakeToken(Token::Tag::LEQ, "<=");
+                return MakeToken(Token::Tag::LEQ);
             } else if (Try('>')) {
-                return MakeToken(Token::Tag::NOT_EQAL, "<>");
+                return MakeToken(Token::Tag::NOT_EQAL);
             } else {
-                return MakeToken(Token::Tag::LESS, "<");
+                return MakeToken(Token::Tag::LESS);
             }
         case '>':
             if (Try('=')) {
-                return MakeToken(Token::Tag::GEQ, ">=");
+                return MakeToken(Token::Tag::GEQ);
             } else {
-                return MakeToken(Token::Tag::GREATER, ">");
+                return MakeToken(Token::Tag::GREATER);
             }
         case '&':
-            return MakeToken(Token::Tag::AND, "&");
+            return MakeToken(Token::Tag::AND);
         case '|':
-            return MakeToken(Token::Tag::OR, "|");
+            return MakeToken(Token::Tag::OR);
         case '\r':
             if (Try('\n')) {
-                return MakeToken(Token::Tag::EOL, "\r\n");
+                return MakeToken(Token::Tag::EOL);
             } else {
-                return MakeToken(Token::Tag::EOL, "\r");
+                return MakeToken(Token::Tag::EOL);
             }
         case '\n':
             if (Try('\r')) {
-                return MakeToken(Token::Tag::EOL, "\n\r");
+                return MakeToken(Token::Tag::EOL);
             } else {
-                return MakeToken(Token::Tag::EOL, "\n");
+                return MakeToken(Token::Tag::EOL);
             }
         case '"':
             return ScanString();
@@ -82,24 +91,33 @@ Lexer::TokenPtr Lexer::GetNextToken() {
         case '0' ... '9':
             return ScanNum(c);
         case '\0':
-            return nullptr;
+            return std::nullopt;
         default:
-            return MakeToken(Token::Tag::INVALID, std::to_string(c));
+            return MakeToken(Token::Tag::INVALID);
     }
 }
 
-// return current token
-Lexer::TokenPtr Lexer::GetCurrToken() {
-    return curr_token_;
+// scan the next token that matters to the parser, skipping comments
+// and line ends without storing them anywhere
+std::optional<Token> Lexer::GetNextSignificantToken() {
+    for (;;) {
+        auto token = GetNextToken();
+        if (!token
+            || (token->Type() != Token::Tag::COMMENT
+                && token->Type() != Token::Tag::EOL)) {
+            return token;
+        }
+    }
 }
 
-// get all tokens
-Lexer::TokenPtrVec Lexer::GetAllTokens() {
-    TokenPtrVec tokens;
-    while (auto ptr = GetNextToken()) {
-        tokens.push_back(ptr);
+// scan all remaining tokens into the arena
+const TokenVec &Lexer::GetAllTokens() {
+    // typical tiger code has about one token every six bytes
+    arena_.Reserve((stream_.size() - index_) / 6 + 1);
+    while (auto token = GetNextToken()) {
+        arena_.Push(*token);
     }
-    return tokens;
+    return arena_.Tokens();
 }
 
 // return current character and move index to next
@@ -114,7 +132,7 @@ char Lexer::Next() {
 // return current character
 char Lexer::Curr() {
     assert(index_ <= stream_.size());
-    return stream_[index_];
+    return index_ < stream_.size() ? stream_[index_] : '\0';
 }
 
 // judge whether current character is c
@@ -133,16 +151,29 @@ bool Lexer::Try(char c) {
     }
 }
 
+// skip the run of bytes that `kernel` accepts
+void Lexer::SkipWith(ScanKernels::Kernel kernel) {
+    auto begin = stream_.data();
+    index_ = kernel(begin + index_, begin + stream_.size()) - begin;
+}
+
 void Lexer::SkipSpace() {
-    while (Try(' ') || Try('\t'));
+    SkipWith(ScanKernels::Get().SkipBlanks);
 }
 
-Lexer::TokenPtr Lexer::MakeToken(Token::Tag tag, std::string &&var) {
-    return std::make_shared<Token>(tag, std::move(var));
+// make a token spanning from start_ to the current character
+Token Lexer::MakeToken(Token::Tag tag, u32 value) {
+    return Token(tag, static_cast<u32>(start_),
+            static_cast<u32>(index_ - start_), value);
 }
 
-Lexer::TokenPtr Lexer::MakeToken(Token::Tag tag, const std::string &var) {
-    return std::make_shared<Token>(tag, var);
+// identifiers are interned here once, later passes only see the symbol
+Token Lexer::MakeIdToken() {
+    if (symbols_ == nullptr) {
+        return MakeToken(Token::Tag::ID);
+    }
+    auto name = stream_.substr(start_, index_ - start_);
+    return MakeToken(Token::Tag::ID, symbols_->Intern(name).Id());
 }
 
 char Lexer::ParseOctNum() {
@@ -185,7 +216,7 @@ u8 Lexer::OctToDigit(char c) {
     return 0;
 }
 
-Lexer::TokenPtr Lexer::ScanId(char c) {
+Token Lexer::ScanId(char c) {
     if (c == '_') {
         return ScanMainId(c);
     } else {
@@ -193,95 +224,92 @@ Lexer::TokenPtr Lexer::ScanId(char c) {
     }
 }
 
-Lexer::TokenPtr Lexer::ScanMainId(char c) {
-    std::string trace(1, c);
-    std::string main = "main";
-    for (auto x : main) {
-        trace.push_back(x);
+Token Lexer::ScanMainId(char c) {
+    for (auto x : std::string_view("main")) {
         if (!Try(x)) {
-            return MakeToken(Token::Tag::INVALID, std::move(trace));
+            return MakeToken(Token::Tag::INVALID);
         }
     }
-    return MakeToken(Token::Tag::ID, std::move(trace));
+    return MakeIdToken();
 }
 
-Lexer::TokenPtr Lexer::ScanNormalId(char c) {
-    std::string trace(1, c);
-    while (isalnum((c = Curr())) || Is('_')) {
-        trace.push_back(c);
-        Next();
-    }
+Token Lexer::ScanNormalId(char c) {
+    SkipWith(ScanKernels::Get().SkipIdent);
+    auto trace = stream_.substr(start_, index_ - start_);
     if (auto tag = Token::IsKeyword(trace)) {
-        return MakeToken(tag.value(), std::move(trace));
+        return MakeToken(tag.value());
     }
-    return MakeToken(Token::Tag::ID, std::move(trace));
+    return MakeIdToken();
 }
 
-// tiger just support integers
-Lexer::TokenPtr Lexer::ScanNum(char c) {
-    std::string num(1, c);
-    while (isnumber(c = Curr())) {
-        num.push_back(c);
+// tiger just support integers, up to the largest int: a literal past
+// it is one invalid token, `-2147483647 - 1` is the smallest int
+Token Lexer::ScanNum(char c) {
+    constexpr u32 MAX = std::numeric_limits<i32>::max();
+    u32 num = c - '0';
+    auto overflow = false;
+    while (isdigit(c = Curr())) {
+        auto digit = static_cast<u32>(c - '0');
+        overflow = overflow || num > (MAX - digit) / 10;
+        num = overflow ? 0 : num * 10 + digit;
         Next();
     }
-    return MakeToken(Token::Tag::NUM, std::move(num));
+    return overflow ? MakeToken(Token::Tag::INVALID) : MakeToken(Token::Tag::NUM, num);
 }
 
-Lexer::TokenPtr Lexer::ScanComment() {
-    std::string comment = "/*";
-    char c;
+Token Lexer::ScanComment() {
     for (;;) {
-        while ((c = Next()) != '*') {
-            comment.push_back(c);
+        SkipWith(ScanKernels::Get().FindStar);
+        if (Next() != '*') {
+            return MakeToken(Token::Tag::INVALID);
         }
-        comment.push_back(c);
-        if (Next() == '/') {
-            comment += "/";
-            return MakeToken(Token::Tag::COMMENT, std::move(comment));
-        } else {
-            comment.push_back(c);
+        if (Try('/')) {
+            return MakeToken(Token::Tag::COMMENT);
         }
     }
 }
 
-Lexer::TokenPtr Lexer::ScanString() {
+Token Lexer::ScanString() {
     char c;
     std::string s;
-    while ((c = Next()) != '\"' && c != '\0') {
-        if (c == '\\') {
-            c = Next();
-            switch (c) {
-                case 'a':
-                    s.push_back('\a'); break;
-                case 'b':
-                    s.push_back('\b'); break;
-                case 'f':
-                    s.push_back('\f'); break;
-                case 'n':
-                    s.push_back('\n'); break;
-                case 'r':
-                    s.push_back('\r'); break;
-                case 't':
-                    s.push_back('\t'); break;
-                case 'v':
-                    s.push_back('\v'); break;
-                case 'x':
-                    s.push_back(ParseHexNum()); break;
-                case '0' ... '9':
-                    s.push_back(ParseOctNum()); break;
-                case '\\': case '\"':
-                    s.push_back(c); break;
-                default:
-                    s.push_back(c);
-                    return MakeToken(Token::Tag::INVALID, std::move(s));
-            }
-        } else {
-            s.push_back(c);
+    for (;;) {
+        // copy the plain run up to the next quote or escape at once
+        auto run = index_;
+        SkipWith(ScanKernels::Get().FindStrStop);
+        s.append(stream_.data() + run, index_ - run);
+        if ((c = Next()) == '\"' || c == '\0') {
+            break;
+        }
+        // escape sequence
+        c = Next();
+        switch (c) {
+            case 'a':
+                s.push_back('\a'); break;
+            case 'b':
+                s.push_back('\b'); break;
+            case 'f':
+                s.push_back('\f'); break;
+            case 'n':
+                s.push_back('\n'); break;
+            case 'r':
+                s.push_back('\r'); break;
+            case 't':
+                s.push_back('\t'); break;
+            case 'v':
+                s.push_back('\v'); break;
+            case 'x':
+                s.push_back(ParseHexNum()); break;
+            case '0' ... '9':
+                s.push_back(ParseOctNum()); break;
+            case '\\': case '\"':
+                s.push_back(c); break;
+            default:
+                return MakeToken(Token::Tag::INVALID);
         }
     }
     if (c == '\0') {
-        return MakeToken(Token::Tag::INVALID, "\"" + s);
+        return MakeToken(Token::Tag::INVALID);
     } else {
-        return MakeToken(Token::Tag::STR, std::move(s));
+        return MakeToken(Token::Tag::STR, arena_.AddLiteral(std::move(s)));
     }
 }
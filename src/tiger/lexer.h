@@ -2,51 +2,74 @@
 #define TIGER_CC_LEXER_H
 
 #include "token.h"
+#include "symbol.h"
+#include "scan_kernels.h"
 
-#include <memory>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 class Lexer {
 public:
-    using TokenPtr = std::shared_ptr<Token>;
-    using TokenPtrVec = std::vector<TokenPtr>;
+    friend class ParallelLexer;
+    friend class IncrementalParser;
+
 public:
-    explicit Lexer(std::string &&stream):
-        stream_(stream) {}
-    explicit Lexer(const std::string &stream):
-        stream_(stream) {}
+    // the lexer doesn't own its input, `stream` (usually a SourceBuffer)
+    // must outlive the lexer and every token scanned from it.
+    // identifiers are interned into `symbols`.
+    Lexer(std::string_view stream, SymbolPool &symbols):
+        stream_(stream), arena_(stream), symbols_(&symbols) {}
+
+    std::optional<Token> GetNextToken();
+    std::optional<Token> GetNextSignificantToken();
+    const TokenVec &GetAllTokens();
 
-    TokenPtr GetNextToken();
-    TokenPtr GetCurrToken();
-    TokenPtrVec GetAllTokens();
+    const TokenArena &Arena() const {
+        return arena_;
+    }
 
 private:
+    // start scanning at `index` of `stream`, used to lex one chunk.
+    // identifiers are left uninterned, their slot is 0.
+    Lexer(std::string_view stream, u64 index):
+        stream_(stream), arena_(stream), index_(index) {}
+
+    // start scanning at `index` of `stream`, used to relex an edit
+    Lexer(std::string_view stream, SymbolPool &symbols, u64 index):
+        stream_(stream), arena_(stream), symbols_(&symbols), index_(index) {}
+
+    std::optional<Token> ScanToken();
+
     char Next();
     char Curr();
     bool Is(char c);
     bool Try(char c);
     void SkipSpace();
+    void SkipWith(ScanKernels::Kernel kernel);
 
-    TokenPtr ScanId(char c);
-    TokenPtr ScanMainId(char c);
-    TokenPtr ScanNormalId(char c);
+    Token ScanId(char c);
+    Token ScanMainId(char c);
+    Token ScanNormalId(char c);
 
-    TokenPtr ScanNum(char c);
-    TokenPtr ScanComment();
-    TokenPtr ScanString();
+    Token ScanNum(char c);
+    Token ScanComment();
+    Token ScanString();
 
     char ParseOctNum();
     char ParseHexNum();
     static u8 HexToDigit(char c);
     static u8 OctToDigit(char c);
 
-    static TokenPtr MakeToken(Token::Tag tag, std::string &&var);
-    static TokenPtr MakeToken(Token::Tag tag, const std::string &var);
+    Token MakeToken(Token::Tag tag, u32 value = 0);
+    Token MakeIdToken();
 
 private:
-    std::string stream_;
+    std::string_view stream_;
+    TokenArena arena_;
+    SymbolPool *symbols_ {nullptr};
     u64 index_ {0};
-    TokenPtr curr_token_{nullptr};
+    u64 start_ {0};
 };
 
-#endif // TIGER_CC_LEXER_H
\ No newline at end of file
+#endif // TIGER_CC_LEXER_H
@@ -1,23 +1,9 @@
-#include "parser.h"
-#include "../utils/file_reader.h"
-#include "../utils/printer.h"
+#include "driver.h"
 
-#include <iostream>
+#include <string>
 #include <vector>
 
-
-void DoParse(const std::string &file) {
-    auto reader = FileReader(file.c_str());
-    auto code = reader.ReadAll();
-    auto lexer = Lexer(code);
-    auto tokens = lexer.GetAllTokens();
-    auto parser = Parser(std::move(tokens));
-    auto ast = parser.ParseResult();
-    printf("\n%s\n", ast->ToString(0).c_str());
+// see Driver for the command line
+int main(int argc, char **argv) {
+    return Driver().Run(std::vector<std::string>(argv + 1, argv + argc));
 }
-
-int main() {
-    auto prefix = std::string("/Users/xiebei/tiger.cc/test/testcases/");
-    auto file = prefix + "test.tig";
-    DoParse(file);
-}
\ No newline at end of file
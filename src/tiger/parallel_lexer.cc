@@ -0,0 +1,103 @@
+#include "parallel_lexer.h"
+
+#include <algorithm>
+#include <cstring>
+
+TokenArena ParallelLexer::Lex(std::string_view stream, SymbolPool &symbols) {
+    auto chunks = Split(stream);
+    pool_.ParallelFor(chunks.size(), [&](u32 i) {
+        LexChunk(stream, chunks[i]);
+    });
+
+    auto out = TokenArena(stream);
+    auto total = size_t(0);
+    for (auto &chunk : chunks) {
+        total += chunk.arena.Tokens().size();
+    }
+    out.Reserve(total);
+
+    // `pos` is where the serial lexer would scan its next token
+    auto relexer = Lexer(stream, 0);
+    relexer.SkipSpace();
+    auto pos = relexer.index_;
+
+    for (auto &chunk : chunks) {
+        while (pos < chunk.end) {
+            auto &tokens = chunk.arena.Tokens();
+            auto it = std::lower_bound(tokens.begin(), tokens.end(), pos,
+                    [](const Token &t, u64 offset) { return t.Offset() < offset; });
+            if (it != tokens.end() && it->Offset() == pos) {
+                // back in step with the speculative tokens
+                for (; it != tokens.end(); ++it) {
+                    Append(out, chunk.arena, symbols, *it);
+                }
+                if (chunk.eof) {
+                    return out;
+                }
+                pos = chunk.stop;
+                break;
+            }
+
+            // a token from an earlier chunk ran into this one
+            relexer.index_ = pos;
+            auto token = relexer.ScanToken();
+            if (!token) {
+                return out;
+            }
+            Append(out, relexer.arena_, symbols, *token);
+            relexer.SkipSpace();
+            pos = relexer.index_;
+        }
+    }
+    return out;
+}
+
+// cut after the first '\n' past every multiple of chunk_bytes_
+std::vector<ParallelLexer::Chunk> ParallelLexer::Split(std::string_view stream) {
+    auto chunks = std::vector<Chunk>();
+    auto begin = u64(0);
+    while (begin < stream.size()) {
+        auto end = std::min<u64>(begin + chunk_bytes_, stream.size());
+        if (end < stream.size()) {
+            auto nl = memchr(stream.data() + end, '\n', stream.size() - end);
+            end = nl == nullptr ? stream.size()
+                                : static_cast<const char *>(nl) - stream.data() + 1;
+        }
+        chunks.push_back(Chunk{begin, end, 0, false, TokenArena(stream)});
+        begin = end;
+    }
+    return chunks;
+}
+
+void ParallelLexer::LexChunk(std::string_view stream, Chunk &chunk) {
+    auto lexer = Lexer(stream, chunk.begin);
+    lexer.arena_.Reserve((chunk.end - chunk.begin) / 6 + 1);
+    for (;;) {
+        lexer.SkipSpace();
+        if (lexer.index_ >= chunk.end) {
+            break;
+        }
+        auto token = lexer.ScanToken();
+        if (!token) {
+            chunk.eof = true;
+            break;
+        }
+        lexer.arena_.Push(*token);
+    }
+    chunk.stop = lexer.index_;
+    chunk.arena = std::move(lexer.arena_);
+}
+
+// copy a token into `out`, moving its string literal along and
+// interning its name
+void ParallelLexer::Append(TokenArena &out, TokenArena &from,
+        SymbolPool &symbols, Token token) {
+    if (token.Type() == Token::Tag::STR) {
+        auto slot = out.AddLiteral(std::move(from.Literal(token.Slot())));
+        token = Token(token.Type(), token.Offset(), token.Length(), slot);
+    } else if (token.Type() == Token::Tag::ID) {
+        auto symbol = symbols.Intern(from.Text(token));
+        token = Token(token.Type(), token.Offset(), token.Length(), symbol.Id());
+    }
+    out.Push(token);
+}
@@ -0,0 +1,50 @@
+#ifndef TIGER_CC_PARALLEL_LEXER_H
+#define TIGER_CC_PARALLEL_LEXER_H
+
+#include "lexer.h"
+#include "../utils/thread_pool.h"
+
+/**
+ * @brief lexes one big source on a thread pool.
+ *
+ * The source is cut into chunks right after a '\n', and every chunk is
+ * lexed speculatively as if it started outside any token. A chunk that
+ * actually starts inside a string or comment produces garbage at its
+ * head. That is fixed while stitching: the lexer is stateless between
+ * tokens, so once the serial position lands on the start of a
+ * speculative token, everything from there on is exactly what a serial
+ * lexer would have produced. Until then the stitcher re-lexes serially.
+ *
+ * The result equals Lexer::GetAllTokens token for token, string literal
+ * slots and symbol ids included: chunks don't intern, identifiers are
+ * interned in source order while stitching.
+ */
+class ParallelLexer {
+public:
+    explicit ParallelLexer(ThreadPool &pool, size_t chunk_bytes = 256 << 10):
+        pool_(pool), chunk_bytes_(chunk_bytes == 0 ? 1 : chunk_bytes) {}
+
+    TokenArena Lex(std::string_view stream, SymbolPool &symbols);
+
+private:
+    struct Chunk {
+        u64 begin;
+        u64 end;
+        // where the chunk lexer stopped: start of the first token at or
+        // past `end`, or where the input ran out
+        u64 stop {0};
+        bool eof {false};
+        TokenArena arena;
+    };
+
+    std::vector<Chunk> Split(std::string_view stream);
+    static void LexChunk(std::string_view stream, Chunk &chunk);
+    static void Append(TokenArena &out, TokenArena &from,
+            SymbolPool &symbols, Token token);
+
+private:
+    ThreadPool &pool_;
+    size_t chunk_bytes_;
+};
+
+#endif // TIGER_CC_PARALLEL_LEXER_H
@@ -0,0 +1,161 @@
+#include "parallel_parser.h"
+
+#include <algorithm>
+
+AstNodePtr ParallelParser::Parse(const TokenArena &tokens, Arena &nodes, Diagnostics *diags) {
+    groups_ = 0;
+    if (auto layout = Scan(tokens)) {
+        // cut before the first declaration past every group_tokens_ tokens
+        auto &starts = layout->starts;
+        auto decs = static_cast<u32>(starts.size() - 1);
+        auto groups = std::vector<Group>();
+        auto first = u32(0);
+        for (u32 i = 1; i < decs; ++i) {
+            if (starts[i] - starts[first] >= group_tokens_) {
+                groups.push_back({first, i});
+                first = i;
+            }
+        }
+        groups.push_back({first, decs});
+
+        if (decs > 0 && groups.size() > 1) {
+            pool_.ParallelFor(groups.size(), [&](u32 i) {
+                ParseGroup(tokens, *layout, groups[i]);
+            });
+            auto ok = std::all_of(groups.begin(), groups.end(), [](const Group &g) { return g.ok; });
+            if (ok) {
+                if (auto ast = Merge(tokens, *layout, groups, nodes)) {
+                    groups_ = static_cast<u32>(groups.size());
+                    return ast;
+                }
+            }
+        }
+    }
+    return Parser(tokens, nodes, diags).ParseResult();
+}
+
+// where the top level declarations start, nullopt unless the program is
+// a list of declarations or one `let` with them at its head
+std::optional<ParallelParser::Layout> ParallelParser::Scan(const TokenArena &tokens) {
+    auto &all = tokens.Tokens();
+    auto significant = [&](u32 i) {
+        while (i < all.size() && (all[i].Type() == Token::Tag::COMMENT || all[i].Type() == Token::Tag::EOL)) {
+            ++i;
+        }
+        return i;
+    };
+
+    auto layout = Layout{NONE, {}};
+    auto base = 0;
+    auto i = significant(0);
+    if (i < all.size() && all[i].Type() == Token::Tag::LET) {
+        layout.let = i;
+        base = 1;
+        i = significant(i + 1);
+    }
+    if (i == all.size() || !(Parser::IsDecStart(all[i].Type()) || (base == 1 && all[i].Type() == Token::Tag::IN))) {
+        return std::nullopt;
+    }
+
+    auto depth = base;
+    auto prev = Token::Tag::INVALID;
+    for (; i < all.size(); ++i) {
+        auto tag = all[i].Type();
+        if (tag == Token::Tag::COMMENT || tag == Token::Tag::EOL) {
+            continue;
+        }
+        switch (tag) {
+            case Token::Tag::LET:
+            case Token::Tag::LPAREN:
+            case Token::Tag::LBRACE:
+                ++depth;
+                break;
+            case Token::Tag::END:
+            case Token::Tag::RPAREN:
+            case Token::Tag::RBRACE:
+                if (--depth < base) {
+                    return std::nullopt;
+                }
+                break;
+            case Token::Tag::IN:
+                if (depth == base && base == 1) {
+                    layout.starts.push_back(i);
+                    return layout;
+                }
+                break;
+            default:
+                // `type t = class ...` is a class type, not a declaration
+                if (depth == base && Parser::IsDecStart(tag)
+                    && !(tag == Token::Tag::CLASS && prev == Token::Tag::EQ)) {
+                    layout.starts.push_back(i);
+                }
+                break;
+        }
+        prev = tag;
+    }
+    if (base == 1) {
+        // a `let` without `in`
+        return std::nullopt;
+    }
+    layout.starts.push_back(static_cast<u32>(all.size()));
+    return layout;
+}
+
+// parse the declarations of `group`, each must parse cleanly and end
+// where the next one starts
+void ParallelParser::ParseGroup(const TokenArena &tokens, const Layout &layout, Group &group) {
+    auto &all = tokens.Tokens();
+    auto diags = Diagnostics(tokens.Source(), "");
+    auto parser = Parser(tokens, group.nodes, &diags);
+    parser.Rewind(layout.starts[group.first]);
+    try {
+        for (auto i = group.first; i < group.last; ++i) {
+            group.decs.push_back(parser.ParseDec());
+            auto next = layout.starts[i + 1];
+            auto curr = parser.CurrToken();
+            auto at_next = next < all.size()
+                    ? curr != nullptr && curr->Offset() == all[next].Offset()
+                    : curr == nullptr;
+            if (diags.HasErrors() || !at_next) {
+                return;
+            }
+        }
+    } catch (const Parser::SyntaxError &) {
+        return;
+    }
+    group.ok = true;
+}
+
+// one Decs of all groups, under the `let` if there is one. nullptr if
+// the rest of the let doesn't parse cleanly, the nodes of the groups are
+// garbage in `nodes` then.
+AstNodePtr ParallelParser::Merge(const TokenArena &tokens, const Layout &layout,
+        std::vector<Group> &groups, Arena &nodes) {
+    auto decs = std::vector<DecPtr>();
+    for (auto &group : groups) {
+        decs.insert(decs.end(), group.decs.begin(), group.decs.end());
+        nodes.Adopt(std::move(group.nodes));
+    }
+
+    auto &all = tokens.Tokens();
+    auto diags = Diagnostics(tokens.Source(), "");
+    auto parser = Parser(tokens, nodes, &diags);
+    auto list = parser.Make<Decs>(all[layout.starts.front()].Loc(), nodes.Copy(decs));
+    if (layout.let == NONE) {
+        return list;
+    }
+
+    parser.Rewind(layout.starts.back());
+    try {
+        parser.Expect(Token::Tag::IN);
+        auto exprs = parser.ParseExprs();
+        parser.Expect(Token::Tag::END);
+        // `let ... end` followed by anything is not a let program
+        if (diags.HasErrors() || parser.CurrToken() != nullptr) {
+            return nullptr;
+        }
+        return parser.Make<LetStmt>(all[layout.let].Loc(), list, exprs);
+    } catch (const Parser::SyntaxError &) {
+        return nullptr;
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef TIGER_CC_PARALLEL_PARSER_H
+#define TIGER_CC_PARALLEL_PARSER_H
+
+#include "parser.h"
+#include "../utils/thread_pool.h"
+
+#include <optional>
+#include <vector>
+
+/**
+ * @brief parses the top level declarations of one big program on a
+ * thread pool, for programs made of thousands of functions.
+ *
+ * One pass over the tokens counts `let`/`end`, paren and brace nesting and
+ * takes every declaration keyword at the outermost level, of a program
+ * of declarations or of a program that is one `let`, as the start of a
+ * top level declaration. Runs of them are cut into groups of about
+ * `group_tokens` tokens and every group is parsed into its own arena.
+ *
+ * A group is kept only if each of its declarations parsed without
+ * errors and ended right where the next one was found, which is then
+ * exactly what the serial parser did with the same tokens. Otherwise,
+ * and for programs of any other shape, the whole program is parsed
+ * serially, so the ast and the diagnostics always equal those of
+ * Parser::ParseResult.
+ */
+class ParallelParser {
+public:
+    explicit ParallelParser(ThreadPool &pool, u32 group_tokens = 32 << 10):
+        pool_(pool), group_tokens_(group_tokens == 0 ? 1 : group_tokens) {}
+
+    // like Parser(tokens, nodes, diags).ParseResult()
+    AstNodePtr Parse(const TokenArena &tokens, Arena &nodes, Diagnostics *diags = nullptr);
+
+    // groups the last Parse merged, 0 if it parsed serially
+    u32 Groups() const {
+        return groups_;
+    }
+
+private:
+    struct Layout {
+        // `let` of a let program, NONE for a program of declarations
+        u32 let;
+        // token index of every top level declaration, then of what
+        // follows them: `in`, or the end of the tokens
+        std::vector<u32> starts;
+    };
+
+    struct Group {
+        // declarations [first, last) of the layout
+        u32 first;
+        u32 last;
+        Arena nodes;
+        std::vector<DecPtr> decs;
+        bool ok {false};
+    };
+
+    static constexpr u32 NONE = ~0u;
+
+    static std::optional<Layout> Scan(const TokenArena &tokens);
+    static void ParseGroup(const TokenArena &tokens, const Layout &layout, Group &group);
+    AstNodePtr Merge(const TokenArena &tokens, const Layout &layout,
+            std::vector<Group> &groups, Arena &nodes);
+
+private:
+    ThreadPool &pool_;
+    u32 group_tokens_;
+    u32 groups_ {0};
+};
+
+#endif // TIGER_CC_PARALLEL_PARSER_H
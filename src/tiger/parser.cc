@@ -1,79 +1,246 @@
 #include "parser.h"
 #include "../utils/error.h"
 
+#include <array>
+#include <cctype>
 #include <string>
 
+// how tightly every binary operator token binds, 0 for other tokens.
+// comparisons don't associate, `a < b < c` is an error; the other
+// operators are left associative.
+struct BinaryOpInfo {
+    u8 prec;
+    bool associative;
+};
+
+static constexpr auto BINARY_OPS = [] {
+    auto ops = std::array<BinaryOpInfo, static_cast<size_t>(Token::Tag::INVALID) + 1>();
+    auto set = [&ops](Token::Tag tag, u8 prec, bool associative) {
+        ops[static_cast<size_t>(tag)] = {prec, associative};
+    };
+    set(Token::Tag::OR, 1, true);
+    set(Token::Tag::AND, 2, true);
+    for (auto tag : {Token::Tag::EQ, Token::Tag::NOT_EQAL, Token::Tag::LESS,
+                     Token::Tag::GREATER, Token::Tag::LEQ, Token::Tag::GEQ}) {
+        set(tag, 3, false);
+    }
+    set(Token::Tag::PLUS, 4, true);
+    set(Token::Tag::MINUS, 4, true);
+    set(Token::Tag::STAR, 5, true);
+    set(Token::Tag::DIV, 5, true);
+    return ops;
+}();
+
+static BinaryOpInfo BinaryOp(const Token *token) {
+    return token != nullptr ? BINARY_OPS[static_cast<size_t>(token->Type())] : BinaryOpInfo{};
+}
+
+
+bool Parser::IsDecStart(Token::Tag tag) {
+    switch (tag) {
+        case Token::Tag::TYPE:
+        case Token::Tag::CLASS:
+        case Token::Tag::FUNCTION:
+        case Token::Tag::PRIMITIVE:
+        case Token::Tag::IMPORT:
+        case Token::Tag::VAR:
+            return true;
+        default:
+            return false;
+    }
+}
 
 AstNodePtr Parser::ParseResult() {
-    return ParseMain();
+    auto result = AstNodePtr();
+    try {
+        result = ParseMain();
+        if (auto curr = CurrToken(); curr != nullptr) {
+            Fail(Describe(curr) + " after the end of the program");
+        }
+    } catch (const SyntaxError &) {
+        // reported already, and nothing encloses the program to resume in
+    }
+    return result;
 }
 
-Lexer::TokenPtrVec Parser::FilterTokens(Lexer::TokenPtrVec tokens) {
-    auto result = Lexer::TokenPtrVec();
-    for (auto &p : tokens) {
-        if (p == nullptr
-            || p->Type() == Token::Tag::COMMENT
-            || p->Type() == Token::Tag::EOL) {
-            continue;
-        } else {
-            result.push_back(p);
+// `text` cut to a few characters, a token may run to the end of the file
+static std::string Excerpt(std::string_view text) {
+    constexpr size_t MAX = 24;
+    if (text.size() <= MAX) {
+        return std::string(text);
+    }
+    // not in the middle of a utf-8 character
+    auto end = MAX;
+    while (end > 0 && (static_cast<unsigned char>(text[end]) & 0xc0) == 0x80) {
+        --end;
+    }
+    return std::string(text.substr(0, end)) + "...";
+}
+
+// `the token`, for messages. An unterminated comment or string is one
+// invalid token up to the end of the file, it is named, not quoted.
+std::string Parser::Describe(const Token *token) {
+    if (token == nullptr) {
+        return "end of input";
+    }
+    auto text = arena_.Text(*token);
+    if (token->Type() == Token::Tag::INVALID) {
+        if (text.compare(0, 2, "/*") == 0) {
+            return "unterminated comment";
+        }
+        if (!text.empty() && text[0] == '"') {
+            if (text.size() > 2 && text[text.size() - 2] == '\\') {
+                return "invalid escape `" + std::string(text.substr(text.size() - 2)) + "` in string literal";
+            }
+            return "unterminated string literal";
+        }
+        if (!text.empty() && isdigit(static_cast<unsigned char>(text[0]))) {
+            return "integer literal `" + Excerpt(text) + "` out of range";
         }
+        return "invalid character `" + Excerpt(text) + "`";
     }
-    return result;
+    return Token::TagStr(token->Type()) + " `" + Excerpt(text) + "`";
 }
 
-Lexer::TokenPtr Parser::NextToken() {
-    if (index_ >= tokens_.size()) {
-        return nullptr;
+// report `message` at the current token
+void Parser::Report(const std::string &message) {
+    auto curr = CurrToken();
+    if (diags_ == nullptr) {
+        PANIC(message.c_str())
+    }
+    auto loc = CurrLoc();
+    if (loc != last_error_) {
+        diags_->Error(loc, curr != nullptr ? curr->Length() : 0, message);
+        last_error_ = loc;
     }
-    return tokens_[index_++];
 }
 
-Lexer::TokenPtr Parser::CurrToken() {
-    if (index_ >= tokens_.size()) {
-        return nullptr;
+void Parser::Fail(const std::string &message) {
+    Report(message);
+    throw SyntaxError{};
+}
+
+// panic mode: skip tokens up to one the enclosing list can go on from,
+// a `;`, `)`, `in`, `end` or the start of a declaration. A list of
+// declarations has no use for `;` and `)`, it skips them as well.
+void Parser::Synchronize(bool in_decs) {
+    for (auto curr = CurrToken(); curr != nullptr; curr = CurrToken()) {
+        auto tag = curr->Type();
+        if (IsDecStart(tag) || tag == Token::Tag::IN || tag == Token::Tag::END) {
+            return;
+        }
+        if (!in_decs && (tag == Token::Tag::SEMI || tag == Token::Tag::RPAREN)) {
+            return;
+        }
+        NextToken();
     }
-    return tokens_[index_];
 }
 
-// if current token is null, panic.
-// if not, eat current token and return it.
-Lexer::TokenPtr Parser::NotNullNext() {
-    auto curr = NextToken();
-    if (curr == nullptr) {
-        PANIC("need not null token")
+// the text of token, see TokenArena::Text
+// the text of `token`, copied next to the nodes so the ast doesn't
+// depend on the source buffer
+std::string_view Parser::Text(const Token &token) {
+    return nodes_.Copy(arena_.Text(token));
+}
+
+// the lexer interned every identifier, its symbol rides in the slot
+Symbol Parser::Sym(const Token &token) {
+    assert(token.Type() == Token::Tag::ID);
+    return Symbol(token.Slot());
+}
+
+// pull the next significant token from the lexer or the pre-scanned
+// tokens. comments and line ends never reach the parser.
+std::optional<Token> Parser::Pull() {
+    if (lexer_ != nullptr) {
+        return lexer_->GetNextSignificantToken();
     }
-    return curr;
+    for (; pos_ != end_; ++pos_) {
+        if (pos_->Type() != Token::Tag::COMMENT
+            && pos_->Type() != Token::Tag::EOL) {
+            return *pos_++;
+        }
+    }
+    return std::nullopt;
 }
 
-// peek the next token
-Lexer::TokenPtr Parser::PeekNext() {
-    if (index_ + 1 >= tokens_.size()) {
-        return nullptr;
+// make sure at least n tokens are buffered, unless input runs out
+void Parser::Fill(u32 n) {
+    while (count_ < n && !eof_) {
+        if (auto token = Pull()) {
+            ring_[(head_ + count_) % LOOKAHEAD] = *token;
+            ++count_;
+        } else {
+            eof_ = true;
+        }
     }
-    return tokens_[index_+1];
 }
 
-// expect current token's type is tag
-Lexer::TokenPtr Parser::Expect(Token::Tag tag) {
+// where the current token starts, the end of the source after the last one
+SourceLoc Parser::CurrLoc() {
+    auto curr = CurrToken();
+    return curr != nullptr ? curr->Loc() : SourceLoc(static_cast<u32>(arena_.Source().size()));
+}
+
+// go on from token `token` of the pre-scanned tokens
+void Parser::Rewind(u32 token) {
+    assert(lexer_ == nullptr);
+    pos_ = arena_.Tokens().data() + token;
+    end_ = arena_.Tokens().data() + arena_.Tokens().size();
+    head_ = 0;
+    count_ = 0;
+    eof_ = false;
+}
+
+// eat current token and return it, current token must not be null.
+Token Parser::NextToken() {
+    Fill(1);
+    assert(count_ > 0);
+    auto token = ring_[head_];
+    head_ = (head_ + 1) % LOOKAHEAD;
+    --count_;
+    return token;
+}
+
+// the returned pointer is only valid until the next token is eaten
+const Token *Parser::CurrToken() {
+    Fill(1);
+    return count_ > 0 ? &ring_[head_] : nullptr;
+}
+
+// eat current token and return it, it is an error if input ran out.
+Token Parser::NotNullNext() {
     if (CurrToken() == nullptr) {
-        PANIC("curr token is null")
+        Fail("unexpected end of input");
     }
-    if (auto curr_tag = CurrToken()->Type(); curr_tag != tag) {
-        auto msg = std::string("[Parser::Expect] not expected token's tag. ")
-                +  "expect " + Token::TagStr(tag)
-                +  ". but we get " + Token::TagStr(curr_tag);
-        PANIC(msg.c_str())
+    return NextToken();
+}
+
+// peek the next token
+const Token *Parser::PeekNext() {
+    Fill(2);
+    return count_ > 1 ? &ring_[(head_ + 1) % LOOKAHEAD] : nullptr;
+}
+
+// expect current token's type is tag
+Token Parser::Expect(Token::Tag tag) {
+    auto curr = CurrToken();
+    if (curr == nullptr || curr->Type() != tag) {
+        Fail("expected " + Token::TagStr(tag) + " but found " + Describe(curr));
     }
     return NextToken();
 }
 
-// current token's type is tag
+// current token's type is tag, false at the end of input
 bool Parser::CurrIs(Token::Tag tag) {
-    if (CurrToken() == nullptr) {
-        PANIC("curr token is null")
-    }
-    return CurrToken()->Type() == tag;
+    auto curr = CurrToken();
+    return curr != nullptr && curr->Type() == tag;
+}
+
+// the token after the current one is tag
+bool Parser::PeekIs(Token::Tag tag) {
+    auto next = PeekNext();
+    return next != nullptr && next->Type() == tag;
 }
 
 // if current token's type is tag, eat current token and return true
@@ -94,41 +261,25 @@ AstNodePtr Parser::ParseMain() {
         return nullptr;
     }
 
-    auto result = AstNodePtr();
-    switch (curr->Type()) {
-        case Token::Tag::TYPE:
-        case Token::Tag::CLASS:
-        case Token::Tag::FUNCTION:
-        case Token::Tag::PRIMITIVE:
-        case Token::Tag::IMPORT:
-        case Token::Tag::VAR:
-            result = ParseDecs();
-            break;
-        default:
-            result = ParseTopExpr();
+    if (IsDecStart(curr->Type())) {
+        return ParseDecs();
     }
-
-    return result;
+    return ParseTopExpr();
 }
 
+// a declaration that doesn't parse is reported and left out, the next
+// one is parsed as usual
 DecsPtr Parser::ParseDecs() {
-    auto decs = DecPtrVec();
-    auto curr = CurrToken();
-    while ((curr = CurrToken()) != nullptr) {
-        switch (curr->Type()) {
-            case Token::Tag::TYPE:
-            case Token::Tag::CLASS:
-            case Token::Tag::FUNCTION:
-            case Token::Tag::PRIMITIVE:
-            case Token::Tag::IMPORT:
-            case Token::Tag::VAR:
-                decs.push_back(std::move(ParseDec()));
-                break;
-            default:
-                return MakeUnique<Decs>(std::move(decs));
+    auto loc = CurrLoc();
+    auto decs = std::vector<DecPtr>();
+    for (auto curr = CurrToken(); curr != nullptr && IsDecStart(curr->Type()); curr = CurrToken()) {
+        try {
+            decs.push_back(ParseDec());
+        } catch (const SyntaxError &) {
+            Synchronize(true);
         }
     }
-    return MakeUnique<Decs>(std::move(decs));
+    return Make<Decs>(loc, nodes_.Copy(decs));
 }
 
 DecPtr Parser::ParseDec() {
@@ -164,36 +315,39 @@ DecPtr Parser::ParseDec() {
 }
 
 DecPtr Parser::ParseTypeDec() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::TYPE);
     auto id = Expect(Token::Tag::ID);
     auto _ = Expect(Token::Tag::EQ);
     auto type = ParseType();
-    auto name = MakeUnique<Identifier>(id->Value());
-    return MakeUnique<TypeDec>(std::move(name), std::move(type));
+    auto name = MakeId(id);
+    return Make<TypeDec>(loc, std::move(name), std::move(type));
 }
 
 DecPtr Parser::ParseClassDefA() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::CLASS);
     auto id = Expect(Token::Tag::ID);
-    auto name = MakeUnique<Identifier>(id->Value());
+    auto name = MakeId(id);
     auto parent = TypeIdPtr();
 
     if (CurrIs(Token::Tag::EXTENDS)) {
         NextToken(); // eat 'extends'
         auto p = Expect(Token::Tag::ID);
-        parent = MakeUnique<TypeId>(p->Value());
+        parent = MakeTypeId(p);
     }
 
     Expect(Token::Tag::LPAREN);
     auto fields = ParseClassFields();
     Expect(Token::Tag::RPAREN);
 
-    return MakeUnique<ClassDef>(std::move(name),
+    return Make<ClassDef>(loc, std::move(name),
             std::move(parent), std::move(fields));
 }
 
 ClassFieldsPtr Parser::ParseClassFields() {
-    auto fields = ClassFieldPtrVec();
+    auto loc = CurrLoc();
+    auto fields = std::vector<ClassFieldPtr>();
     auto curr = CurrToken();
     while ((curr = CurrToken()) != nullptr) {
         switch (curr->Type()) {
@@ -202,10 +356,10 @@ ClassFieldsPtr Parser::ParseClassFields() {
                 fields.push_back(ParseClassField());
                 break;
             default:
-                return MakeUnique<ClassFields>(std::move(fields));
+                return Make<ClassFields>(loc, nodes_.Copy(fields));
         }
     }
-    return MakeUnique<ClassFields>(std::move(fields));
+    return Make<ClassFields>(loc, nodes_.Copy(fields));
 }
 
 // class-field ::= attr-dec | method-dec
@@ -216,16 +370,16 @@ ClassFieldPtr Parser::ParseClassField() {
     if (CurrIs(Token::Tag::METHOD)) {
         return ParseMethodDec();
     }
-    PANIC("class field expect `var` or `method`\n")
-    return nullptr;
+    Fail("expected `var` or `method` but found " + Describe(CurrToken()));
 }
 
 // method declaration in class fields
 // method id (type-fields) [ : type-id ] = exp
 MethodDecPtr Parser::ParseMethodDec() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::METHOD);
     auto id = Expect(Token::Tag::ID);
-    auto name = MakeUnique<Identifier>(id->Value());
+    auto name = MakeId(id);
     Expect(Token::Tag::LPAREN);
     auto args = ParseTypeFields();
     Expect(Token::Tag::RPAREN);
@@ -233,41 +387,44 @@ MethodDecPtr Parser::ParseMethodDec() {
     auto ret = TypeIdPtr();
     if (Try(Token::Tag::COLON)) {
         auto type_id = Expect(Token::Tag::ID);
-        ret = MakeUnique<TypeId>(type_id->Value());
+        ret = MakeTypeId(type_id);
     }
 
     Expect(Token::Tag::EQ);
     auto body = ParseTopExpr();
-    return MakeUnique<MethodDec>(std::move(name), std::move(args),
+    return Make<MethodDec>(loc, std::move(name), std::move(args),
             std::move(ret), std::move(body));
 }
 
 // attribute declaration in class fields
 AttrDecPtr Parser::ParseAttrDec() {
-    return MakeUnique<AttrDec>(ParseVarDec());
+    auto loc = CurrLoc();
+    return Make<AttrDec>(loc, ParseVarDec());
 }
 
 VarDecPtr Parser::ParseVarDec() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::VAR);
     auto id = Expect(Token::Tag::ID);
-    auto name = MakeUnique<Identifier>(id->Value());
+    auto name = MakeId(id);
     auto type = TypeIdPtr();
 
     if (Try(Token::Tag::COLON)) {
         auto type_id = Expect(Token::Tag::ID);
-        type = MakeUnique<TypeId>(type_id->Value());
+        type = MakeTypeId(type_id);
     }
 
     Expect(Token::Tag::ASSIGN);
     auto body = ParseTopExpr();
-    return MakeUnique<VarDec>(
+    return Make<VarDec>(loc,
             std::move(name), std::move(type), std::move(body));
 }
 
 FnDecPtr Parser::ParseFnDec() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::FUNCTION);
     auto id = Expect(Token::Tag::ID);
-    auto name = MakeUnique<Identifier>(id->Value());
+    auto name = MakeId(id);
 
     Expect(Token::Tag::LPAREN);
     auto args = ParseTypeFields();
@@ -277,19 +434,20 @@ FnDecPtr Parser::ParseFnDec() {
 
     if (Try(Token::Tag::COLON)) {
         auto type_id = Expect(Token::Tag::ID);
-        ret = MakeUnique<TypeId>(type_id->Value());
+        ret = MakeTypeId(type_id);
     }
     Expect(Token::Tag::EQ);
 
     auto body = ParseTopExpr();
-    return MakeUnique<FnDec>(std::move(name), std::move(args),
+    return Make<FnDec>(loc, std::move(name), std::move(args),
             std::move(ret), std::move(body));
 }
 
 PrimDecPtr Parser::ParsePrimDec() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::PRIMITIVE);
     auto id = Expect(Token::Tag::ID);
-    auto name = MakeUnique<Identifier>(id->Value());
+    auto name = MakeId(id);
     Expect(Token::Tag::LPAREN);
 
     auto args = ParseTypeFields();
@@ -298,76 +456,74 @@ PrimDecPtr Parser::ParsePrimDec() {
     auto ret = TypeIdPtr();
     if (CurrIs(Token::Tag::COLON)) {
         auto type_id = Expect(Token::Tag::ID);
-        ret = MakeUnique<TypeId>(type_id->Value());
+        ret = MakeTypeId(type_id);
     }
 
-    return MakeUnique<PrimDec>(std::move(name),
+    return Make<PrimDec>(loc, std::move(name),
             std::move(args), std::move(ret));
 }
 
 ImportDecPtr Parser::ParseImportDec() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::IMPORT);
-    return MakeUnique<ImportDec>(Expect(Token::Tag::STR)->Value());
+    return Make<ImportDec>(loc, Text(Expect(Token::Tag::STR)));
 }
 
-TypePtr Parser::ParseType() {
-    auto curr = NextToken();
-    if (curr == nullptr) {
-        PANIC("current token is null")
-    }
-
-    switch (curr->Type()) {
+TypeDefPtr Parser::ParseType() {
+    auto curr = NotNullNext();
+    switch (curr.Type()) {
         case Token::Tag::LBRACE:
-            return ParseRecordDef();
+            return ParseRecordDef(curr.Loc());
         case Token::Tag::ARRAY:
-            return ParseArrayDef();
+            return ParseArrayDef(curr.Loc());
         case Token::Tag::CLASS:
-            return ParseClassTypeDef();
+            return ParseClassTypeDef(curr.Loc());
         case Token::Tag::ID:
-            return MakeUnique<TypeAlias>(MakeUnique<TypeId>(curr->Value()));
+            return Make<TypeAlias>(curr.Loc(), MakeTypeId(curr));
         default:
-            PANIC("current token's type is not valid")
+            Fail("expected a type but found " + Describe(&curr));
     }
-
-    return nullptr; // dead code
 }
 
 TypeAliasPtr Parser::ParseAliasType() {
-    auto type = MakeUnique<TypeId>(Expect(Token::Tag::ID)->Value());
-    return MakeUnique<TypeAlias>(std::move(type));
+    auto loc = CurrLoc();
+    auto type = MakeTypeId(Expect(Token::Tag::ID));
+    return Make<TypeAlias>(loc, std::move(type));
 }
 
-RecordDefPtr Parser::ParseRecordDef() {
+// the rest of a type starting at `loc`
+RecordDefPtr Parser::ParseRecordDef(SourceLoc loc) {
     auto records = ParseTypeFields();
     Expect(Token::Tag::RBRACE);
-    return MakeUnique<RecordDef>(std::move(records));
+    return Make<RecordDef>(loc, std::move(records));
 }
 
-ArrayDefPtr Parser::ParseArrayDef() {
+ArrayDefPtr Parser::ParseArrayDef(SourceLoc loc) {
     Expect(Token::Tag::OF);
-    auto type = MakeUnique<TypeId>(Expect(Token::Tag::ID)->Value());
-    return MakeUnique<ArrayDef>(std::move(type));
+    auto type = MakeTypeId(Expect(Token::Tag::ID));
+    return Make<ArrayDef>(loc, std::move(type));
 }
 
-ClassTypeDefPtr Parser::ParseClassTypeDef() {
+ClassTypeDefPtr Parser::ParseClassTypeDef(SourceLoc loc) {
     auto parent = TypeIdPtr();
     if (Try(Token::Tag::EXTENDS)) {
-        parent = MakeUnique<TypeId>(Expect(Token::Tag::ID)->Value());
+        parent = MakeTypeId(Expect(Token::Tag::ID));
     }
 
     Expect(Token::Tag::LBRACE);
     auto fields = ParseClassFields();
     Expect(Token::Tag::RBRACE);
 
-    return MakeUnique<ClassTypeDef>(std::move(parent), std::move(fields));
+    return Make<ClassTypeDef>(loc, std::move(parent), std::move(fields));
 }
 
 TypeFieldsPtr Parser::ParseTypeFields() {
-    auto names = IdPtrVec();
-    auto types = TypeIdPtrVec();
+    auto loc = CurrLoc();
+    auto names = std::vector<IdPtr>();
+    auto types = std::vector<TypeIdPtr>();
 
     if (CurrToken() == nullptr || !CurrIs(Token::Tag::ID)) {
-        return MakeUnique<TypeFields>(std::move(names), std::move(types));
+        return Make<TypeFields>(loc, nodes_.Copy(names), nodes_.Copy(types));
     }
     
     do {
@@ -375,12 +531,12 @@ TypeFieldsPtr Parser::ParseTypeFields() {
         Expect(Token::Tag::COLON);
         auto type_id = Expect(Token::Tag::ID);
 
-        names.emplace_back(new Identifier(id->Value()));
-        types.emplace_back(new TypeId(type_id->Value()));
+        names.push_back(MakeId(id));
+        types.push_back(MakeTypeId(type_id));
 
     } while (Try(Token::Tag::COMMA));
 
-    return MakeUnique<TypeFields>(std::move(names), std::move(types));
+    return Make<TypeFields>(loc, nodes_.Copy(names), nodes_.Copy(types));
 }
 
 // expr ::= primary-expr binoprhs
@@ -389,34 +545,34 @@ ExprPtr Parser::ParseTopExpr() {
     return ParseBinaryExpr(0, std::move(left));
 }
 
-ExprPtr Parser::ParseBinaryExpr(u64 expr_prec, ExprPtr lhs) {
+// precedence climbing: fold operators binding at least `min_prec` into
+// `lhs`, the right operand of each swallows the ones binding tighter
+ExprPtr Parser::ParseBinaryExpr(u32 min_prec, ExprPtr lhs) {
     for (;;) {
         auto curr = CurrToken();
-        if (curr == nullptr || !curr->IsOperator()) {
-            return lhs;
-        }
-
-        auto op = MakeUnique<Operator>(curr->Value());
-        if (op->GetPrecedence() < expr_prec) {
+        auto info = BinaryOp(curr);
+        if (info.prec == 0 || info.prec < min_prec) {
             return lhs;
         }
+        // a binary expression is located at its operator
+        auto loc = curr->Loc();
+        auto op = Operator::FromTag(curr->Type());
         NextToken();
         auto rhs = ParsePrimeExpr();
-        curr = CurrToken();
-        if (curr != nullptr && curr->IsOperator()) {
-            auto next = MakeUnique<Operator>(curr->Value());
-            if (op->GetPrecedence() < next->GetPrecedence()) {
-                rhs = ParseBinaryExpr(op->GetPrecedence()+1, std::move(rhs));
-            }
+        if (BinaryOp(CurrToken()).prec > info.prec) {
+            rhs = ParseBinaryExpr(info.prec + 1, rhs);
+        }
+        lhs = Make<BinaryExpr>(loc, op, lhs, rhs);
+        if (!info.associative && BinaryOp(CurrToken()).prec == info.prec) {
+            Fail("comparison operators are not associative");
         }
-        lhs = MakeUnique<BinaryExpr>(std::move(op), std::move(lhs), std::move(rhs));
     }
 }
 
 ExprPtr Parser::ParsePrimeExpr() {
     auto curr = CurrToken();
     if (curr == nullptr) {
-        PANIC("expression can't be empty")
+        Fail("expected an expression but found end of input");
     }
     switch (curr->Type()) {
         case Token::Tag::NIL:
@@ -441,27 +597,24 @@ ExprPtr Parser::ParsePrimeExpr() {
             return ParseBreak();
         case Token::Tag::LET:
             return ParseLet();
-        case Token::Tag::ID: {
-            auto next = PeekNext();
-            switch (next->Type()) {
-                case Token::Tag::LBRACE:
-                    return ParseRecordCrt();
-                case Token::Tag::LPAREN:
-                    return ParseFnCall();
-                default:
-                    return ParseExprTail();
+        case Token::Tag::ID:
+            if (PeekIs(Token::Tag::LBRACE)) {
+                return ParseRecordCrt();
             }
-        }
+            if (PeekIs(Token::Tag::LPAREN)) {
+                return ParseFnCall();
+            }
+            return ParseExprTail();
         default:
-            PANIC("invalid token")
+            Fail("expected an expression but found " + Describe(curr));
     }
-    return PrimeExprPtr();
 }
 
 PrimeExprPtr Parser::ParseExprTail() {
+    auto loc = CurrLoc();
     auto elem = ElemPtr();
 
-    if (PeekNext()->Type() == Token::Tag::LSQUB) {
+    if (PeekIs(Token::Tag::LSQUB)) {
         auto id = NextToken();
         Expect(Token::Tag::LSQUB);
         auto len = ParseTopExpr();
@@ -470,11 +623,11 @@ PrimeExprPtr Parser::ParseExprTail() {
         if (Try(Token::Tag::OF)) {
             // array creation
             auto init = ParseTopExpr();
-            auto type = MakeUnique<TypeId>(id->Value());
-            return MakeUnique<ArrayCreate>(std::move(type), std::move(len), std::move(init));
+            auto type = MakeTypeId(id);
+            return Make<ArrayCreate>(loc, std::move(type), std::move(len), std::move(init));
         }
 
-        auto idxs = ExprPtrVec();
+        auto idxs = std::vector<ExprPtr>();
         idxs.push_back(std::move(len));
         while (Try(Token::Tag::LSQUB)) {
             auto idx = ParseTopExpr();
@@ -482,68 +635,64 @@ PrimeExprPtr Parser::ParseExprTail() {
             idxs.push_back(std::move(idx));
         }
 
-        elem = MakeUnique<Elem>(MakeUnique<Identifier>(id->Value()), std::move(idxs));
+        elem = Make<Elem>(loc, MakeId(id), nodes_.Copy(idxs));
     } else {
         auto id = NextToken();
-        elem = MakeUnique<Elem>(MakeUnique<Identifier>(id->Value()), ExprPtrVec());
+        elem = Make<Elem>(loc, MakeId(id), ExprPtrVec());
     }
 
     // lvar
-    auto lvar = ParseLvar(std::move(elem));
+    auto method_call = false;
+    auto lvar = ParseLvar(std::move(elem), method_call);
 
-    if (Try(Token::Tag::DOT)) {
+    if (method_call) {
         auto id = Expect(Token::Tag::ID);
-        auto method = MakeUnique<Identifier>(id->Value());
-        Expect(Token::Tag::LPAREN);
-
-        auto args = ExprPtrVec();
-        while (!CurrIs(Token::Tag::RPAREN)) {
-            args.push_back(ParseTopExpr());
-            if (!Try(Token::Tag::COMMA)) {
-                break;
-            }
-        }
-        Expect(Token::Tag::RPAREN);
-        return MakeUnique<MethodCall>(std::move(lvar), std::move(method), std::move(args));
+        auto method = MakeId(id);
+        auto args = ParseArgs();
+        return Make<MethodCall>(loc, std::move(lvar), std::move(method), args);
 
     } else if (Try(Token::Tag::ASSIGN)) {
         // assignment
         auto rvar = ParseTopExpr();
-        return MakeUnique<Assignment>(std::move(lvar), std::move(rvar));
+        return Make<Assignment>(loc, std::move(lvar), std::move(rvar));
 
     } else {
         // lvalue
-        return std::move(lvar);
+        return lvar;
     }
 }
 
 NilExprPtr Parser::ParseNilExpr() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::NIL);
-    return MakeUnique<NilExpr>();
+    return Make<NilExpr>(loc);
 }
 
 IntExprPtr Parser::ParseIntExpr() {
+    auto loc = CurrLoc();
     auto t = Expect(Token::Tag::NUM);
-    auto num = std::stoi(t->Value());
-    return MakeUnique<IntExpr>(num);
+    auto num = static_cast<i32>(t.Slot());
+    return Make<IntExpr>(loc, num);
 }
 
 StrExprPtr Parser::ParseStrExpr() {
+    auto loc = CurrLoc();
     auto t = Expect(Token::Tag::STR);
-    return MakeUnique<StrExpr>(t->Value());
+    return Make<StrExpr>(loc, Text(t));
 }
 
 RecordCreatePtr Parser::ParseRecordCrt() {
+    auto loc = CurrLoc();
     auto type_id = Expect(Token::Tag::ID);
-    auto type = MakeUnique<TypeId>(type_id->Value());
-    auto field_names = TypeIdPtrVec();
-    auto field_vars = ExprPtrVec();
+    auto type = MakeTypeId(type_id);
+    auto field_names = std::vector<TypeIdPtr>();
+    auto field_vars = std::vector<ExprPtr>();
 
     Expect(Token::Tag::LBRACE);
     if (CurrIs(Token::Tag::ID)) {
         do {
             auto id = Expect(Token::Tag::ID);
-            auto name = MakeUnique<TypeId>(id->Value());
+            auto name = MakeTypeId(id);
             auto _ = Expect(Token::Tag::EQ);
             auto exp = ParseTopExpr();
 
@@ -554,34 +703,46 @@ RecordCreatePtr Parser::ParseRecordCrt() {
     }
     Expect(Token::Tag::RBRACE);
 
-    return MakeUnique<RecordCreate>(std::move(type),
-            std::move(field_names), std::move(field_vars));
+    return Make<RecordCreate>(loc, std::move(type),
+            nodes_.Copy(field_names), nodes_.Copy(field_vars));
 }
 
 ObjectNewPtr Parser::ParseObjectNew() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::NEW);
     auto type_id = Expect(Token::Tag::ID);
-    auto type = MakeUnique<TypeId>(type_id->Value());
-    return MakeUnique<ObjectNew>(std::move(type));
+    auto type = MakeTypeId(type_id);
+    return Make<ObjectNew>(loc, std::move(type));
 }
 
 FnCallPtr Parser::ParseFnCall() {
+    auto loc = CurrLoc();
     auto id = Expect(Token::Tag::ID);
-    auto fn_name = MakeUnique<Identifier>(id->Value());
-    Expect(Token::Tag::LPAREN);
-    auto args = ExprPtrVec();
-
-   if (!CurrIs(Token::Tag::RPAREN)) {
-       do {
-           args.push_back(ParseTopExpr());
-       } while (Try(Token::Tag::COMMA));
-   }
-   Expect(Token::Tag::RPAREN);
+    auto fn_name = MakeId(id);
+    auto args = ParseArgs();
+    return Make<FnCall>(loc, std::move(fn_name), args);
+}
 
-   return MakeUnique<FnCall>(std::move(fn_name), std::move(args));
+// ( [exp {, exp}] ), an argument that doesn't parse is reported and
+// left out, the call itself still ends at its `)`
+ExprPtrVec Parser::ParseArgs() {
+    Expect(Token::Tag::LPAREN);
+    auto args = std::vector<ExprPtr>();
+    if (!CurrIs(Token::Tag::RPAREN)) {
+        do {
+            try {
+                args.push_back(ParseTopExpr());
+            } catch (const SyntaxError &) {
+                Synchronize(false);
+            }
+        } while (Try(Token::Tag::COMMA));
+    }
+    Expect(Token::Tag::RPAREN);
+    return nodes_.Copy(args);
 }
 
 IfStmtPtr Parser::ParseIf() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::IF);
     auto cond = ParseTopExpr();
     Expect(Token::Tag::THEN);
@@ -590,30 +751,32 @@ IfStmtPtr Parser::ParseIf() {
     if (Try(Token::Tag::ELSE)) {
         else_ = ParseTopExpr();
     }
-    return MakeUnique<IfStmt>(
+    return Make<IfStmt>(loc,
             std::move(cond),
             std::move(then),
             std::move(else_));
 }
 
 WhileStmtPtr Parser::ParseWhile() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::WHILE);
     auto cond = ParseTopExpr();
     Expect(Token::Tag::DO);
     auto body = ParseTopExpr();
-    return MakeUnique<WhileStmt>(std::move(cond), std::move(body));
+    return Make<WhileStmt>(loc, std::move(cond), std::move(body));
 }
 
 ForStmtPtr Parser::ParseFor() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::FOR);
-    auto name = MakeUnique<Identifier>(Expect(Token::Tag::ID)->Value());
+    auto name = MakeId(Expect(Token::Tag::ID));
     Expect(Token::Tag::ASSIGN);
     auto from = ParseTopExpr();
     Expect(Token::Tag::TO);
     auto to = ParseTopExpr();
     Expect(Token::Tag::DO);
     auto body = ParseTopExpr();
-    return MakeUnique<ForStmt>(
+    return Make<ForStmt>(loc,
             std::move(name),
             std::move(from),
             std::move(to),
@@ -621,28 +784,32 @@ ForStmtPtr Parser::ParseFor() {
 }
 
 BreakStmtPtr Parser::ParseBreak() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::BREAK);
-    return MakeUnique<BreakStmt>();
+    return Make<BreakStmt>(loc);
 }
 
 LetStmtPtr Parser::ParseLet() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::LET);
     auto decs = ParseDecs();
     Expect(Token::Tag::IN);
     auto exps = ParseExprs();
     Expect(Token::Tag::END);
-    return MakeUnique<LetStmt>(std::move(decs), std::move(exps));
+    return Make<LetStmt>(loc, std::move(decs), std::move(exps));
 }
 
 ExprSeqPtr Parser::ParseExprSeq() {
+    auto loc = CurrLoc();
     Expect(Token::Tag::LPAREN);
     auto exps = ParseExprs();
     Expect(Token::Tag::RPAREN);
-    return MakeUnique<ExprSeq>(std::move(exps));
+    return Make<ExprSeq>(loc, std::move(exps));
 }
 
 ExprsPtr Parser::ParseExprs() {
-    auto exps = ExprPtrVec();
+    auto loc = CurrLoc();
+    auto exps = std::vector<ExprPtr>();
     if (auto curr = CurrToken(); curr != nullptr) {
         switch (curr->Type()) {
             case Token::Tag::NIL:
@@ -657,41 +824,52 @@ ExprsPtr Parser::ParseExprs() {
             case Token::Tag::BREAK:
             case Token::Tag::LET:
             case Token::Tag::ID:
+                // an expression that doesn't parse is reported and
+                // left out, parsing goes on after the next `;`
                 do {
-                    exps.push_back(ParseTopExpr());
+                    try {
+                        exps.push_back(ParseTopExpr());
+                    } catch (const SyntaxError &) {
+                        Synchronize(false);
+                    }
                 } while (Try(Token::Tag::SEMI));
             default: break;
         }
     }
-    return MakeUnique<Exprs>(std::move(exps));
+    return Make<Exprs>(loc, nodes_.Copy(exps));
 }
 
+// the minus binds tighter than any binary operator, `-a * b` is
+// `(-a) * b`; its operand may be another minus
 UnaryExprPtr Parser::ParseUnaryExpr() {
-    auto id = Expect(Token::Tag::MINUS);
-    auto op = MakeUnique<Operator>(id->Value());
-    auto expr = ParseTopExpr();
-    return MakeUnique<UnaryExpr>(std::move(op), std::move(expr));
+    auto loc = CurrLoc();
+    Expect(Token::Tag::MINUS);
+    auto expr = ParsePrimeExpr();
+    return Make<UnaryExpr>(loc, Operator(Op::MINUS), std::move(expr));
 }
 
 ElemPtr Parser::ParseElem() {
+    auto loc = CurrLoc();
     auto id = Expect(Token::Tag::ID);
-    auto idxs = ExprPtrVec();
+    auto idxs = std::vector<ExprPtr>();
     while (Try(Token::Tag::LSQUB)) {
         idxs.push_back(ParseTopExpr());
         Expect(Token::Tag::RSQUB);
     }
-    return MakeUnique<Elem>(MakeUnique<Identifier>(id->Value()), std::move(idxs));
+    return Make<Elem>(loc, MakeId(id), nodes_.Copy(idxs));
 }
 
-LvarPtr Parser::ParseLvar(ElemPtr elem) {
-    auto elems = ElemPtrVec();
+// `method` is set when the lvalue is followed by `.id(`, a method call
+// whose dot is eaten already
+LvarPtr Parser::ParseLvar(ElemPtr elem, bool &method) {
+    auto elems = std::vector<ElemPtr>();
     elems.push_back(std::move(elem));
     while (Try(Token::Tag::DOT)) {
-        // method call
-        if (PeekNext()->Type() == Token::Tag::LPAREN) {
+        if (PeekIs(Token::Tag::LPAREN)) {
+            method = true;
             break;
         }
         elems.push_back(ParseElem());
     }
-    return MakeUnique<Lvar>(std::move(elems));
+    return Make<Lvar>(elems[0]->Loc(), nodes_.Copy(elems));
 }
@@ -3,30 +3,75 @@
 
 #include "lexer.h"
 #include "ast.h"
+#include "../utils/diagnostics.h"
 
 #include <map>
 
 class Parser {
 public:
+    friend class IncrementalParser;
+    friend class ParallelParser;
+
+public:
+    // nodes are allocated in the arena handed to the parser, each one
+    // located where its first token starts
     template <typename T, typename... Args>
-    std::unique_ptr<T> MakeUnique(Args&&... args) {
-        return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
+    T *Make(SourceLoc loc, Args&&... args) {
+        auto node = nodes_.New<T>(std::forward<Args>(args)...);
+        node->SetLoc(loc);
+        return node;
     }
 
-public:
-    explicit Parser(Lexer::TokenPtrVec &&tokens):
-        tokens_(FilterTokens(tokens)) {}
+    IdPtr MakeId(const Token &token) {
+        return Make<Identifier>(token.Loc(), Sym(token));
+    }
 
+    TypeIdPtr MakeTypeId(const Token &token) {
+        return Make<TypeId>(token.Loc(), Sym(token));
+    }
+
+public:
+    // streaming mode, tokens are pulled from the lexer on demand.
+    // syntax errors go to `diags` and parsing resumes after them; without
+    // diags the first one is fatal.
+    Parser(Lexer &lexer, Arena &nodes, Diagnostics *diags = nullptr):
+        arena_(lexer.Arena()), nodes_(nodes), diags_(diags), lexer_(&lexer) {}
+
+    // parse the tokens already scanned into `arena`
+    Parser(const TokenArena &arena, Arena &nodes, Diagnostics *diags = nullptr):
+        arena_(arena),
+        nodes_(nodes),
+        diags_(diags),
+        pos_(arena.Tokens().data()),
+        end_(arena.Tokens().data() + arena.Tokens().size()) {}
+
+    // the ast, parts that didn't parse are left out of it
     AstNodePtr ParseResult();
 
 private:
-    static Lexer::TokenPtrVec FilterTokens(Lexer::TokenPtrVec tokens);
-
-    Lexer::TokenPtr NextToken();
-    Lexer::TokenPtr CurrToken();
-    Lexer::TokenPtr Expect(Token::Tag tag);
-    Lexer::TokenPtr NotNullNext();
-    Lexer::TokenPtr PeekNext();
+    // unwinds from a reported syntax error to the nearest list that can
+    // resume parsing, never escapes the parser
+    struct SyntaxError {};
+
+    static bool IsDecStart(Token::Tag tag);
+    [[noreturn]] void Fail(const std::string &message);
+    void Report(const std::string &message);
+    void Synchronize(bool in_decs);
+    std::string Describe(const Token *token);
+
+    std::optional<Token> Pull();
+    void Fill(u32 n);
+    void Rewind(u32 token);
+
+    std::string_view Text(const Token &token);
+    Symbol Sym(const Token &token);
+    Token NextToken();
+    const Token *CurrToken();
+    SourceLoc CurrLoc();
+    Token Expect(Token::Tag tag);
+    Token NotNullNext();
+    const Token *PeekNext();
+    bool PeekIs(Token::Tag tag);
     bool CurrIs(Token::Tag tag);
     bool Try(Token::Tag tag);
     bool IsOperator(Token::Tag tag);
@@ -35,9 +80,9 @@ private:
 
     // expressions
     ExprPtr ParseTopExpr();
-    ExprPtr ParseBinaryExpr(u64 expr_prec, ExprPtr lhs);
+    ExprPtr ParseBinaryExpr(u32 min_prec, ExprPtr lhs);
     PrimeExprPtr ParseExprTail();
-    LvarPtr ParseLvar(ElemPtr elem);
+    LvarPtr ParseLvar(ElemPtr elem, bool &method);
     ElemPtr ParseElem();
     ExprPtr ParsePrimeExpr();
     UnaryExprPtr ParseUnaryExpr();
@@ -58,6 +103,7 @@ private:
 
     // function and method call
     FnCallPtr ParseFnCall();
+    ExprPtrVec ParseArgs();
 
     // control expressions
     IfStmtPtr ParseIf();
@@ -84,15 +130,30 @@ private:
     TypeFieldsPtr ParseTypeFields();
 
     // type declarations
-    TypePtr ParseType();
+    TypeDefPtr ParseType();
     TypeAliasPtr ParseAliasType();
-    RecordDefPtr ParseRecordDef();
-    ArrayDefPtr ParseArrayDef();
-    ClassTypeDefPtr ParseClassTypeDef();
+    RecordDefPtr ParseRecordDef(SourceLoc loc);
+    ArrayDefPtr ParseArrayDef(SourceLoc loc);
+    ClassTypeDefPtr ParseClassTypeDef(SourceLoc loc);
 
 private:
-    Lexer::TokenPtrVec tokens_;
-    u32 index_ {0};
+    // the grammar needs one token of lookahead besides the current one
+    static constexpr u32 LOOKAHEAD = 2;
+
+    const TokenArena &arena_;
+    Arena &nodes_;
+    Diagnostics *diags_ {nullptr};
+    // where the last error was reported, one mistake is reported once
+    // however many rules trip over it
+    SourceLoc last_error_;
+    Lexer *lexer_ {nullptr};
+    const Token *pos_ {nullptr};
+    const Token *end_ {nullptr};
+
+    Token ring_[LOOKAHEAD];
+    u32 head_ {0};
+    u32 count_ {0};
+    bool eof_ {false};
 };
 
 #endif // TIGER_CC_PARSER_H
\ No newline at end of file
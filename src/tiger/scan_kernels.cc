@@ -0,0 +1,251 @@
+#include "scan_kernels.h"
+
+#include <array>
+
+#if defined(__x86_64__)
+#define TIGER_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr std::array<bool, 256> MakeIdentTable() {
+    auto table = std::array<bool, 256>();
+    for (int c = 0; c < 256; ++c) {
+        table[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+                || (c >= '0' && c <= '9') || c == '_';
+    }
+    return table;
+}
+
+constexpr auto IDENT_TABLE = MakeIdentTable();
+
+inline bool IsBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+inline bool IsIdent(char c) {
+    return IDENT_TABLE[static_cast<u8>(c)];
+}
+
+const char *SkipBlanksScalar(const char *p, const char *end) {
+    while (p < end && IsBlank(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+const char *SkipIdentScalar(const char *p, const char *end) {
+    while (p < end && IsIdent(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+const char *FindStarScalar(const char *p, const char *end) {
+    while (p < end && *p != '*') {
+        ++p;
+    }
+    return p;
+}
+
+const char *FindStrStopScalar(const char *p, const char *end) {
+    while (p < end && *p != '"' && *p != '\\') {
+        ++p;
+    }
+    return p;
+}
+
+const ScanKernels SCALAR = {
+    "scalar",
+    SkipBlanksScalar,
+    SkipIdentScalar,
+    FindStarScalar,
+    FindStrStopScalar,
+};
+
+#ifdef TIGER_SCAN_X86
+
+// most runs are short: look at the first byte before paying for a load.
+// `stop` is the movemask of bytes that end the run.
+
+const char *SkipBlanksSse2(const char *p, const char *end) {
+    if (p < end && !IsBlank(*p)) {
+        return p;
+    }
+    const auto space = _mm_set1_epi8(' ');
+    const auto tab = _mm_set1_epi8('\t');
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto blank = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab));
+        u32 stop = ~_mm_movemask_epi8(blank) & 0xFFFFu;
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return SkipBlanksScalar(p, end);
+}
+
+const char *SkipIdentSse2(const char *p, const char *end) {
+    const auto case_bit = _mm_set1_epi8(0x20);
+    const auto before_a = _mm_set1_epi8('a' - 1);
+    const auto after_z = _mm_set1_epi8('z' + 1);
+    const auto before_0 = _mm_set1_epi8('0' - 1);
+    const auto after_9 = _mm_set1_epi8('9' + 1);
+    const auto underscore = _mm_set1_epi8('_');
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        // bytes >= 0x80 are negative for the signed compares and drop out
+        auto lower = _mm_or_si128(v, case_bit);
+        auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a),
+                                   _mm_cmplt_epi8(lower, after_z));
+        auto digit = _mm_and_si128(_mm_cmpgt_epi8(v, before_0),
+                                   _mm_cmplt_epi8(v, after_9));
+        auto ident = _mm_or_si128(_mm_or_si128(alpha, digit),
+                                  _mm_cmpeq_epi8(v, underscore));
+        u32 stop = ~_mm_movemask_epi8(ident) & 0xFFFFu;
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return SkipIdentScalar(p, end);
+}
+
+const char *FindStarSse2(const char *p, const char *end) {
+    const auto star = _mm_set1_epi8('*');
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        u32 stop = _mm_movemask_epi8(_mm_cmpeq_epi8(v, star));
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return FindStarScalar(p, end);
+}
+
+const char *FindStrStopSse2(const char *p, const char *end) {
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        u32 stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                  _mm_cmpeq_epi8(v, backslash)));
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return FindStrStopScalar(p, end);
+}
+
+const ScanKernels SSE2 = {
+    "sse2",
+    SkipBlanksSse2,
+    SkipIdentSse2,
+    FindStarSse2,
+    FindStrStopSse2,
+};
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 const char *SkipBlanksAvx2(const char *p, const char *end) {
+    if (p < end && !IsBlank(*p)) {
+        return p;
+    }
+    const auto space = _mm256_set1_epi8(' ');
+    const auto tab = _mm256_set1_epi8('\t');
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto blank = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                     _mm256_cmpeq_epi8(v, tab));
+        u32 stop = ~static_cast<u32>(_mm256_movemask_epi8(blank));
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return SkipBlanksSse2(p, end);
+}
+
+TARGET_AVX2 const char *SkipIdentAvx2(const char *p, const char *end) {
+    const auto case_bit = _mm256_set1_epi8(0x20);
+    const auto before_a = _mm256_set1_epi8('a' - 1);
+    const auto after_z = _mm256_set1_epi8('z' + 1);
+    const auto before_0 = _mm256_set1_epi8('0' - 1);
+    const auto after_9 = _mm256_set1_epi8('9' + 1);
+    const auto underscore = _mm256_set1_epi8('_');
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto lower = _mm256_or_si256(v, case_bit);
+        auto alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, before_a),
+                                      _mm256_cmpgt_epi8(after_z, lower));
+        auto digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, before_0),
+                                      _mm256_cmpgt_epi8(after_9, v));
+        auto ident = _mm256_or_si256(_mm256_or_si256(alpha, digit),
+                                     _mm256_cmpeq_epi8(v, underscore));
+        u32 stop = ~static_cast<u32>(_mm256_movemask_epi8(ident));
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return SkipIdentSse2(p, end);
+}
+
+TARGET_AVX2 const char *FindStarAvx2(const char *p, const char *end) {
+    const auto star = _mm256_set1_epi8('*');
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        u32 stop = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, star));
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return FindStarSse2(p, end);
+}
+
+TARGET_AVX2 const char *FindStrStopAvx2(const char *p, const char *end) {
+    const auto quote = _mm256_set1_epi8('"');
+    const auto backslash = _mm256_set1_epi8('\\');
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        u32 stop = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                                        _mm256_cmpeq_epi8(v, backslash)));
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return FindStrStopSse2(p, end);
+}
+
+#undef TARGET_AVX2
+
+const ScanKernels AVX2 = {
+    "avx2",
+    SkipBlanksAvx2,
+    SkipIdentAvx2,
+    FindStarAvx2,
+    FindStrStopAvx2,
+};
+
+bool HasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // TIGER_SCAN_X86
+
+} // namespace
+
+const ScanKernels &ScanKernels::Get() {
+    static const ScanKernels &kernels = *Available().back();
+    return kernels;
+}
+
+std::vector<const ScanKernels *> ScanKernels::Available() {
+    auto result = std::vector<const ScanKernels *>{&SCALAR};
+#ifdef TIGER_SCAN_X86
+    result.push_back(&SSE2);
+    if (HasAvx2()) {
+        result.push_back(&AVX2);
+    }
+#endif
+    return result;
+}
@@ -0,0 +1,36 @@
+#ifndef TIGER_CC_SCAN_KERNELS_H
+#define TIGER_CC_SCAN_KERNELS_H
+
+#include "common.h"
+
+#include <vector>
+
+/**
+ * @brief the lexer's inner loops: each kernel returns the first byte in
+ * [p, end) that ends the current run, or `end` if there is none.
+ *
+ * SkipBlanks   first byte that is not ' ' or '\t'
+ * SkipIdent    first byte that is not [A-Za-z0-9_]
+ * FindStar     first '*', the only byte that can close a comment
+ * FindStrStop  first '"' or '\\' inside a string literal
+ *
+ * x86-64 gets SSE2 (always there) and AVX2 versions which look at 16/32
+ * bytes per step. The fastest one the cpu supports is picked on first use.
+ */
+struct ScanKernels {
+    using Kernel = const char *(*)(const char *p, const char *end);
+
+    const char *name;
+    Kernel SkipBlanks;
+    Kernel SkipIdent;
+    Kernel FindStar;
+    Kernel FindStrStop;
+
+    // kernels picked for this cpu
+    static const ScanKernels &Get();
+
+    // every implementation this build and cpu can run, scalar first
+    static std::vector<const ScanKernels *> Available();
+};
+
+#endif // TIGER_CC_SCAN_KERNELS_H
@@ -3,3 +3,77 @@
 //
 
 #include "symbol.h"
+
+#include <cassert>
+
+static thread_local const SymbolPool *current_pool = nullptr;
+
+std::string_view Symbol::Name() const {
+    assert(current_pool != nullptr);
+    return current_pool->Name(*this);
+}
+
+SymbolPool::SymbolPool(): slots_(64, 0) {
+    // id 0, the invalid symbol
+    names_.emplace_back();
+    hashes_.push_back(0);
+}
+
+Symbol SymbolPool::Intern(std::string_view name) {
+    auto hash = std::hash<std::string_view>()(name);
+    auto slot = Probe(name, hash);
+    if (slots_[slot] != 0) {
+        return Symbol(slots_[slot]);
+    }
+
+    auto id = static_cast<u32>(names_.size());
+    names_.emplace_back(name);
+    hashes_.push_back(hash);
+    slots_[slot] = id;
+    // keep the load factor under 1/2
+    if (names_.size() * 2 > slots_.size()) {
+        Grow();
+    }
+    return Symbol(id);
+}
+
+Symbol SymbolPool::Find(std::string_view name) const {
+    auto hash = std::hash<std::string_view>()(name);
+    return Symbol(slots_[Probe(name, hash)]);
+}
+
+// the slot holding `name`, or the empty slot where it would go
+u32 SymbolPool::Probe(std::string_view name, size_t hash) const {
+    auto mask = slots_.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto id = slots_[i];
+        if (id == 0 || (hashes_[id] == hash && names_[id] == name)) {
+            return static_cast<u32>(i);
+        }
+    }
+}
+
+void SymbolPool::Grow() {
+    auto slots = std::vector<u32>(slots_.size() * 2, 0);
+    auto mask = slots.size() - 1;
+    for (u32 id = 1; id < names_.size(); ++id) {
+        auto i = hashes_[id] & mask;
+        while (slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+    slots_ = std::move(slots);
+}
+
+const SymbolPool *SymbolPool::Current() {
+    return current_pool;
+}
+
+SymbolPool::Use::Use(const SymbolPool &pool): prev_(current_pool) {
+    current_pool = &pool;
+}
+
+SymbolPool::Use::~Use() {
+    current_pool = prev_;
+}
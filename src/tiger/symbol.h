@@ -5,10 +5,108 @@
 #ifndef TIGER_CC_SYMBOL_H
 #define TIGER_CC_SYMBOL_H
 
+#include "common.h"
 
-class symbol {
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
 
+/**
+ * @brief an interned name. Two symbols of the same SymbolPool are equal
+ * iff their names are, so comparing and hashing is comparing a u32.
+ * Id 0 is reserved for "no symbol".
+ */
+class Symbol {
+public:
+    Symbol() = default;
+    explicit Symbol(u32 id): id_(id) {}
+
+    u32 Id() const {
+        return id_;
+    }
+
+    bool Valid() const {
+        return id_ != 0;
+    }
+
+    bool operator==(const Symbol &rhs) const {
+        return id_ == rhs.id_;
+    }
+
+    bool operator!=(const Symbol &rhs) const {
+        return id_ != rhs.id_;
+    }
+
+    bool operator<(const Symbol &rhs) const {
+        return id_ < rhs.id_;
+    }
+
+    // name in the current thread's pool, see SymbolPool::Use
+    std::string_view Name() const;
+
+private:
+    u32 id_ {0};
 };
 
+template <>
+struct std::hash<Symbol> {
+    size_t operator()(const Symbol &s) const noexcept {
+        return s.Id();
+    }
+};
+
+/**
+ * @brief string pool of one compilation. Names are stored once and
+ * never move, so the views handed out stay valid as long as the pool.
+ *
+ * Interning is not thread safe, a pool is filled by one thread (the
+ * lexer) and then only read.
+ */
+class SymbolPool {
+public:
+    SymbolPool();
+    SymbolPool(const SymbolPool &) = delete;
+    SymbolPool &operator=(const SymbolPool &) = delete;
+
+    Symbol Intern(std::string_view name);
+
+    // the symbol of `name` if it was interned, an invalid one otherwise
+    Symbol Find(std::string_view name) const;
+
+    std::string_view Name(Symbol symbol) const {
+        return names_[symbol.Id()];
+    }
+
+    u32 Size() const {
+        return static_cast<u32>(names_.size());
+    }
+
+    // pool that Symbol::Name reads on this thread
+    static const SymbolPool *Current();
+
+    // make `pool` the current one of this thread until destroyed
+    class Use {
+    public:
+        explicit Use(const SymbolPool &pool);
+        ~Use();
+        Use(const Use &) = delete;
+        Use &operator=(const Use &) = delete;
+
+    private:
+        const SymbolPool *prev_;
+    };
+
+private:
+    u32 Probe(std::string_view name, size_t hash) const;
+    void Grow();
+
+private:
+    // open addressing over symbol ids, 0 marks an empty slot
+    std::vector<u32> slots_;
+    std::vector<size_t> hashes_;
+    std::deque<std::string> names_;
+};
 
 #endif //TIGER_CC_SYMBOL_H
@@ -3,11 +3,17 @@
 
 #include "common.h"
 #include "../utils/error.h"
+#include "../utils/source_loc.h"
 
+#include <cassert>
+#include <iterator>
+#include <optional>
 #include <utility>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 template <typename K, typename V>
 using Map = std::unordered_map<K, V>;
@@ -18,13 +24,20 @@ using Set = std::unordered_set<K>;
 class Lexer;
 class Parser;
 
+/**
+ * @brief a token is a plain 16 bytes value: tag, the span it covers in the
+ * source and one extra slot. The slot holds the value of a NUM, the
+ * symbol id of an ID and the index of a STR in TokenArena's literal
+ * table, it is 0 for other tags.
+ * The spelling of a token is never copied, use TokenArena::Text to get it.
+ */
 class Token {
 public:
     friend class Lexer;
     friend class Parser;
 
 public:
-    enum class Tag {
+    enum class Tag: u8 {
         // keywords
         ARRAY,
         IF,
@@ -95,36 +108,44 @@ public:
         // numbers
         NUM,
 
-        // invalid characters
+        // invalid characters, or an integer literal out of range
         INVALID,
     };
 
 public:
-    Token(Tag tag, std::string &&var):
-        tag_(tag), var_(std::move(var)) {}
+    Token() = default;
+    Token(Tag tag, u32 offset, u32 length, u32 value = 0):
+        tag_(tag), offset_(offset), length_(length), value_(value) {}
 
-    Token(Tag tag, const std::string &var):
-        tag_(tag), var_(var) {}
-
-    bool operator==(const Token &rhs) {
-        return rhs.tag_ == tag_ && rhs.var_ == var_;
+    bool operator==(const Token &rhs) const {
+        return rhs.tag_ == tag_ && rhs.offset_ == offset_
+            && rhs.length_ == length_ && rhs.value_ == value_;
     }
 
     const std::string Name() const {
-        auto node = tag_name_m_.find(tag_);
-        assert(node != tag_name_m_.end());
-        return node->second;
+        return TagStr(tag_);
     }
 
     const Tag Type() const {
         return tag_;
     }
 
-    const std::string Value() const {
-        if (tag_ == Tag::EOL) {
-            return "\\r\\n";
-        }
-        return var_;
+    // offset of the first character in the source
+    u32 Offset() const {
+        return offset_;
+    }
+
+    SourceLoc Loc() const {
+        return SourceLoc(offset_);
+    }
+
+    u32 Length() const {
+        return length_;
+    }
+
+    // numeric value of a NUM, symbol id of an ID, literal index of a STR
+    u32 Slot() const {
+        return value_;
     }
 
     const bool IsOperator() const {
@@ -137,30 +158,237 @@ public:
     }
 
     static std::string TagStr(Tag tag) {
-        auto it = tag_name_m_.find(tag);
-        if (it == tag_name_m_.end()) {
+        auto i = static_cast<u8>(tag);
+        if (i >= std::size(TAG_NAMES)) {
             PANIC("invalid token tag")
         }
-        return it->second;
+        return std::string(TAG_NAMES[i]);
     }
 
-    static std::optional<Tag> IsKeyword(const std::string &str) {
-        auto it = keywords_m_.find(str);
-        if (it == keywords_m_.end()) {
-            return std::nullopt;
-        } else {
-            return it->second;
+    static constexpr std::optional<Tag> IsKeyword(std::string_view str);
+
+private:
+    Tag tag_ {Tag::INVALID};
+    u32 offset_ {0};
+    u32 length_ {0};
+    u32 value_ {0};
+
+private:
+    // name of every tag for messages, in the order of Tag. a constant
+    // table, so nothing is built when the compiler starts
+    static constexpr std::string_view TAG_NAMES[] = {
+        "array",
+        "if",
+        "then",
+        "else",
+        "while",
+        "for",
+        "to",
+        "do",
+        "let",
+        "in",
+        "end",
+        "of",
+        "break",
+        "nil",
+        "function",
+        "var",
+        "type",
+        "import",
+        "primitive",
+        "class",
+        "extends",
+        "method",
+        "new",
+        "comma",
+        "colon",
+        "semicolon",
+        "left parenthesis",
+        "right parenthesis",
+        "left square brace",
+        "right square brace",
+        "left brace",
+        "right brace",
+        "dot",
+        "plus",
+        "minus",
+        "star",
+        "div",
+        "equal",
+        "not equal",
+        "less",
+        "greater",
+        "less or equal",
+        "greater or equal",
+        "and",
+        "or",
+        "assign",
+        "whitespace",
+        "end of line",
+        "string",
+        "comment",
+        "identifier",
+        "number",
+        "invalid",
+    };
+    static_assert(std::size(TAG_NAMES) == static_cast<size_t>(Tag::INVALID) + 1,
+            "every token tag needs a name");
+};
+
+static_assert(sizeof(Token) == 16, "Token should stay a compact value type");
+
+/**
+ * @brief keyword recognition without allocation or runtime hashing.
+ * KEYWORD_SLOTS is a perfect hash table over KEYWORDS built at compile
+ * time: an identifier is a keyword iff it equals the entry in its slot.
+ */
+struct Keyword {
+    std::string_view name;
+    Token::Tag tag;
+};
+
+//‘array’, ‘if’, ‘then’, ‘else’, ‘while’, ‘
+// for’, ‘to’, ‘do’, ‘let’, ‘in’, ‘end’, ‘of’,
+// ‘break’, ‘nil’, ‘function’, ‘var’, ‘type’, ‘import’ and ‘primitive’
+inline constexpr Keyword KEYWORDS[] = {
+    { "array", Token::Tag::ARRAY },
+    { "if", Token::Tag::IF },
+    { "then", Token::Tag::THEN },
+    { "else", Token::Tag::ELSE },
+    { "while", Token::Tag::WHILE },
+    { "for", Token::Tag::FOR },
+    { "to", Token::Tag::TO },
+    { "do", Token::Tag::DO },
+    { "let", Token::Tag::LET },
+    { "in", Token::Tag::IN },
+    { "end", Token::Tag::END },
+    { "of", Token::Tag::OF },
+    { "break", Token::Tag::BREAK },
+    { "nil", Token::Tag::NIL },
+    { "function", Token::Tag::FUNCTION },
+    { "var", Token::Tag::VAR },
+    { "type", Token::Tag::TYPE },
+    { "import", Token::Tag::IMPORT },
+    { "primitive", Token::Tag::PRIMITIVE },
+    { "class", Token::Tag::CLASS },
+    { "extends", Token::Tag::EXTENDS },
+    { "method", Token::Tag::METHOD },
+    { "new", Token::Tag::NEW },
+};
+
+inline constexpr u32 KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+inline constexpr u32 KEYWORD_SLOT_BITS = 6;
+inline constexpr size_t KEYWORD_MIN_LEN = 2;
+inline constexpr size_t KEYWORD_MAX_LEN = 9;
+
+// multiplicative hash of (first char, last char, length), which is
+// already distinct for every keyword
+constexpr u32 KeywordHash(std::string_view str, u32 seed) {
+    auto key = static_cast<u32>(static_cast<u8>(str.front())) << 16
+             | static_cast<u32>(static_cast<u8>(str.back())) << 8
+             | static_cast<u32>(str.size());
+    return (key * seed) >> (32 - KEYWORD_SLOT_BITS);
+}
+
+// slot -> index into KEYWORDS plus one, 0 marks an empty slot.
+// `perfect` is false if `seed` makes two keywords collide.
+struct KeywordSlots {
+    u8 slot[1u << KEYWORD_SLOT_BITS] {};
+    bool perfect {true};
+};
+
+constexpr KeywordSlots MakeKeywordSlots(u32 seed) {
+    auto table = KeywordSlots();
+    for (u32 i = 0; i < KEYWORD_COUNT; ++i) {
+        auto &slot = table.slot[KeywordHash(KEYWORDS[i].name, seed)];
+        if (slot != 0) {
+            table.perfect = false;
+            return table;
         }
+        slot = static_cast<u8>(i + 1);
     }
+    return table;
+}
 
+// smallest seed without collisions, found by brute force. if the keyword
+// set changes, search for a new one (or widen KEYWORD_SLOT_BITS).
+inline constexpr u32 KEYWORD_SEED = 31318;
+inline constexpr KeywordSlots KEYWORD_SLOTS = MakeKeywordSlots(KEYWORD_SEED);
+static_assert(KEYWORD_SLOTS.perfect, "KEYWORD_SEED is not a perfect hash for KEYWORDS");
+
+constexpr std::optional<Token::Tag> Token::IsKeyword(std::string_view str) {
+    if (str.size() < KEYWORD_MIN_LEN || str.size() > KEYWORD_MAX_LEN) {
+        return std::nullopt;
+    }
+    auto slot = KEYWORD_SLOTS.slot[KeywordHash(str, KEYWORD_SEED)];
+    if (slot != 0 && KEYWORDS[slot - 1].name == str) {
+        return KEYWORDS[slot - 1].tag;
+    }
+    return std::nullopt;
+}
+
+static_assert(Token::IsKeyword("primitive") == Token::Tag::PRIMITIVE);
+static_assert(!Token::IsKeyword("functions"));
+
+using TokenVec = std::vector<Token>;
+
+/**
+ * @brief per-compilation storage of tokens. Tokens are kept contiguously,
+ * string literals (whose value differs from their spelling once escapes
+ * are decoded) live in a side table indexed by Token::Slot.
+ */
+class TokenArena {
 public:
-    Tag tag_;
-    std::string var_;
+    explicit TokenArena(std::string_view source): source_(source) {}
+
+    std::string_view Source() const {
+        return source_;
+    }
+
+    // the text a token stands for: the decoded value of a string literal,
+    // the source spelling of anything else.
+    std::string_view Text(const Token &token) const {
+        if (token.Type() == Token::Tag::STR) {
+            return literals_[token.Slot()];
+        }
+        return source_.substr(token.Offset(), token.Length());
+    }
+
+    u32 AddLiteral(std::string &&literal) {
+        literals_.push_back(std::move(literal));
+        return static_cast<u32>(literals_.size() - 1);
+    }
+
+    const std::string &Literal(u32 slot) const {
+        return literals_[slot];
+    }
+
+    std::string &Literal(u32 slot) {
+        return literals_[slot];
+    }
+
+    void Push(const Token &token) {
+        tokens_.push_back(token);
+    }
+
+    // make room for `tokens` more tokens
+    void Reserve(size_t tokens) {
+        tokens_.reserve(tokens_.size() + tokens);
+    }
+
+    const TokenVec &Tokens() const {
+        return tokens_;
+    }
+
+    // after an edit: the tokens now describe `source`, tokens
+    // [first, last) are replaced with `tokens` and the ones after them
+    // move `delta` bytes
+    void Splice(std::string_view source, u32 first, u32 last, const TokenVec &tokens, i32 delta);
 
 private:
-    static const Map<Tag, std::string> tag_name_m_;
-    static const Map<std::string, Tag> keywords_m_;
-    static const Set<Tag> operator_set;
+    std::string_view source_;
+    TokenVec tokens_;
+    std::vector<std::string> literals_;
 };
 
 #endif // TIGER_CC_TOKEN_H
\ No newline at end of file
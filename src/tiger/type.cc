@@ -0,0 +1,125 @@
+#include "type.h"
+
+#include <algorithm>
+
+TypePtr Type::Actual() const {
+    auto type = this;
+    while (type->IsNameType() && type->As<NameType>()->Target() != nullptr) {
+        type = type->As<NameType>()->Target();
+    }
+    return type;
+}
+
+bool Type::Accepts(const Type *value) const {
+    auto to = Actual();
+    auto from = value->Actual();
+    if (to == from || to->IsErrorType() || from->IsErrorType()) {
+        return true;
+    }
+    if (from->IsNilType()) {
+        return to->IsRecordType() || to->IsClassType();
+    }
+    return to->IsClassType() && from->IsClassType()
+           && from->As<ClassType>()->Inherits(to->As<ClassType>());
+}
+
+std::string Type::ToString() const {
+    switch (tag_) {
+        case Tag::RECORD:
+            return std::string(As<RecordType>()->Name().Name());
+        case Tag::NIL:
+            return "nil";
+        case Tag::INT:
+            return "int";
+        case Tag::STRING:
+            return "string";
+        case Tag::ARRAY:
+            return std::string(As<ArrayType>()->Name().Name());
+        case Tag::NAME:
+            return std::string(As<NameType>()->Name().Name());
+        case Tag::VOID:
+            return "void";
+        case Tag::CLASS: {
+            auto name = As<ClassType>()->Name();
+            return name.Valid() ? std::string(name.Name()) : "Object";
+        }
+        case Tag::FUNCTION: {
+            auto fn = As<FunctionType>();
+            auto s = std::string("function(");
+            for (u32 i = 0; i < fn->Params().size(); ++i) {
+                s += (i == 0 ? "" : ", ") + fn->Params()[i]->ToString();
+            }
+            return s + "): " + fn->Result()->ToString();
+        }
+        case Tag::ERROR:
+            return "<error>";
+    }
+    return "";
+}
+
+const TypeField *ClassType::FindAttribute(Symbol name) const {
+    for (auto c = this; c != nullptr; c = c->parent_) {
+        for (auto &attr : c->attributes_) {
+            if (attr.name == name) {
+                return &attr;
+            }
+        }
+    }
+    return nullptr;
+}
+
+const TypeField *ClassType::FindMethod(Symbol name) const {
+    for (auto c = this; c != nullptr; c = c->parent_) {
+        for (auto &method : c->methods_) {
+            if (method.name == name) {
+                return &method;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool ClassType::Inherits(const ClassType *ancestor) const {
+    for (auto c = this; c != nullptr; c = c->parent_) {
+        if (c == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TypeContext::TypeContext():
+    int_(arena_.New<Type>(Type::Tag::INT)),
+    string_(arena_.New<Type>(Type::Tag::STRING)),
+    nil_(arena_.New<Type>(Type::Tag::NIL)),
+    void_(arena_.New<Type>(Type::Tag::VOID)),
+    error_(arena_.New<Type>(Type::Tag::ERROR)),
+    object_(arena_.New<ClassType>(Symbol())) {}
+
+const FunctionType *TypeContext::Function(std::vector<TypePtr> params, TypePtr result) {
+    for (auto &param : params) {
+        param = param->Actual();
+    }
+    result = result->Actual();
+    auto lock = std::lock_guard<std::mutex>(mu_);
+    auto key = FunctionKey{params.data(), static_cast<u32>(params.size()), result};
+    auto it = functions_.find(key);
+    if (it != functions_.end()) {
+        return it->second;
+    }
+    auto fn = arena_.New<FunctionType>(arena_.Copy(params), result);
+    functions_.emplace(FunctionKey{fn->Params().begin(), fn->Params().size(), result}, fn);
+    return fn;
+}
+
+bool TypeContext::FunctionKey::operator==(const FunctionKey &rhs) const {
+    return size == rhs.size && result == rhs.result && std::equal(params, params + size, rhs.params);
+}
+
+size_t TypeContext::FunctionHash::operator()(const FunctionKey &key) const {
+    auto h = std::hash<TypePtr>()(key.result);
+    for (u32 i = 0; i < key.size; ++i) {
+        h = h * 31 + std::hash<TypePtr>()(key.params[i]);
+    }
+    return h;
+}
@@ -1,129 +1,384 @@
 #ifndef TIGER_CC_TYPE_H
 #define TIGER_CC_TYPE_H
 
+#include "symbol.h"
+#include "../utils/arena.h"
+
+#include <cassert>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief a semantic type. Types are made by a TypeContext only, which
+ * makes each type once: two types are the same exactly when their
+ * pointers are. What kind of type it is is a tag in the object, there
+ * is no virtual call anywhere.
+ *
+ * Records, arrays and classes are nominal in tiger, there is one of
+ * them per declaration. A NAME stands for a type of the declaration
+ * group being resolved, it may not be known yet, Actual() sees through.
+ */
 class Type {
 public:
-    enum class Tag {
+    enum class Tag: u8 {
         RECORD,
         NIL,
         INT,
         STRING,
         ARRAY,
         NAME,
-        VOID
+        VOID,
+        CLASS,
+        FUNCTION,
+        // an expression that had an error, it fits anywhere so that one
+        // mistake is reported once
+        ERROR,
     };
 
 public:
-    virtual ~Type() = default;
+    explicit Type(Tag tag): tag_(tag) {}
+
+    Tag GetTag() const {
+        return tag_;
+    }
+
+    bool IsRecordType() const {
+        return tag_ == Tag::RECORD;
+    }
 
-    virtual Tag GetType() {
-        return Tag::VOID;
+    bool IsNilType() const {
+        return tag_ == Tag::NIL;
     }
 
-    virtual bool IsRecordType() {
-        return false;
+    bool IsIntType() const {
+        return tag_ == Tag::INT;
     }
 
-    virtual bool IsNilType() {
-        return false;
+    bool IsStringType() const {
+        return tag_ == Tag::STRING;
     }
 
-    virtual bool IsIntType() {
-        return false;
+    bool IsArrayType() const {
+        return tag_ == Tag::ARRAY;
     }
 
-    virtual bool IsStringType() {
-        return false;
+    bool IsNameType() const {
+        return tag_ == Tag::NAME;
     }
 
-    virtual bool IsArrayType() {
-        return false;
+    bool IsVoidType() const {
+        return tag_ == Tag::VOID;
     }
 
-    virtual bool IsNameType() {
-        return false;
+    bool IsClassType() const {
+        return tag_ == Tag::CLASS;
     }
 
-    virtual bool IsVoidType() {
-        return false;
+    bool IsFunctionType() const {
+        return tag_ == Tag::FUNCTION;
     }
+
+    bool IsErrorType() const {
+        return tag_ == Tag::ERROR;
+    }
+
+    // the subclass for the tag, checked in debug builds only
+    template <typename T>
+    const T *As() const {
+        assert(tag_ == T::TAG);
+        return static_cast<const T *>(this);
+    }
+
+    // what a NAME stands for, the type itself for every other tag
+    const Type *Actual() const;
+
+    // can a value of type `value` go where this type is expected: the
+    // same type, nil for a record or an object, an object of a subclass
+    bool Accepts(const Type *value) const;
+
+    // for messages
+    std::string ToString() const;
+
+private:
+    Tag tag_;
+};
+
+using TypePtr = const Type *;
+
+struct TypeField {
+    Symbol name;
+    // may be a NAME, use Actual()
+    TypePtr type;
 };
 
 class RecordType: public Type {
 public:
-    bool IsRecordType() {
-        return true;
+    static constexpr Tag TAG = Tag::RECORD;
+
+    explicit RecordType(Symbol name): Type(TAG), name_(name) {}
+
+    Symbol Name() const {
+        return name_;
     }
-    
-    Tag GetType() {
-        return Tag::RECORD;
+
+    Span<TypeField> Fields() const {
+        return fields_;
     }
-};
 
-class NilType: public Type {
-public:
-    bool IsNilType() {
-        return true;
+    // index of the field `name`, -1 if there is none
+    i32 Find(Symbol name) const {
+        for (u32 i = 0; i < fields_.size(); ++i) {
+            if (fields_[i].name == name) {
+                return static_cast<i32>(i);
+            }
+        }
+        return -1;
     }
-    
-    Tag GetType() {
-        return Tag::NIL;
+
+    void SetFields(Span<TypeField> fields) {
+        fields_ = fields;
     }
+
+private:
+    Symbol name_;
+    Span<TypeField> fields_;
 };
 
-class IntType: public Type {
+class ArrayType: public Type {
 public:
-    bool IsIntType() {
-        return true;
+    static constexpr Tag TAG = Tag::ARRAY;
+
+    explicit ArrayType(Symbol name): Type(TAG), name_(name) {}
+
+    Symbol Name() const {
+        return name_;
+    }
+
+    TypePtr Elem() const {
+        return elem_->Actual();
     }
-    
-    Tag GetType() {
-        return Tag::INT;
+
+    void SetElem(TypePtr elem) {
+        elem_ = elem;
     }
+
+private:
+    Symbol name_;
+    TypePtr elem_ {nullptr};
 };
 
-class StringType: public Type {
+class NameType: public Type {
 public:
-    bool IsStringType() {
-        return true;
+    static constexpr Tag TAG = Tag::NAME;
+
+    explicit NameType(Symbol name): Type(TAG), name_(name) {}
+
+    Symbol Name() const {
+        return name_;
     }
-    
-    Tag GetType() {
-        return Tag::STRING;
+
+    // nullptr until the group it belongs to is resolved
+    TypePtr Target() const {
+        return target_;
     }
+
+    void SetTarget(TypePtr target) {
+        target_ = target;
+    }
+
+private:
+    Symbol name_;
+    TypePtr target_ {nullptr};
 };
 
-class ArrayType: public Type {
+class FunctionType: public Type {
 public:
-    bool IsArrayType() {
-        return true;
+    static constexpr Tag TAG = Tag::FUNCTION;
+
+    FunctionType(Span<TypePtr> params, TypePtr result):
+        Type(TAG), params_(params), result_(result) {}
+
+    Span<TypePtr> Params() const {
+        return params_;
     }
-    
-    Tag GetType() {
-        return Tag::ARRAY;
+
+    TypePtr Result() const {
+        return result_;
     }
+
+private:
+    Span<TypePtr> params_;
+    TypePtr result_;
 };
 
-class NameType: public Type {
+class ClassType: public Type {
 public:
-    bool IsNameType() {
-        return true;
+    static constexpr Tag TAG = Tag::CLASS;
+
+    explicit ClassType(Symbol name): Type(TAG), name_(name) {}
+
+    Symbol Name() const {
+        return name_;
     }
-    
-    Tag GetType() {
-        return Tag::NAME;
+
+    // nullptr for Object
+    const ClassType *Parent() const {
+        return parent_;
+    }
+
+    Span<TypeField> Attributes() const {
+        return attributes_;
+    }
+
+    // the type of each method is a FUNCTION
+    Span<TypeField> Methods() const {
+        return methods_;
+    }
+
+    // the attribute or method `name` of the closest class up from this
+    // one that declares it, nullptr if none does
+    const TypeField *FindAttribute(Symbol name) const;
+    const TypeField *FindMethod(Symbol name) const;
+
+    // is this `ancestor` or a class derived from it
+    bool Inherits(const ClassType *ancestor) const;
+
+    void SetParent(const ClassType *parent) {
+        parent_ = parent;
     }
+
+    void SetMembers(Span<TypeField> attributes, Span<TypeField> methods) {
+        attributes_ = attributes;
+        methods_ = methods;
+    }
+
+private:
+    Symbol name_;
+    const ClassType *parent_ {nullptr};
+    Span<TypeField> attributes_;
+    Span<TypeField> methods_;
 };
 
-class VoidType: public Type {
+/**
+ * @brief makes and owns the types of a program, hash-consed: asking
+ * twice for the same type gives the same object, so comparing types is
+ * comparing pointers.
+ *
+ * A record, array, class or name is the type declared at `origin`, the
+ * declaration node, made empty the first time and filled in by whoever
+ * resolves the declaration. A function type is looked up by its
+ * parameters and result.
+ *
+ * Types can be made from several threads at once, one lock guards the
+ * tables and the arena; a type made for a declaration is changed only
+ * by the thread checking that declaration.
+ */
+class TypeContext {
 public:
-    bool IsVoidType() {
-        return true;
+    TypeContext();
+    TypeContext(const TypeContext &) = delete;
+    TypeContext &operator=(const TypeContext &) = delete;
+
+    TypePtr Int() const {
+        return int_;
+    }
+
+    TypePtr String() const {
+        return string_;
     }
-    
-    Tag GetType() {
-        return Tag::VOID;
+
+    TypePtr Nil() const {
+        return nil_;
+    }
+
+    TypePtr Void() const {
+        return void_;
     }
+
+    TypePtr Error() const {
+        return error_;
+    }
+
+    // the root of every class
+    const ClassType *Object() const {
+        return object_;
+    }
+
+    RecordType *Record(const void *origin, Symbol name) {
+        return Declared<RecordType>(origin, name);
+    }
+
+    ArrayType *Array(const void *origin, Symbol name) {
+        return Declared<ArrayType>(origin, name);
+    }
+
+    ClassType *Class(const void *origin, Symbol name) {
+        return Declared<ClassType>(origin, name);
+    }
+
+    NameType *Name(const void *origin, Symbol name) {
+        return Declared<NameType>(origin, name);
+    }
+
+    // NAMEs among `params` and `result` must be resolved, they are
+    // replaced by what they stand for
+    const FunctionType *Function(std::vector<TypePtr> params, TypePtr result);
+
+    Span<TypeField> Copy(const std::vector<TypeField> &fields) {
+        auto lock = std::lock_guard<std::mutex>(mu_);
+        return arena_.Copy(fields);
+    }
+
+    // types made so far
+    u32 Size() const {
+        return static_cast<u32>(arena_.Objects());
+    }
+
+private:
+    template <typename T>
+    T *Declared(const void *origin, Symbol name) {
+        auto lock = std::lock_guard<std::mutex>(mu_);
+        auto &type = declared_[{origin, T::TAG}];
+        if (type == nullptr) {
+            type = arena_.New<T>(name);
+        }
+        return static_cast<T *>(type);
+    }
+
+    struct DeclaredHash {
+        size_t operator()(const std::pair<const void *, Type::Tag> &key) const {
+            return std::hash<const void *>()(key.first) * 31 + static_cast<size_t>(key.second);
+        }
+    };
+
+    // a function type as it is looked up, the parameters are not copied
+    // until a new type is made
+    struct FunctionKey {
+        const TypePtr *params;
+        u32 size;
+        TypePtr result;
+
+        bool operator==(const FunctionKey &rhs) const;
+    };
+
+    struct FunctionHash {
+        size_t operator()(const FunctionKey &key) const;
+    };
+
+private:
+    std::mutex mu_;
+    Arena arena_;
+    TypePtr int_;
+    TypePtr string_;
+    TypePtr nil_;
+    TypePtr void_;
+    TypePtr error_;
+    ClassType *object_;
+    std::unordered_map<std::pair<const void *, Type::Tag>, Type *, DeclaredHash> declared_;
+    std::unordered_map<FunctionKey, const FunctionType *, FunctionHash> functions_;
 };
 
-#endif // TIGER_CC_TYPE_H
\ No newline at end of file
+#endif // TIGER_CC_TYPE_H
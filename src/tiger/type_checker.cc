@@ -3,3 +3,886 @@
 //
 
 #include "type_checker.h"
+#include "../utils/error.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+// `name`, for messages
+static std::string Quote(Symbol name) {
+    return "`" + std::string(name.Name()) + "`";
+}
+
+static u32 Length(Symbol name) {
+    return static_cast<u32>(name.Name().size());
+}
+
+TypeChecker::TypeChecker(TypeContext &types, const SymbolPool &symbols, Diagnostics *diags,
+                         ThreadPool *pool):
+    types_(types), symbols_(symbols), diags_(diags), pool_(pool), self_(symbols.Find("self")) {}
+
+// bodies nested in the ones it checks are checked on its own thread
+TypeChecker::TypeChecker(const TypeChecker &outer, std::vector<Diagnostic> *reports):
+    types_(outer.types_), symbols_(outer.symbols_), diags_(nullptr), pool_(nullptr), reports_(reports),
+    self_(outer.self_), type_env_(&outer.type_env_), value_env_(&outer.value_env_) {}
+
+TypePtr TypeChecker::Check(AstNodePtr root) {
+    type_env_.BeginScope();
+    value_env_.BeginScope();
+    BindBuiltins();
+    result_ = types_.Void();
+    if (root != nullptr) {
+        root->Accept(*this);
+    }
+    value_env_.EndScope();
+    type_env_.EndScope();
+    return result_;
+}
+
+// the types and functions of every program, only those the program
+// mentions are bound
+void TypeChecker::BindBuiltins() {
+    auto bind_type = [this](const char *name, TypePtr type) {
+        auto symbol = symbols_.Find(name);
+        if (symbol.Valid()) {
+            type_env_.Add(symbol, TypeTable::Borrow(type));
+        }
+    };
+    bind_type("int", types_.Int());
+    bind_type("string", types_.String());
+    bind_type("Object", types_.Object());
+
+    struct Builtin {
+        const char *name;
+        std::vector<TypePtr> params;
+        TypePtr result;
+    };
+    auto i = types_.Int();
+    auto s = types_.String();
+    auto v = types_.Void();
+    const Builtin BUILTINS[] = {
+        {"print", {s}, v},
+        {"print_err", {s}, v},
+        {"print_int", {i}, v},
+        {"flush", {}, v},
+        {"getchar", {}, s},
+        {"ord", {s}, i},
+        {"chr", {i}, s},
+        {"size", {s}, i},
+        {"substring", {s, i, i}, s},
+        {"concat", {s, s}, s},
+        {"strcmp", {s, s}, i},
+        {"streq", {s, s}, i},
+        {"not", {i}, i},
+        {"exit", {i}, v},
+    };
+    for (auto &builtin : BUILTINS) {
+        auto symbol = symbols_.Find(builtin.name);
+        if (symbol.Valid()) {
+            Bind(symbol, Entry::Kind::FUNCTION, types_.Function(builtin.params, builtin.result));
+        }
+    }
+}
+
+TypePtr TypeChecker::TypeOf(ExprPtr expr) {
+    expr->Accept(*this);
+    return result_;
+}
+
+TypePtr TypeChecker::LookupType(TypeIdPtr id) {
+    auto type = type_env_.Find(id->GetName());
+    if (type == nullptr) {
+        Report(id->Loc(), Length(id->GetName()), "unknown type " + Quote(id->GetName()));
+        return types_.Error();
+    }
+    return type.get();
+}
+
+void TypeChecker::Bind(Symbol name, Entry::Kind kind, TypePtr type) {
+    auto entry = entries_.New<Entry>(Entry{kind, type});
+    value_env_.Add(name, EnvTable<const Entry>::Borrow(entry));
+}
+
+void TypeChecker::Report(SourceLoc loc, u32 length, std::string message) {
+    if (reports_ != nullptr) {
+        reports_->push_back({Diagnostic::Severity::ERROR, loc, length, std::move(message)});
+        return;
+    }
+    if (diags_ == nullptr) {
+        PANIC(message.c_str())
+    }
+    diags_->Error(loc, length, std::move(message));
+}
+
+void TypeChecker::Expect(TypePtr want, TypePtr got, SourceLoc loc, const std::string &what) {
+    if (!want->Accepts(got)) {
+        Report(loc, 1, what + " should be " + want->ToString() + ", not " + got->ToString());
+    }
+}
+
+void TypeChecker::Visit(IntExprPtr node) {
+    result_ = types_.Int();
+}
+
+void TypeChecker::Visit(StrExprPtr node) {
+    result_ = types_.String();
+}
+
+void TypeChecker::Visit(NilExprPtr node) {
+    result_ = types_.Nil();
+}
+
+void TypeChecker::Visit(ExprSeqPtr node) {
+    node->GetExprs()->Accept(*this);
+}
+
+void TypeChecker::Visit(AssignmentPtr node) {
+    auto lvar = node->GetLvar();
+    auto &elems = lvar->GetElems();
+    if (elems.size() == 1 && elems[0]->GetIdxs().empty()) {
+        auto name = elems[0]->GetName()->GetName();
+        auto entry = value_env_.Find(name);
+        if (entry != nullptr && entry->kind == Entry::Kind::INDEX) {
+            Report(lvar->Loc(), Length(name), "cannot assign to the loop index " + Quote(name));
+        }
+    }
+    auto want = TypeOf(lvar);
+    auto got = TypeOf(node->GetExpr());
+    Expect(want, got, node->GetExpr()->Loc(), "the value assigned");
+    result_ = types_.Void();
+}
+
+void TypeChecker::Visit(UnaryExprPtr node) {
+    auto spelling = std::string(Operator::Spelling(node->GetOp().GetOp()));
+    Expect(types_.Int(), TypeOf(node->GetExpr()), node->Loc(), "the operand of `" + spelling + "`");
+    result_ = types_.Int();
+}
+
+// the value of the last one, void for none
+void TypeChecker::Visit(ExprsPtr node) {
+    result_ = types_.Void();
+    for (auto expr : node->GetExprs()) {
+        expr->Accept(*this);
+    }
+}
+
+void TypeChecker::Visit(BinaryExprPtr node) {
+    auto op = node->GetOp().GetOp();
+    auto lhs = TypeOf(node->GetLhs())->Actual();
+    auto rhs = TypeOf(node->GetRhs())->Actual();
+    auto what = "the operands of `" + std::string(Operator::Spelling(op)) + "`";
+    switch (op) {
+        case Op::EQ:
+        case Op::NOT_EQAL:
+            if (lhs->IsNilType() && rhs->IsNilType()) {
+                Report(node->Loc(), 1, "cannot compare nil with nil");
+            } else if (!lhs->Accepts(rhs) && !rhs->Accepts(lhs)) {
+                Report(node->Loc(), 1, what + " have different types, "
+                                       + lhs->ToString() + " and " + rhs->ToString());
+            }
+            break;
+        case Op::LESS:
+        case Op::GREATER:
+        case Op::LEQ:
+        case Op::GEQ:
+            if (lhs->IsErrorType() || rhs->IsErrorType()) {
+                break;
+            }
+            if (lhs != rhs || !(lhs->IsIntType() || lhs->IsStringType())) {
+                Report(node->Loc(), 1, what + " should both be int or both be string, not "
+                                       + lhs->ToString() + " and " + rhs->ToString());
+            }
+            break;
+        default:
+            Expect(types_.Int(), lhs, node->GetLhs()->Loc(), what);
+            Expect(types_.Int(), rhs, node->GetRhs()->Loc(), what);
+            break;
+    }
+    result_ = types_.Int();
+}
+
+void TypeChecker::Visit(ArrayCreatePtr node) {
+    auto id = node->GetTypeId();
+    auto type = LookupType(id)->Actual();
+    Expect(types_.Int(), TypeOf(node->GetLen()), node->GetLen()->Loc(), "the size of an array");
+    auto init = TypeOf(node->GetInit());
+    if (!type->IsArrayType()) {
+        if (!type->IsErrorType()) {
+            Report(id->Loc(), Length(id->GetName()), Quote(id->GetName()) + " is not an array type");
+        }
+        result_ = types_.Error();
+        return;
+    }
+    Expect(type->As<ArrayType>()->Elem(), init, node->GetInit()->Loc(), "the initial value of the elements");
+    result_ = type;
+}
+
+// the fields must be given in the order of the declaration
+void TypeChecker::Visit(RecordCreatePtr node) {
+    auto id = node->GetTypeId();
+    auto type = LookupType(id)->Actual();
+    auto &names = node->GetNames();
+    auto &vars = node->GetVars();
+    if (!type->IsRecordType()) {
+        if (!type->IsErrorType()) {
+            Report(id->Loc(), Length(id->GetName()), Quote(id->GetName()) + " is not a record type");
+        }
+        for (auto var : vars) {
+            TypeOf(var);
+        }
+        result_ = types_.Error();
+        return;
+    }
+
+    auto record = type->As<RecordType>();
+    auto fields = record->Fields();
+    for (u32 i = 0; i < vars.size(); ++i) {
+        auto got = TypeOf(vars[i]);
+        auto name = names[i]->GetName();
+        if (i >= fields.size() || fields[i].name != name) {
+            Report(names[i]->Loc(), Length(name), record->Find(name) < 0
+                   ? type->ToString() + " has no field " + Quote(name)
+                   : "field " + Quote(name) + " of " + type->ToString() + " is out of order");
+            continue;
+        }
+        Expect(fields[i].type, got, vars[i]->Loc(), "field " + Quote(name));
+    }
+    if (vars.size() < fields.size()) {
+        Report(id->Loc(), Length(id->GetName()), "field " + Quote(fields[vars.size()].name)
+                                                 + " of " + type->ToString() + " is missing");
+    }
+    result_ = type;
+}
+
+void TypeChecker::Visit(ObjectNewPtr node) {
+    auto id = node->GetTypeId();
+    auto type = LookupType(id)->Actual();
+    if (!type->IsClassType()) {
+        if (!type->IsErrorType()) {
+            Report(id->Loc(), Length(id->GetName()), Quote(id->GetName()) + " is not a class");
+        }
+        type = types_.Error();
+    }
+    result_ = type;
+}
+
+void TypeChecker::Visit(MethodCallPtr node) {
+    auto object = TypeOf(node->GetLvar())->Actual();
+    auto id = node->GetMethod();
+    auto name = id->GetName();
+    if (object->IsClassType()) {
+        auto method = object->As<ClassType>()->FindMethod(name);
+        if (method != nullptr) {
+            result_ = CheckCall(id->Loc(), name, method->type->As<FunctionType>(), node->GetArgs());
+            return;
+        }
+        Report(id->Loc(), Length(name), object->ToString() + " has no method " + Quote(name));
+    } else if (!object->IsErrorType()) {
+        Report(id->Loc(), Length(name), "cannot call method " + Quote(name)
+                                        + " on a value of type " + object->ToString());
+    }
+    for (auto arg : node->GetArgs()) {
+        TypeOf(arg);
+    }
+    result_ = types_.Error();
+}
+
+void TypeChecker::Visit(FnCallPtr node) {
+    auto id = node->GetName();
+    auto name = id->GetName();
+    auto entry = value_env_.Find(name);
+    if (entry == nullptr || entry->kind != Entry::Kind::FUNCTION) {
+        Report(id->Loc(), Length(name), entry == nullptr
+               ? "undeclared function " + Quote(name)
+               : Quote(name) + " is not a function");
+        for (auto arg : node->GetArgs()) {
+            TypeOf(arg);
+        }
+        result_ = types_.Error();
+        return;
+    }
+    result_ = CheckCall(id->Loc(), name, entry->type->As<FunctionType>(), node->GetArgs());
+}
+
+TypePtr TypeChecker::CheckCall(SourceLoc loc, Symbol name, const FunctionType *fn, const ExprPtrVec &args) {
+    auto params = fn->Params();
+    if (args.size() != params.size()) {
+        Report(loc, Length(name), Quote(name) + " takes " + std::to_string(params.size())
+                                  + " arguments but " + std::to_string(args.size()) + " were given");
+    }
+    for (u32 i = 0; i < args.size(); ++i) {
+        auto got = TypeOf(args[i]);
+        if (i < params.size()) {
+            Expect(params[i], got, args[i]->Loc(), "argument " + std::to_string(i + 1) + " of " + Quote(name));
+        }
+    }
+    return fn->Result();
+}
+
+// an `if` with both branches has the type of the more general one, nil
+// goes with any record
+void TypeChecker::Visit(IfStmtPtr node) {
+    Expect(types_.Int(), TypeOf(node->GetIf()), node->GetIf()->Loc(), "the condition of `if`");
+    auto then = TypeOf(node->GetThen());
+    if (node->GetElse() == nullptr) {
+        Expect(types_.Void(), then, node->GetThen()->Loc(), "an `if` without `else`");
+        result_ = types_.Void();
+        return;
+    }
+    auto other = TypeOf(node->GetElse());
+    if (then->Accepts(other)) {
+        result_ = then->Actual()->IsNilType() ? other : then;
+    } else if (other->Accepts(then)) {
+        result_ = other;
+    } else {
+        Report(node->GetElse()->Loc(), 1, "the branches of `if` have different types, "
+                                          + then->ToString() + " and " + other->ToString());
+        result_ = types_.Error();
+    }
+}
+
+void TypeChecker::Visit(WhileStmtPtr node) {
+    Expect(types_.Int(), TypeOf(node->GetWhile()), node->GetWhile()->Loc(), "the condition of `while`");
+    ++loops_;
+    Expect(types_.Void(), TypeOf(node->GetDo()), node->GetDo()->Loc(), "the body of `while`");
+    --loops_;
+    result_ = types_.Void();
+}
+
+void TypeChecker::Visit(ForStmtPtr node) {
+    Expect(types_.Int(), TypeOf(node->GetFrom()), node->GetFrom()->Loc(), "the start of `for`");
+    Expect(types_.Int(), TypeOf(node->GetTo()), node->GetTo()->Loc(), "the end of `for`");
+    value_env_.BeginScope();
+    Bind(node->GetId()->GetName(), Entry::Kind::INDEX, types_.Int());
+    ++loops_;
+    Expect(types_.Void(), TypeOf(node->GetDo()), node->GetDo()->Loc(), "the body of `for`");
+    --loops_;
+    value_env_.EndScope();
+    result_ = types_.Void();
+}
+
+void TypeChecker::Visit(BreakStmtPtr node) {
+    if (loops_ == 0) {
+        Report(node->Loc(), 5, "`break` outside of a loop");
+    }
+    result_ = types_.Void();
+}
+
+void TypeChecker::Visit(LetStmtPtr node) {
+    type_env_.BeginScope();
+    value_env_.BeginScope();
+    node->GetDecs()->Accept(*this);
+    node->GetExprs()->Accept(*this);
+    value_env_.EndScope();
+    type_env_.EndScope();
+}
+
+// the variable an lvalue starts with, or the field of `base_` it goes
+// on with, then indexed by each of the indices
+void TypeChecker::Visit(ElemPtr node) {
+    auto id = node->GetName();
+    auto name = id->GetName();
+    auto type = types_.Error();
+    if (base_ == nullptr) {
+        auto entry = value_env_.Find(name);
+        if (entry == nullptr || entry->kind == Entry::Kind::FUNCTION) {
+            Report(id->Loc(), Length(name), entry == nullptr
+                   ? "undeclared variable " + Quote(name)
+                   : Quote(name) + " is a function, not a variable");
+        } else {
+            type = entry->type;
+        }
+    } else if (base_->IsRecordType()) {
+        auto record = base_->As<RecordType>();
+        auto i = record->Find(name);
+        if (i < 0) {
+            Report(id->Loc(), Length(name), base_->ToString() + " has no field " + Quote(name));
+        } else {
+            type = record->Fields()[i].type;
+        }
+    } else if (base_->IsClassType()) {
+        auto attribute = base_->As<ClassType>()->FindAttribute(name);
+        if (attribute == nullptr) {
+            Report(id->Loc(), Length(name), base_->ToString() + " has no attribute " + Quote(name));
+        } else {
+            type = attribute->type;
+        }
+    } else if (!base_->IsErrorType()) {
+        Report(id->Loc(), Length(name), "cannot select " + Quote(name) + " from a value of type "
+                                        + base_->ToString() + ", it is not a record");
+    }
+
+    type = type->Actual();
+    for (auto idx : node->GetIdxs()) {
+        Expect(types_.Int(), TypeOf(idx), idx->Loc(), "an array index");
+        if (type->IsArrayType()) {
+            type = type->As<ArrayType>()->Elem();
+        } else {
+            if (!type->IsErrorType()) {
+                Report(idx->Loc(), 1, "cannot index a value of type " + type->ToString() + ", it is not an array");
+            }
+            type = types_.Error();
+        }
+    }
+    result_ = type;
+}
+
+void TypeChecker::Visit(LvarPtr node) {
+    auto type = TypePtr();
+    for (auto elem : node->GetElems()) {
+        base_ = type;
+        elem->Accept(*this);
+        type = result_;
+    }
+    base_ = nullptr;
+    result_ = type;
+}
+
+// type fields and class members are checked with the declaration that
+// holds them, see CheckTypeDecs and CheckFnDecs
+void TypeChecker::Visit(ClassFieldsPtr node) {}
+
+void TypeChecker::Visit(TypeFieldsPtr node) {}
+
+void TypeChecker::Visit(MethodDecPtr node) {}
+
+void TypeChecker::Visit(AttrDecPtr node) {}
+
+// a declaration visited on its own is a group of one
+void TypeChecker::Visit(TypeDecPtr node) {
+    DecPtr dec = node;
+    CheckTypeDecs(Span<DecPtr>(&dec, 1));
+}
+
+void TypeChecker::Visit(ClassDefPtr node) {
+    DecPtr dec = node;
+    CheckTypeDecs(Span<DecPtr>(&dec, 1));
+}
+
+void TypeChecker::Visit(FnDecPtr node) {
+    DecPtr dec = node;
+    CheckFnDecs(Span<DecPtr>(&dec, 1));
+}
+
+void TypeChecker::Visit(PrimDecPtr node) {
+    DecPtr dec = node;
+    CheckFnDecs(Span<DecPtr>(&dec, 1));
+}
+
+// modules are not loaded by this front end, an import binds nothing
+void TypeChecker::Visit(ImportDecPtr node) {
+    result_ = types_.Void();
+}
+
+void TypeChecker::Visit(VarDecPtr node) {
+    auto id = node->GetName();
+    auto init = TypeOf(node->GetVar());
+    auto type = init;
+    if (node->GetTypeId() != nullptr) {
+        type = LookupType(node->GetTypeId());
+        Expect(type, init, node->GetVar()->Loc(), "the initial value of " + Quote(id->GetName()));
+    } else if (init->IsNilType()) {
+        Report(node->GetVar()->Loc(), 3, "the type of " + Quote(id->GetName())
+                                         + " must be declared, nil has no type of its own");
+        type = types_.Error();
+    }
+    Bind(id->GetName(), Entry::Kind::VAR, type->Actual());
+    result_ = types_.Void();
+}
+
+// consecutive type declarations, and consecutive function declarations,
+// are checked as a group
+void TypeChecker::Visit(DecsPtr node) {
+    auto is_type = [](DecPtr dec) {
+        return dynamic_cast<TypeDecPtr>(dec) != nullptr || dynamic_cast<ClassDefPtr>(dec) != nullptr;
+    };
+    auto is_function = [](DecPtr dec) {
+        return dynamic_cast<FnDecPtr>(dec) != nullptr || dynamic_cast<PrimDecPtr>(dec) != nullptr;
+    };
+    auto &decs = node->GetDecs();
+    for (u32 i = 0; i < decs.size();) {
+        auto end = i + 1;
+        if (is_type(decs[i])) {
+            while (end < decs.size() && is_type(decs[end])) {
+                ++end;
+            }
+            CheckTypeDecs(Span<DecPtr>(decs.begin() + i, end - i));
+        } else if (is_function(decs[i])) {
+            while (end < decs.size() && is_function(decs[end])) {
+                ++end;
+            }
+            CheckFnDecs(Span<DecPtr>(decs.begin() + i, end - i));
+        } else {
+            decs[i]->Accept(*this);
+        }
+        i = end;
+    }
+    result_ = types_.Void();
+}
+
+// the definitions of a type group, `declaring_` at `origin_` is the name
+// being defined
+
+void TypeChecker::Visit(TypeAliasPtr node) {
+    result_ = LookupType(node->GetAlias());
+}
+
+void TypeChecker::Visit(RecordDefPtr node) {
+    auto record = types_.Record(origin_, declaring_);
+    auto &names = node->GetRecords()->GetNames();
+    auto &types = node->GetRecords()->GetTypes();
+    auto fields = std::vector<TypeField>();
+    fields.reserve(names.size());
+    auto seen = std::unordered_set<Symbol>();
+    for (u32 i = 0; i < names.size(); ++i) {
+        auto name = names[i]->GetName();
+        if (!seen.insert(name).second) {
+            Report(names[i]->Loc(), Length(name), "field " + Quote(name) + " is declared twice");
+        }
+        fields.push_back({name, LookupType(types[i])});
+    }
+    record->SetFields(types_.Copy(fields));
+    result_ = record;
+}
+
+void TypeChecker::Visit(ArrayDefPtr node) {
+    auto array = types_.Array(origin_, declaring_);
+    array->SetElem(LookupType(node->GetTypeId()));
+    result_ = array;
+}
+
+// the members of a class are filled in once the whole group is known
+void TypeChecker::Visit(ClassTypeDefPtr node) {
+    result_ = types_.Class(origin_, declaring_);
+}
+
+// every name of the group is bound to a placeholder NAME first, so the
+// definitions can refer to any of them, then each definition is made
+// and its placeholder pointed at it; the aliases and the parents of the
+// classes are resolved last, in time linear in the size of the group.
+void TypeChecker::CheckTypeDecs(Span<DecPtr> decs) {
+    auto names = std::vector<NameType *>();
+    auto ids = std::vector<IdPtr>();
+    auto records = std::vector<RecordType *>();
+    auto arrays = std::vector<ArrayType *>();
+    auto classes = std::vector<ClassDecl>();
+    names.reserve(decs.size());
+    ids.reserve(decs.size());
+    auto seen = std::unordered_set<Symbol>();
+    for (auto dec : decs) {
+        auto type_dec = dynamic_cast<TypeDecPtr>(dec);
+        auto id = type_dec != nullptr ? type_dec->GetName() : static_cast<ClassDefPtr>(dec)->GetName();
+        auto name = id->GetName();
+        if (!seen.insert(name).second) {
+            Report(id->Loc(), Length(name), "type " + Quote(name) + " is declared twice in the same group");
+        }
+        auto placeholder = types_.Name(dec, name);
+        placeholder->SetTarget(nullptr);
+        type_env_.Add(name, TypeTable::Borrow(placeholder));
+        names.push_back(placeholder);
+        ids.push_back(id);
+    }
+
+    for (u32 i = 0; i < decs.size(); ++i) {
+        declaring_ = ids[i]->GetName();
+        origin_ = decs[i];
+        if (auto type_dec = dynamic_cast<TypeDecPtr>(decs[i]); type_dec != nullptr) {
+            type_dec->GetType()->Accept(*this);
+            if (dynamic_cast<RecordDefPtr>(type_dec->GetType()) != nullptr) {
+                records.push_back(types_.Record(origin_, declaring_));
+            } else if (dynamic_cast<ArrayDefPtr>(type_dec->GetType()) != nullptr) {
+                arrays.push_back(types_.Array(origin_, declaring_));
+            }
+            if (auto def = dynamic_cast<ClassTypeDefPtr>(type_dec->GetType()); def != nullptr) {
+                classes.push_back({types_.Class(origin_, declaring_), def->GetParent(), def->GetFields()});
+            }
+        } else {
+            auto def = static_cast<ClassDefPtr>(decs[i]);
+            result_ = types_.Class(origin_, declaring_);
+            classes.push_back({types_.Class(origin_, declaring_), def->GetParent(), def->GetFields()});
+        }
+        names[i]->SetTarget(result_);
+    }
+
+    ResolveAliases(names, ids);
+    // from now on the names stand for their types directly, and so do
+    // the fields and elements that were given one of them
+    for (u32 i = 0; i < decs.size(); ++i) {
+        type_env_.Add(ids[i]->GetName(), TypeTable::Borrow(names[i]->Actual()));
+    }
+    for (auto record : records) {
+        for (auto &field : record->Fields()) {
+            field.type = field.type->Actual();
+        }
+    }
+    for (auto array : arrays) {
+        array->SetElem(array->Elem());
+    }
+
+    for (auto &c : classes) {
+        auto parent = c.parent != nullptr ? LookupType(c.parent)->Actual() : types_.Object();
+        if (!parent->IsClassType()) {
+            if (!parent->IsErrorType()) {
+                Report(c.parent->Loc(), Length(c.parent->GetName()), Quote(c.parent->GetName())
+                                                                     + " is not a class");
+            }
+            parent = types_.Object();
+        }
+        c.type->SetParent(parent->As<ClassType>());
+    }
+    // a parent has its members before any of its subclasses looks at them
+    for (auto i : ResolveParents(classes)) {
+        CheckClass(classes[i].type, classes[i].fields);
+    }
+    auto bodies = std::vector<Body>();
+    for (auto &c : classes) {
+        MethodBodies(c.type, c.fields, bodies);
+    }
+    CheckBodies(bodies);
+    result_ = types_.Void();
+}
+
+// points every placeholder of a group straight at the type it stands
+// for, like the find of a union-find with full path compression: a chain
+// of aliases is walked once, and every placeholder on it is then done.
+// Meeting a placeholder of the walk being made again is a cycle, which is
+// reported at its first declared name; every name on or into it becomes
+// an ERROR.
+void TypeChecker::ResolveAliases(const std::vector<NameType *> &names, const std::vector<IdPtr> &ids) {
+    enum class State: u8 {
+        NEW,
+        ON_PATH,
+        DONE,
+    };
+    auto index = std::unordered_map<TypePtr, u32>();
+    index.reserve(names.size());
+    for (u32 i = 0; i < names.size(); ++i) {
+        index.emplace(names[i], i);
+    }
+    auto state = std::vector<State>(names.size(), State::NEW);
+    auto path = std::vector<u32>();
+    for (u32 i = 0; i < names.size(); ++i) {
+        auto target = TypePtr(nullptr);
+        for (auto j = i; state[j] == State::NEW;) {
+            state[j] = State::ON_PATH;
+            path.push_back(j);
+            auto next = names[j]->Target();
+            auto it = next->IsNameType() ? index.find(next) : index.end();
+            if (it == index.end()) {
+                target = next->Actual();
+            } else if (state[it->second] == State::DONE) {
+                target = names[it->second]->Target();
+            } else if (state[it->second] == State::ON_PATH) {
+                auto first = it->second;
+                for (auto k = std::find(path.begin(), path.end(), it->second); k != path.end(); ++k) {
+                    first = std::min(first, *k);
+                }
+                Report(ids[first]->Loc(), Length(ids[first]->GetName()), "type " + Quote(ids[first]->GetName())
+                                                                         + " is an alias of itself");
+                target = types_.Error();
+            } else {
+                j = it->second;
+            }
+        }
+        for (auto j : path) {
+            names[j]->SetTarget(target);
+            state[j] = State::DONE;
+        }
+        path.clear();
+    }
+}
+
+// the classes of a group in an order where a parent comes before its
+// subclasses, walking each chain of parents once the same way as
+// ResolveAliases. A class that inherits from itself is reported and
+// derives from Object instead.
+std::vector<u32> TypeChecker::ResolveParents(std::vector<ClassDecl> &classes) {
+    enum class State: u8 {
+        NEW,
+        ON_PATH,
+        DONE,
+    };
+    auto index = std::unordered_map<const ClassType *, u32>();
+    index.reserve(classes.size());
+    for (u32 i = 0; i < classes.size(); ++i) {
+        index.emplace(classes[i].type, i);
+    }
+    auto state = std::vector<State>(classes.size(), State::NEW);
+    auto path = std::vector<u32>();
+    auto order = std::vector<u32>();
+    order.reserve(classes.size());
+    for (u32 i = 0; i < classes.size(); ++i) {
+        for (auto j = i; state[j] == State::NEW;) {
+            state[j] = State::ON_PATH;
+            path.push_back(j);
+            auto it = index.find(classes[j].type->Parent());
+            if (it == index.end() || state[it->second] == State::DONE) {
+                break;
+            }
+            if (state[it->second] == State::ON_PATH) {
+                auto &c = classes[j];
+                Report(c.parent->Loc(), Length(c.parent->GetName()), "class " + c.type->ToString()
+                                                                     + " inherits from itself");
+                c.type->SetParent(types_.Object());
+                break;
+            }
+            j = it->second;
+        }
+        for (auto j = path.rbegin(); j != path.rend(); ++j) {
+            state[*j] = State::DONE;
+            order.push_back(*j);
+        }
+        path.clear();
+    }
+    return order;
+}
+
+// the attributes and method signatures of `type`, a method overriding
+// one of a parent keeps its signature
+void TypeChecker::CheckClass(ClassType *type, ClassFieldsPtr fields) {
+    auto attributes = std::vector<TypeField>();
+    auto methods = std::vector<TypeField>();
+    auto seen = std::unordered_set<Symbol>();
+    for (auto field : fields->GetFields()) {
+        if (auto attr = dynamic_cast<AttrDecPtr>(field); attr != nullptr) {
+            auto var = attr->GetAttr();
+            auto id = var->GetName();
+            auto init = TypeOf(var->GetVar());
+            auto attr_type = init;
+            if (var->GetTypeId() != nullptr) {
+                attr_type = LookupType(var->GetTypeId());
+                Expect(attr_type, init, var->GetVar()->Loc(), "the initial value of " + Quote(id->GetName()));
+            } else if (init->IsNilType()) {
+                Report(var->GetVar()->Loc(), 3, "the type of " + Quote(id->GetName())
+                                                + " must be declared, nil has no type of its own");
+                attr_type = types_.Error();
+            }
+            if (!seen.insert(id->GetName()).second || type->Parent()->FindAttribute(id->GetName()) != nullptr) {
+                Report(id->Loc(), Length(id->GetName()), "attribute " + Quote(id->GetName())
+                                                         + " of " + type->ToString() + " is declared twice");
+            }
+            attributes.push_back({id->GetName(), attr_type->Actual()});
+            continue;
+        }
+
+        auto method = static_cast<MethodDecPtr>(field);
+        auto id = method->GetName();
+        auto signature = Signature(method->GetArgs(), method->GetRet());
+        if (!seen.insert(id->GetName()).second) {
+            Report(id->Loc(), Length(id->GetName()), "method " + Quote(id->GetName())
+                                                     + " of " + type->ToString() + " is declared twice");
+        } else if (auto inherited = type->Parent()->FindMethod(id->GetName());
+                   inherited != nullptr && inherited->type != signature) {
+            Report(id->Loc(), Length(id->GetName()), "method " + Quote(id->GetName()) + " should have the type "
+                                                     + inherited->type->ToString() + " of the method it overrides, not "
+                                                     + signature->ToString());
+        }
+        methods.push_back({id->GetName(), signature});
+    }
+    type->SetMembers(types_.Copy(attributes), types_.Copy(methods));
+}
+
+void TypeChecker::MethodBodies(const ClassType *type, ClassFieldsPtr fields, std::vector<Body> &bodies) {
+    u32 i = 0;
+    for (auto field : fields->GetFields()) {
+        if (auto method = dynamic_cast<MethodDecPtr>(field); method != nullptr) {
+            auto signature = type->Methods()[i++].type->As<FunctionType>();
+            bodies.push_back({method->GetArgs(), signature, method->GetBody(), type, method->GetName()->GetName()});
+        }
+    }
+}
+
+// all the headers of a function group are bound before the bodies are
+// checked, so they can call each other
+void TypeChecker::CheckFnDecs(Span<DecPtr> decs) {
+    auto signatures = std::vector<const FunctionType *>();
+    signatures.reserve(decs.size());
+    auto seen = std::unordered_set<Symbol>();
+    for (auto dec : decs) {
+        auto fn = dynamic_cast<FnDecPtr>(dec);
+        auto prim = static_cast<PrimDecPtr>(dec);
+        auto id = fn != nullptr ? fn->GetName() : prim->GetName();
+        auto signature = fn != nullptr
+                         ? Signature(fn->GetArgs(), fn->GetRet())
+                         : Signature(prim->GetArgs(), prim->GetRet());
+        if (!seen.insert(id->GetName()).second) {
+            Report(id->Loc(), Length(id->GetName()), "function " + Quote(id->GetName())
+                                                     + " is declared twice in the same group");
+        }
+        Bind(id->GetName(), Entry::Kind::FUNCTION, signature);
+        signatures.push_back(signature);
+    }
+    auto bodies = std::vector<Body>();
+    bodies.reserve(decs.size());
+    for (u32 i = 0; i < decs.size(); ++i) {
+        if (auto fn = dynamic_cast<FnDecPtr>(decs[i]); fn != nullptr) {
+            bodies.push_back({fn->GetArgs(), signatures[i], fn->GetBody(), nullptr, fn->GetName()->GetName()});
+        }
+    }
+    CheckBodies(bodies);
+    result_ = types_.Void();
+}
+
+const FunctionType *TypeChecker::Signature(TypeFieldsPtr args, TypeIdPtr ret) {
+    auto params = std::vector<TypePtr>();
+    params.reserve(args->GetTypes().size());
+    for (auto type : args->GetTypes()) {
+        params.push_back(LookupType(type));
+    }
+    return types_.Function(std::move(params), ret != nullptr ? LookupType(ret) : types_.Void());
+}
+
+// the bodies of one group, which don't depend on each other: on this
+// thread, or spread over the pool when there are enough of them. Every
+// pool thread takes the next body nobody has taken yet until none is
+// left, so a thread that got cheap bodies goes on with more of them.
+void TypeChecker::CheckBodies(const std::vector<Body> &bodies) {
+    auto n = static_cast<u32>(bodies.size());
+    if (pool_ == nullptr || pool_->Size() == 1 || n < 2 * pool_->Size()) {
+        for (auto &body : bodies) {
+            CheckBody(body);
+        }
+        return;
+    }
+    auto reports = std::vector<std::vector<Diagnostic>>(n);
+    auto next = std::atomic<u32>(0);
+    pool_->ParallelFor(pool_->Size(), [&](u32) {
+        auto use_symbols = SymbolPool::Use(symbols_);
+        auto checker = TypeChecker(*this, nullptr);
+        for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < n;
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            checker.reports_ = &reports[i];
+            checker.CheckBody(bodies[i]);
+        }
+    });
+    for (auto &body_reports : reports) {
+        for (auto &report : body_reports) {
+            Report(report.loc, report.length, std::move(report.message));
+        }
+    }
+}
+
+// a body sees its parameters, and `self` in a method, a `break` in it
+// can't leave a loop around the function
+void TypeChecker::CheckBody(const Body &body) {
+    value_env_.BeginScope();
+    if (body.self != nullptr && self_.Valid()) {
+        Bind(self_, Entry::Kind::VAR, body.self);
+    }
+    auto &names = body.args->GetNames();
+    auto seen = std::unordered_set<Symbol>();
+    for (u32 i = 0; i < names.size(); ++i) {
+        auto param = names[i]->GetName();
+        if (!seen.insert(param).second) {
+            Report(names[i]->Loc(), Length(param), "parameter " + Quote(param) + " is declared twice");
+        }
+        Bind(param, Entry::Kind::VAR, body.signature->Params()[i]);
+    }
+    auto loops = loops_;
+    loops_ = 0;
+    Expect(body.signature->Result(), TypeOf(body.body), body.body->Loc(), "the body of " + Quote(body.name));
+    loops_ = loops;
+    value_env_.EndScope();
+}
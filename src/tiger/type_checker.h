@@ -5,12 +5,156 @@
 #ifndef TIGER_CC_TYPE_CHECKER_H
 #define TIGER_CC_TYPE_CHECKER_H
 
+#include "env.h"
+#include "type.h"
+#include "visitor.h"
+#include "../utils/diagnostics.h"
+#include "../utils/thread_pool.h"
 
+/**
+ * @brief semantic analysis: binds every name to its declaration and
+ * works out the type of every expression, reporting what is wrong to
+ * `diags` and going on, an expression with an error has the ERROR type
+ * and is not reported again.
+ *
+ * Consecutive type (and class) declarations form a group that may refer
+ * to each other, so do consecutive function declarations; the headers
+ * of a group are bound before any of its bodies is checked.
+ *
+ * Types come from `types` and compare by pointer, checking the same
+ * tree twice with one TypeContext gives the same types.
+ *
+ * With a `pool`, the bodies of a group are checked on its threads once
+ * the headers are bound. Every thread binds in scopes of its own over
+ * the tables of the group, which no one changes meanwhile, and keeps
+ * what it reports per body; the reports are added to `diags` in the
+ * order of the bodies, the same as checking them one after the other.
+ */
+class TypeChecker: public Visitor {
+public:
+    TypeChecker(TypeContext &types, const SymbolPool &symbols, Diagnostics *diags,
+                ThreadPool *pool = nullptr);
 
-class type_checker {
+    // the type of the program `root`, an expression or the declarations
+    // of a module
+    TypePtr Check(AstNodePtr root);
 
-};
+    void Visit(IntExprPtr node) final;
+    void Visit(StrExprPtr node) final;
+    void Visit(NilExprPtr node) final;
+    void Visit(ExprSeqPtr node) final;
+    void Visit(AssignmentPtr node) final;
+    void Visit(UnaryExprPtr node) final;
+    void Visit(ExprsPtr node) final;
+    void Visit(BinaryExprPtr node) final;
+    void Visit(ArrayCreatePtr node) final;
+    void Visit(RecordCreatePtr node) final;
+    void Visit(ObjectNewPtr node) final;
+    void Visit(MethodCallPtr node) final;
+    void Visit(FnCallPtr node) final;
+    void Visit(IfStmtPtr node) final;
+    void Visit(WhileStmtPtr node) final;
+    void Visit(ForStmtPtr node) final;
+    void Visit(BreakStmtPtr node) final;
+    void Visit(LetStmtPtr node) final;
+    void Visit(ElemPtr node) final;
+    void Visit(LvarPtr node) final;
+    void Visit(ClassFieldsPtr node) final;
+    void Visit(TypeFieldsPtr node) final;
+    void Visit(TypeDecPtr node) final;
+    void Visit(VarDecPtr node) final;
+    void Visit(DecsPtr node) final;
+    void Visit(MethodDecPtr node) final;
+    void Visit(AttrDecPtr node) final;
+    void Visit(FnDecPtr node) final;
+    void Visit(PrimDecPtr node) final;
+    void Visit(ImportDecPtr node) final;
+    void Visit(TypeAliasPtr node) final;
+    void Visit(RecordDefPtr node) final;
+    void Visit(ArrayDefPtr node) final;
+    void Visit(ClassDefPtr node) final;
+    void Visit(ClassTypeDefPtr node) final;
+
+private:
+    // what a name in an expression is bound to
+    struct Entry {
+        enum class Kind: u8 {
+            VAR,
+            // a for loop index, it can't be assigned
+            INDEX,
+            FUNCTION,
+        };
+
+        Kind kind;
+        TypePtr type;
+    };
+
+    // a function or method body to check, see CheckBody
+    struct Body {
+        TypeFieldsPtr args;
+        const FunctionType *signature;
+        ExprPtr body;
+        // the class of a method
+        const ClassType *self;
+        Symbol name;
+    };
+
+    // a class of the type group being checked
+    struct ClassDecl {
+        ClassType *type;
+        TypeIdPtr parent;
+        ClassFieldsPtr fields;
+    };
+
+    // checks bodies for `outer` on another thread, reporting to `reports`
+    TypeChecker(const TypeChecker &outer, std::vector<Diagnostic> *reports);
 
+    TypePtr TypeOf(ExprPtr expr);
+    TypePtr LookupType(TypeIdPtr id);
+    void Bind(Symbol name, Entry::Kind kind, TypePtr type);
+    void BindBuiltins();
 
+    void Report(SourceLoc loc, u32 length, std::string message);
+    // report that `what` has type `got` where `want` was expected
+    void Expect(TypePtr want, TypePtr got, SourceLoc loc, const std::string &what);
+
+    void CheckTypeDecs(Span<DecPtr> decs);
+    void ResolveAliases(const std::vector<NameType *> &names, const std::vector<IdPtr> &ids);
+    std::vector<u32> ResolveParents(std::vector<ClassDecl> &classes);
+    void CheckClass(ClassType *type, ClassFieldsPtr fields);
+    void MethodBodies(const ClassType *type, ClassFieldsPtr fields, std::vector<Body> &bodies);
+    void CheckFnDecs(Span<DecPtr> decs);
+    const FunctionType *Signature(TypeFieldsPtr args, TypeIdPtr ret);
+    void CheckBodies(const std::vector<Body> &bodies);
+    void CheckBody(const Body &body);
+    TypePtr CheckCall(SourceLoc loc, Symbol name, const FunctionType *fn, const ExprPtrVec &args);
+
+private:
+    TypeContext &types_;
+    const SymbolPool &symbols_;
+    Diagnostics *diags_;
+    // nullptr to check every body on this thread
+    ThreadPool *pool_;
+    // where a checker on a pool thread reports, instead of `diags_`
+    std::vector<Diagnostic> *reports_ {nullptr};
+    // `self` in a method
+    Symbol self_;
+
+    TypeTable type_env_;
+    EnvTable<const Entry> value_env_;
+    // entries live here, the tables only borrow them
+    Arena entries_;
+
+    // the type of the expression visited last
+    TypePtr result_ {nullptr};
+    // the type an element of an lvalue is selected from, nullptr for the
+    // variable it starts with
+    TypePtr base_ {nullptr};
+    // the name and node of the type declaration being resolved
+    Symbol declaring_;
+    const void *origin_ {nullptr};
+    // loops around the expression, in the function being checked
+    u32 loops_ {0};
+};
 
 #endif //TIGER_CC_TYPE_CHECKER_H
@@ -5,4 +5,52 @@
 #ifndef TIGER_CC_VISITOR_H
 #define TIGER_CC_VISITOR_H
 
+#include "ast.h"
+
+/**
+ * @brief a pass over the ast. `node->Accept(v)` calls the `Visit` of `v`
+ * for the class of `node`, a pass goes on to the children it cares about
+ * itself, in the order it needs them.
+ */
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+
+    virtual void Visit(IntExprPtr node) = 0;
+    virtual void Visit(StrExprPtr node) = 0;
+    virtual void Visit(NilExprPtr node) = 0;
+    virtual void Visit(ExprSeqPtr node) = 0;
+    virtual void Visit(AssignmentPtr node) = 0;
+    virtual void Visit(UnaryExprPtr node) = 0;
+    virtual void Visit(ExprsPtr node) = 0;
+    virtual void Visit(BinaryExprPtr node) = 0;
+    virtual void Visit(ArrayCreatePtr node) = 0;
+    virtual void Visit(RecordCreatePtr node) = 0;
+    virtual void Visit(ObjectNewPtr node) = 0;
+    virtual void Visit(MethodCallPtr node) = 0;
+    virtual void Visit(FnCallPtr node) = 0;
+    virtual void Visit(IfStmtPtr node) = 0;
+    virtual void Visit(WhileStmtPtr node) = 0;
+    virtual void Visit(ForStmtPtr node) = 0;
+    virtual void Visit(BreakStmtPtr node) = 0;
+    virtual void Visit(LetStmtPtr node) = 0;
+    virtual void Visit(ElemPtr node) = 0;
+    virtual void Visit(LvarPtr node) = 0;
+    virtual void Visit(ClassFieldsPtr node) = 0;
+    virtual void Visit(TypeFieldsPtr node) = 0;
+    virtual void Visit(TypeDecPtr node) = 0;
+    virtual void Visit(VarDecPtr node) = 0;
+    virtual void Visit(DecsPtr node) = 0;
+    virtual void Visit(MethodDecPtr node) = 0;
+    virtual void Visit(AttrDecPtr node) = 0;
+    virtual void Visit(FnDecPtr node) = 0;
+    virtual void Visit(PrimDecPtr node) = 0;
+    virtual void Visit(ImportDecPtr node) = 0;
+    virtual void Visit(TypeAliasPtr node) = 0;
+    virtual void Visit(RecordDefPtr node) = 0;
+    virtual void Visit(ArrayDefPtr node) = 0;
+    virtual void Visit(ClassDefPtr node) = 0;
+    virtual void Visit(ClassTypeDefPtr node) = 0;
+};
+
 #endif //TIGER_CC_VISITOR_H
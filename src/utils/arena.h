@@ -0,0 +1,146 @@
+#ifndef TIGER_CC_ARENA_H
+#define TIGER_CC_ARENA_H
+
+#include "../tiger/common.h"
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief fixed size view of `size` objects living in an Arena.
+ */
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(T *data, u32 size): data_(data), size_(size) {}
+
+    T *begin() const {
+        return data_;
+    }
+
+    T *end() const {
+        return data_ + size_;
+    }
+
+    u32 size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    T &operator[](u32 i) const {
+        return data_[i];
+    }
+
+    T &back() const {
+        return data_[size_ - 1];
+    }
+
+private:
+    T *data_ {nullptr};
+    u32 size_ {0};
+};
+
+/**
+ * @brief bump pointer allocator. Objects are carved out of large blocks
+ * one after another and all released at once with the arena; their
+ * destructors never run, so whatever lives here must not own memory
+ * elsewhere (strings and arrays go through Copy instead).
+ */
+class Arena {
+public:
+    static constexpr size_t BLOCK_SIZE = 64 << 10;
+
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    Arena(Arena &&) = default;
+    Arena &operator=(Arena &&) = default;
+
+    void *Allocate(size_t size, size_t align) {
+        auto p = AlignUp(cur_, align);
+        if (p + size > end_) {
+            // a big request gets a block of its own, so the rest of the
+            // current block is not thrown away
+            if (size + align > BLOCK_SIZE / 4) {
+                return reinterpret_cast<void *>(AlignUp(NewBlock(size + align), align));
+            }
+            cur_ = NewBlock(BLOCK_SIZE);
+            end_ = cur_ + BLOCK_SIZE;
+            p = AlignUp(cur_, align);
+        }
+        cur_ = p + size;
+        return reinterpret_cast<void *>(p);
+    }
+
+    template <typename T, typename... Args>
+    T *New(Args&&... args) {
+        ++objects_;
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // copy `items` into the arena
+    template <typename T>
+    Span<T> Copy(const std::vector<T> &items) {
+        if (items.empty()) {
+            return Span<T>();
+        }
+        auto data = static_cast<T *>(Allocate(sizeof(T) * items.size(), alignof(T)));
+        std::uninitialized_copy(items.begin(), items.end(), data);
+        return Span<T>(data, static_cast<u32>(items.size()));
+    }
+
+    std::string_view Copy(std::string_view s) {
+        auto data = static_cast<char *>(Allocate(s.size(), 1));
+        memcpy(data, s.data(), s.size());
+        return std::string_view(data, s.size());
+    }
+
+    // take over the blocks of `other`, its objects now live as long as
+    // this arena
+    void Adopt(Arena &&other) {
+        for (auto &block : other.blocks_) {
+            blocks_.push_back(std::move(block));
+        }
+        reserved_ += other.reserved_;
+        objects_ += other.objects_;
+        other = Arena();
+    }
+
+    // bytes handed out by all blocks so far
+    size_t Reserved() const {
+        return reserved_;
+    }
+
+    // objects made with New so far
+    size_t Objects() const {
+        return objects_;
+    }
+
+private:
+    static uintptr_t AlignUp(uintptr_t p, size_t align) {
+        return (p + align - 1) & ~(align - 1);
+    }
+
+    uintptr_t NewBlock(size_t size) {
+        blocks_.emplace_back(new char[size]);
+        reserved_ += size;
+        return reinterpret_cast<uintptr_t>(blocks_.back().get());
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    uintptr_t cur_ {0};
+    uintptr_t end_ {0};
+    size_t reserved_ {0};
+    size_t objects_ {0};
+};
+
+#endif // TIGER_CC_ARENA_H
@@ -0,0 +1,34 @@
+#include "diagnostics.h"
+
+#include <algorithm>
+
+void Diagnostics::Report(Diagnostic::Severity severity, SourceLoc loc, u32 length, std::string message) {
+    if (severity == Diagnostic::Severity::ERROR) {
+        ++errors_;
+    }
+    diags_.push_back({severity, loc, length, std::move(message)});
+}
+
+void Diagnostics::Print(std::ostream &out) const {
+    static const char *SEVERITIES[] = {"error", "warning", "note"};
+    for (auto &diag : diags_) {
+        auto [line, column] = lines_.LineColumn(diag.loc);
+        out << file_ << ':' << line << ':' << column << ": "
+            << SEVERITIES[static_cast<u8>(diag.severity)] << ": " << diag.message << '\n';
+
+        // the line, then a caret under the span; tabs are kept so the
+        // caret lines up however the terminal expands them
+        auto text = lines_.Line(line);
+        out << "  " << text << "\n  ";
+        for (u32 i = 0; i + 1 < column && i < text.size(); ++i) {
+            out << (text[i] == '\t' ? '\t' : ' ');
+        }
+        out << '^';
+        auto rest = text.size() - std::min<u64>(text.size(), column - 1);
+        auto width = std::min<u64>(diag.length, rest);
+        for (u64 i = 1; i < width; ++i) {
+            out << '~';
+        }
+        out << '\n';
+    }
+}
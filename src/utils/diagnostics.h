@@ -0,0 +1,70 @@
+#ifndef TIGER_CC_DIAGNOSTICS_H
+#define TIGER_CC_DIAGNOSTICS_H
+
+#include "source_loc.h"
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct Diagnostic {
+    enum class Severity: u8 {
+        ERROR,
+        WARNING,
+        NOTE,
+    };
+
+    Severity severity;
+    // the span of source it is about
+    SourceLoc loc;
+    u32 length;
+    std::string message;
+};
+
+/**
+ * @brief collects the diagnostics of one source file instead of stopping
+ * at the first one, and prints them as `file:line:col: error: message`
+ * with the offending line underneath.
+ *
+ * Diagnostics keep a SourceLoc, lines and columns are only worked out
+ * by the LineTable when printing.
+ */
+class Diagnostics {
+public:
+    Diagnostics(std::string_view source, std::string file):
+        lines_(source), file_(std::move(file)) {}
+
+    void Report(Diagnostic::Severity severity, SourceLoc loc, u32 length, std::string message);
+
+    void Error(SourceLoc loc, u32 length, std::string message) {
+        Report(Diagnostic::Severity::ERROR, loc, length, std::move(message));
+    }
+
+    u32 ErrorCount() const {
+        return errors_;
+    }
+
+    bool HasErrors() const {
+        return errors_ != 0;
+    }
+
+    const std::vector<Diagnostic> &All() const {
+        return diags_;
+    }
+
+    const LineTable &Lines() const {
+        return lines_;
+    }
+
+    void Print(std::ostream &out) const;
+
+private:
+    LineTable lines_;
+    std::string file_;
+    std::vector<Diagnostic> diags_;
+    u32 errors_ {0};
+};
+
+#endif // TIGER_CC_DIAGNOSTICS_H
@@ -14,8 +14,8 @@ public:
 template <>
 class Printer<Token> {
 public:
-    static std::string print(const Token &token) {
-        return token.Name() + "(" + token.Value() + ")";
+    static std::string print(const Token &token, const TokenArena &arena) {
+        return token.Name() + "(" + std::string(arena.Text(token)) + ")";
     }
 };
 
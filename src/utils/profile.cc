@@ -0,0 +1,133 @@
+#include "profile.h"
+
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// the heap counters of the phase running on this thread, null outside one
+static thread_local Profile::Heap *heap = nullptr;
+
+void *operator new(size_t size) {
+    if (heap != nullptr) {
+        ++heap->allocs;
+        heap->bytes += size;
+    }
+    if (auto p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+static double ThreadCpuMs() {
+    auto ts = timespec();
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+Profile::Scope::Scope(Profile *profile, const char *name): profile_(profile), name_(name) {
+    if (profile_ == nullptr) {
+        return;
+    }
+    outer_ = heap;
+    heap = &heap_;
+    cpu_ = ThreadCpuMs();
+    wall_ = std::chrono::steady_clock::now();
+}
+
+Profile::Scope::~Scope() {
+    if (profile_ == nullptr) {
+        return;
+    }
+    auto wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_).count();
+    auto cpu = ThreadCpuMs() - cpu_;
+    auto counted = heap_;
+    // recording the phase is not part of it, nor of the one around it
+    profile_->phases_.push_back({name_, wall, cpu, counted.allocs, counted.bytes, count_, unit_});
+    heap = outer_;
+    if (outer_ != nullptr) {
+        // a phase inside another one counts for both
+        outer_->allocs += counted.allocs;
+        outer_->bytes += counted.bytes;
+    }
+}
+
+void Profile::Print(std::ostream &out) const {
+    char line[160];
+    out << "===== time report: " << file_ << " =====\n";
+    snprintf(line, sizeof(line), "%-8s %10s %10s %10s %12s  %s\n",
+             "phase", "wall ms", "cpu ms", "allocs", "bytes", "produced");
+    out << line;
+    auto total = Phase{"total", 0, 0, 0, 0, 0, ""};
+    for (auto &phase : phases_) {
+        snprintf(line, sizeof(line), "%-8s %10.3f %10.3f %10llu %12llu  %llu %s\n",
+                 phase.name.c_str(), phase.wall_ms, phase.cpu_ms,
+                 static_cast<unsigned long long>(phase.allocs),
+                 static_cast<unsigned long long>(phase.alloc_bytes),
+                 static_cast<unsigned long long>(phase.count), phase.unit);
+        out << line;
+        total.wall_ms += phase.wall_ms;
+        total.cpu_ms += phase.cpu_ms;
+        total.allocs += phase.allocs;
+        total.alloc_bytes += phase.alloc_bytes;
+    }
+    snprintf(line, sizeof(line), "%-8s %10.3f %10.3f %10llu %12llu\n",
+             total.name.c_str(), total.wall_ms, total.cpu_ms,
+             static_cast<unsigned long long>(total.allocs),
+             static_cast<unsigned long long>(total.alloc_bytes));
+    out << line;
+}
+
+// `s` as a json string
+static std::string Quote(const std::string &s) {
+    auto quoted = std::string("\"");
+    for (auto c : s) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+void Profile::PrintJson(std::ostream &out) const {
+    char number[64];
+    out << "{\"file\": " << Quote(file_) << ", \"phases\": [";
+    for (size_t i = 0; i < phases_.size(); ++i) {
+        auto &phase = phases_[i];
+        out << (i == 0 ? "" : ", ") << "{\"name\": " << Quote(phase.name);
+        snprintf(number, sizeof(number), "%.3f", phase.wall_ms);
+        out << ", \"wall_ms\": " << number;
+        snprintf(number, sizeof(number), "%.3f", phase.cpu_ms);
+        out << ", \"cpu_ms\": " << number;
+        out << ", \"allocs\": " << phase.allocs << ", \"alloc_bytes\": " << phase.alloc_bytes
+            << ", \"count\": " << phase.count << ", \"unit\": " << Quote(phase.unit) << "}";
+    }
+    out << "]}";
+}
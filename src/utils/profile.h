@@ -0,0 +1,83 @@
+#ifndef TIGER_CC_PROFILE_H
+#define TIGER_CC_PROFILE_H
+
+#include "../tiger/common.h"
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief what each phase of one compilation cost, for --time-report:
+ * wall and cpu time, heap allocations and bytes, and how many items
+ * (bytes read, tokens, nodes) it produced.
+ *
+ * Cpu time and allocations are those of the thread running the phase,
+ * work handed to a thread pool shows up in the wall time only.
+ * Allocations are counted by the global operator new of profile.cc,
+ * which only does so while a Scope is open on its thread.
+ */
+class Profile {
+public:
+    struct Phase {
+        std::string name;
+        double wall_ms;
+        double cpu_ms;
+        u64 allocs;
+        u64 alloc_bytes;
+        u64 count;
+        const char *unit;
+    };
+
+    // heap use of one thread while it runs a phase
+    struct Heap {
+        u64 allocs {0};
+        u64 bytes {0};
+    };
+
+    /**
+     * @brief times a phase from construction to destruction and records
+     * it in `profile`. Without a profile it does nothing.
+     */
+    class Scope {
+    public:
+        Scope(Profile *profile, const char *name);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        // what the phase produced
+        void Count(u64 count, const char *unit) {
+            count_ = count;
+            unit_ = unit;
+        }
+
+    private:
+        Profile *profile_;
+        const char *name_;
+        std::chrono::steady_clock::time_point wall_;
+        double cpu_ {0};
+        Heap heap_;
+        Heap *outer_ {nullptr};
+        u64 count_ {0};
+        const char *unit_ {""};
+    };
+
+    explicit Profile(std::string file): file_(std::move(file)) {}
+
+    const std::vector<Phase> &Phases() const {
+        return phases_;
+    }
+
+    // one phase per line, and their sum
+    void Print(std::ostream &out) const;
+    // {"file": ..., "phases": [{"name": ..., "wall_ms": ..., ...}, ...]}
+    void PrintJson(std::ostream &out) const;
+
+private:
+    std::string file_;
+    std::vector<Phase> phases_;
+};
+
+#endif // TIGER_CC_PROFILE_H
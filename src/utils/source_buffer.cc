@@ -0,0 +1,128 @@
+#include "source_buffer.h"
+#include "error.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceBuffer SourceBuffer::FromFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::string err_msg;
+        err_msg += "open file fail, ";
+        err_msg += "filename: " + path;
+        PANIC(err_msg.c_str());
+    }
+    return FromFd(fd, path);
+}
+
+std::optional<SourceBuffer> SourceBuffer::TryFromFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    return FromFd(fd, path);
+}
+
+SourceBuffer SourceBuffer::FromStdin() {
+    return FromFd(dup(STDIN_FILENO), "<stdin>");
+}
+
+SourceBuffer SourceBuffer::FromString(std::string content, std::string name) {
+    auto buffer = SourceBuffer();
+    buffer.heap_ = std::move(content);
+    buffer.data_ = buffer.heap_.data();
+    buffer.size_ = buffer.heap_.size();
+    buffer.name_ = std::move(name);
+    return buffer;
+}
+
+SourceBuffer SourceBuffer::FromFd(int fd, std::string name) {
+    auto buffer = SourceBuffer();
+    buffer.name_ = std::move(name);
+
+    struct stat st {};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            buffer.data_ = static_cast<const char *>(addr);
+            buffer.size_ = st.st_size;
+            buffer.mapped_ = true;
+            return buffer;
+        }
+    }
+
+    // not mappable (pipe, tty, empty file...), fall back to read(2).
+    // the buffer grows geometrically, so the total copy is linear.
+    size_t cap = S_ISREG(st.st_mode) && st.st_size > 0 ? st.st_size : 4096;
+    size_t len = 0;
+    buffer.heap_.resize(cap);
+    for (;;) {
+        if (len == cap) {
+            cap *= 2;
+            buffer.heap_.resize(cap);
+        }
+        ssize_t n = read(fd, &buffer.heap_[len], cap - len);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            auto msg = "read fail, filename: " + buffer.name_ + ", " + strerror(errno);
+            PANIC(msg.c_str());
+        }
+        len += n;
+    }
+    close(fd);
+    buffer.heap_.resize(len);
+    buffer.data_ = buffer.heap_.data();
+    buffer.size_ = len;
+    return buffer;
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept {
+    *this = std::move(other);
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    Release();
+    mapped_ = other.mapped_;
+    size_ = other.size_;
+    name_ = std::move(other.name_);
+    if (mapped_) {
+        data_ = other.data_;
+    } else {
+        // a moved std::string may live in its small buffer, so re-point.
+        heap_ = std::move(other.heap_);
+        data_ = heap_.data();
+    }
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mapped_ = false;
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+    Release();
+}
+
+void SourceBuffer::Release() {
+    if (mapped_ && data_ != nullptr) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    heap_.clear();
+}
@@ -0,0 +1,59 @@
+#ifndef TIGER_CC_SOURCE_BUFFER_H
+#define TIGER_CC_SOURCE_BUFFER_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief owns the bytes of one source file. Regular files are mapped
+ * read-only with mmap, so lexing reads straight out of the page cache.
+ * Pipes, ttys and stdin can't be mapped, they are read(2) into a heap buffer.
+ *
+ * Consumers (the lexer) only hold a std::string_view into the buffer,
+ * so a SourceBuffer must outlive everything that was lexed from it.
+ */
+class SourceBuffer {
+public:
+    static SourceBuffer FromFile(const std::string &path);
+    // like FromFile, but a missing or unreadable file is not an error
+    static std::optional<SourceBuffer> TryFromFile(const std::string &path);
+    static SourceBuffer FromStdin();
+    static SourceBuffer FromString(std::string content, std::string name = "<string>");
+
+    SourceBuffer(SourceBuffer &&other) noexcept;
+    SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+    ~SourceBuffer();
+
+    std::string_view View() const {
+        return std::string_view(data_, size_);
+    }
+
+    const std::string &Name() const {
+        return name_;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool IsMapped() const {
+        return mapped_;
+    }
+
+private:
+    SourceBuffer() = default;
+    static SourceBuffer FromFd(int fd, std::string name);
+    void Release();
+
+private:
+    const char *data_ {nullptr};
+    size_t size_ {0};
+    bool mapped_ {false};
+    std::string heap_;
+    std::string name_;
+};
+
+#endif // TIGER_CC_SOURCE_BUFFER_H
@@ -0,0 +1,36 @@
+#include "source_loc.h"
+
+#include <algorithm>
+#include <cstring>
+
+void LineTable::Build() const {
+    if (!starts_.empty()) {
+        return;
+    }
+    starts_.push_back(0);
+    auto begin = source_.data();
+    auto end = begin + source_.size();
+    for (auto p = begin; (p = static_cast<const char *>(memchr(p, '\n', end - p))) != nullptr; ) {
+        ++p;
+        starts_.push_back(static_cast<u32>(p - begin));
+    }
+}
+
+std::pair<u32, u32> LineTable::LineColumn(SourceLoc loc) const {
+    Build();
+    // an unknown or out of range position is the end of the source
+    auto offset = loc.IsValid() ? std::min<u64>(loc.Offset(), source_.size()) : source_.size();
+    auto it = std::upper_bound(starts_.begin(), starts_.end(), offset);
+    auto line = static_cast<u32>(it - starts_.begin());
+    return {line, static_cast<u32>(offset - starts_[line - 1] + 1)};
+}
+
+std::string_view LineTable::Line(u32 line) const {
+    Build();
+    if (line == 0 || line > starts_.size()) {
+        return {};
+    }
+    auto begin = starts_[line - 1];
+    auto end = line < starts_.size() ? starts_[line] - 1 : source_.size();
+    return source_.substr(begin, end - begin);
+}
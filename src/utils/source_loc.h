@@ -0,0 +1,78 @@
+#ifndef TIGER_CC_SOURCE_LOC_H
+#define TIGER_CC_SOURCE_LOC_H
+
+#include "../tiger/common.h"
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief a position in a source file, packed into the 32 bit byte offset
+ * of the character. Tokens already hold that offset, every ast node holds
+ * one SourceLoc. Lines and columns are not stored anywhere, LineTable
+ * works them out when a diagnostic or a profile asks.
+ */
+class SourceLoc {
+public:
+    // an unknown position
+    SourceLoc() = default;
+    explicit SourceLoc(u32 offset): offset_(offset) {}
+
+    bool IsValid() const {
+        return offset_ != INVALID;
+    }
+
+    u32 Offset() const {
+        return offset_;
+    }
+
+    bool operator==(SourceLoc rhs) const {
+        return offset_ == rhs.offset_;
+    }
+
+    bool operator!=(SourceLoc rhs) const {
+        return offset_ != rhs.offset_;
+    }
+
+    bool operator<(SourceLoc rhs) const {
+        return offset_ < rhs.offset_;
+    }
+
+private:
+    static constexpr u32 INVALID = ~0u;
+
+    u32 offset_ {INVALID};
+};
+
+static_assert(sizeof(SourceLoc) == 4, "SourceLoc must stay packed in 32 bits");
+
+/**
+ * @brief maps a SourceLoc to its 1 based line and column. The offsets of
+ * the line starts are collected in one pass on the first lookup, after
+ * that a lookup is a binary search.
+ */
+class LineTable {
+public:
+    explicit LineTable(std::string_view source): source_(source) {}
+
+    std::pair<u32, u32> LineColumn(SourceLoc loc) const;
+
+    // the text of `line` without its line break
+    std::string_view Line(u32 line) const;
+
+    u32 LineCount() const {
+        Build();
+        return static_cast<u32>(starts_.size());
+    }
+
+private:
+    void Build() const;
+
+private:
+    std::string_view source_;
+    // offset of the first character of every line, empty until needed
+    mutable std::vector<u32> starts_;
+};
+
+#endif // TIGER_CC_SOURCE_LOC_H
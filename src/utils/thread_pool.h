@@ -0,0 +1,97 @@
+#ifndef TIGER_CC_THREAD_POOL_H
+#define TIGER_CC_THREAD_POOL_H
+
+#include "../tiger/common.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief fixed size pool of worker threads fed from one FIFO queue.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(u32 threads = std::thread::hardware_concurrency()) {
+        threads = threads == 0 ? 1 : threads;
+        for (u32 i = 0; i < threads; ++i) {
+            workers_.emplace_back([this]() { Work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto &w : workers_) {
+            w.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    u32 Size() const {
+        return static_cast<u32>(workers_.size());
+    }
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> Submit(F &&fn) {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+        auto result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            tasks_.emplace_back([task]() { (*task)(); });
+        }
+        cv_.notify_one();
+        return result;
+    }
+
+    // run fn(i) for every i in [0, n) and wait for all of them.
+    // must not be called from a pool thread, it would wait on itself.
+    template <typename F>
+    void ParallelFor(u32 n, F &&fn) {
+        auto futures = std::vector<std::future<void>>();
+        futures.reserve(n);
+        for (u32 i = 0; i < n; ++i) {
+            futures.push_back(Submit([&fn, i]() { fn(i); }));
+        }
+        for (auto &f : futures) {
+            f.get();
+        }
+    }
+
+private:
+    void Work() {
+        for (;;) {
+            auto task = std::function<void()>();
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stop_ {false};
+};
+
+#endif // TIGER_CC_THREAD_POOL_H
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include "tiger/constant_folder.h"
+#include "tiger/flat_ast.h"
+#include "tiger/parser.h"
+#include "tiger/type_checker.h"
+#include "program_gen.h"
+#include "utils/source_buffer.h"
+
+#include <sstream>
+
+static std::string Sexpr(AstNodePtr ast) {
+    auto out = std::ostringstream();
+    AstWriter(out, AstWriter::Format::SEXPR).Write(ast);
+    return out.str();
+}
+
+// `expr` in a program with an int `x` and a string `s`
+static std::string Program(const std::string &expr) {
+    return "let\n  var x := 3\n  var s := \"s\"\nin\n  " + expr + "\nend\n";
+}
+
+// the dump of `source` checked and folded. What the folder says it
+// removed must be what the trees tell apart.
+static std::string Fold(const std::string &source) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto diags = Diagnostics(source, "<input>");
+    auto ast = Parser(lexer, nodes, &diags).ParseResult();
+    auto types = TypeContext();
+    TypeChecker(types, symbols, &diags).Check(ast);
+    EXPECT_FALSE(diags.HasErrors()) << source;
+
+    auto before = Sexpr(ast);
+    auto folder = ConstantFolder(nodes);
+    auto folded = folder.Fold(ast);
+    EXPECT_EQ(Sexpr(ast), before) << "the tree folded must be left as it is";
+    EXPECT_EQ(folder.Removed(), FlatAst::Build(ast).Size() - FlatAst::Build(folded).Size()) << source;
+    return Sexpr(folded);
+}
+
+static std::string Parse(const std::string &source) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    return Sexpr(Parser(lexer, nodes).ParseResult());
+}
+
+TEST(TestConstantFolder, Arithmetic) {
+    auto cases = std::vector<std::pair<std::string, std::string>> {
+        {"1 + 2 * 3 - 4 / 2", "5"},
+        {"(1 + 2) * (3 + 4)", "21"},
+        {"7 / 2 + 10 / 3", "6"},
+        {"1 < 2", "1"},
+        {"2 <= 1 | 3 >= 3", "1"},
+        {"0 & 1 / 0", "0"},
+        {"3 & 4", "4"},
+        {"\"a\" < \"b\"", "1"},
+        {"\"a\" = \"b\"", "0"},
+        {"\"abc\" <> \"abc\"", "0"},
+        // overflow wraps, a division by zero fails at run time
+        {"2147483647 + 1 = 0 - 2147483647 - 1", "1"},
+        {"65536 * 65536", "0"},
+        {"x + 1 / 0", "x + 1 / 0"},
+        // identities, `x` and the call are kept
+        {"x + 0 + (0 + x) * 1", "x + (x)"},
+        {"x - 0 + x / 1 + 1 * x", "x + x + x"},
+        {"1 & x | 0", "x | 0"},
+        {"0 | ord(s)", "ord(s)"},
+        {"1 | ord(s)", "1"},
+        {"0 & ord(s)", "0"},
+        {"x * 0", "x * 0"},
+        {"ord(s) & 0", "ord(s) & 0"},
+    };
+    for (auto &[expr, expected] : cases) {
+        ASSERT_EQ(Fold(Program(expr)), Parse(Program(expected))) << expr;
+    }
+
+    // negative values have no literal of their own
+    auto minus = Fold(Program("0 - 5 + 2"));
+    ASSERT_NE(minus.find("-3"), std::string::npos) << minus;
+    ASSERT_EQ(Fold(Program("- -x")), Parse(Program("x")));
+    ASSERT_EQ(Fold(Program("-2147483647 - 1")), Fold(Program("0 - 2147483647 - 1")));
+    ASSERT_EQ(Fold(Program("-(2 - 5)")), Parse(Program("3")));
+    // a leading minus is on its operand alone
+    ASSERT_EQ(Fold(Program("-1 + 2")), Parse(Program("1")));
+    ASSERT_EQ(Fold(Program("-2 * 3 + 1")), Fold(Program("-5")));
+    ASSERT_EQ(Fold(Program("-x + 0")), Parse(Program("-x")));
+}
+
+TEST(TestConstantFolder, DeadBranches) {
+    auto cases = std::vector<std::pair<std::string, std::string>> {
+        {"if 1 then x else ord(s)", "x"},
+        {"if 2 > 3 then x else ord(s)", "ord(s)"},
+        {"if 0 then print(s)", "()"},
+        {"if 1 - 1 = 0 then print(s)", "print(s)"},
+        {"while 0 do (x := x + 1; print(s))", "()"},
+        {"while 1 < 0 | 0 do x := 1", "()"},
+        {"while x do x := x - (1 * 1)", "while x do x := x - 1"},
+        {"(if x then 1 + 1 else 2 * 2; for i := 0 + 1 to 10 * 10 do if 0 then print(s))",
+         "(if x then 2 else 4; for i := 1 to 100 do ())"},
+        {"(x; 1) + (2)", "(x; 1) + 2"},
+        {"let var y := if 1 then 5 else x function f(a: int): int = a * 1 in f(y) end",
+         "let var y := 5 function f(a: int): int = a in f(y) end"},
+    };
+    for (auto &[expr, expected] : cases) {
+        ASSERT_EQ(Fold(Program(expr)), Parse(Program(expected))) << expr;
+    }
+}
+
+// nothing folds in a program without constants, the very same tree
+// comes back
+TEST(TestConstantFolder, SharesWhatDoesNotFold) {
+    auto source = Program("while x < 10 do x := x + ord(s)");
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    auto made = nodes.Objects();
+    auto folder = ConstantFolder(nodes);
+    ASSERT_EQ(folder.Fold(ast), ast);
+    ASSERT_EQ(folder.Removed(), 0u);
+    ASSERT_EQ(nodes.Objects(), made);
+}
+
+TEST(TestConstantFolder, BookAndGeneratedPrograms) {
+    for (auto name : {"queens.tig", "merge.tig", "test12.tig", "test27.tig", "test41.tig", "test44.tig"}) {
+        auto source = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + name);
+        Fold(std::string(source.View()));
+    }
+    for (auto &shape : std::vector<ProgramShape> {{20, 6, 3, 50, 50, 8}, {50, 3, 4, 10, 10, 2, 16}}) {
+        Fold(GenerateProgram(shape));
+    }
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include "tiger/driver.h"
+#include "utils/profile.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+static const std::string PREFIX = TESTCASES_DIR;
+
+TEST(TestDriver, ParsesArguments) {
+    auto list = std::string("/tmp/tiger_driver_test.list");
+    std::ofstream(list) << PREFIX + "queens.tig\n\n" << PREFIX + "merge.tig\n";
+
+    auto err = std::string();
+    auto options = Driver::ParseArgs({"--sexp", "--jobs=3", "a.tig", "--batch=" + list, "--cache=/tmp/c"}, err);
+    ASSERT_TRUE(options.has_value());
+    ASSERT_EQ(options->format, AstWriter::Format::SEXPR);
+    ASSERT_EQ(options->jobs, 3);
+    ASSERT_EQ(options->cache_dir, "/tmp/c");
+    ASSERT_EQ(options->files, (std::vector<std::string> {"a.tig", PREFIX + "queens.tig", PREFIX + "merge.tig"}));
+
+    ASSERT_EQ(Driver::ParseArgs({}, err)->files, std::vector<std::string> {"-"});
+    // folding needs a checked tree
+    auto fold = Driver::ParseArgs({"--fold"}, err);
+    ASSERT_TRUE(fold->fold && fold->check);
+    auto escapes = Driver::ParseArgs({"--escapes"}, err);
+    ASSERT_TRUE(escapes->escapes && escapes->check);
+    ASSERT_FALSE(Driver::ParseArgs({"--bogus"}, err).has_value());
+    ASSERT_EQ(err, "unknown option --bogus\n");
+    // only a server can be shut down
+    err.clear();
+    ASSERT_FALSE(Driver::ParseArgs({"--shutdown", "a.tig"}, err).has_value());
+    ASSERT_EQ(err, "--shutdown needs --connect=<socket>\n");
+    auto shutdown = Driver::ParseArgs({"--connect=s", "--shutdown"}, err);
+    ASSERT_TRUE(shutdown.has_value() && shutdown->files.empty());
+    ASSERT_EQ(Driver::ForwardArgs({"--connect=s", "--sexp", "--shutdown"}, *shutdown, "/"),
+              std::vector<std::string> {"--shutdown"});
+    std::remove(list.c_str());
+}
+
+TEST(TestDriver, BatchMatchesOneByOne) {
+    auto options = Driver::Options();
+    options.format = AstWriter::Format::SEXPR;
+    options.jobs = 4;
+    for (int i = 1; i < 50; ++i) {
+        options.files.push_back(PREFIX + "test" + std::to_string(i) + ".tig");
+    }
+    options.files.push_back("/nonexistent/x.tig");
+
+    auto driver = Driver();
+    auto expect = Driver::Result();
+    for (auto &file : options.files) {
+        auto one = options;
+        one.files = {file};
+        auto result = driver.Compile(one);
+        expect.out += result.out;
+        expect.err += result.err;
+        expect.status = std::max(expect.status, result.status);
+    }
+    auto batch = driver.Compile(options);
+    ASSERT_EQ(batch.out, expect.out);
+    ASSERT_EQ(batch.err, expect.err);
+    ASSERT_EQ(batch.status, 1);
+}
+
+TEST(TestDriver, ServerSeesEdits) {
+    auto socket = std::string("/tmp/tiger_driver_test.sock");
+    auto file = std::string("/tmp/tiger_driver_test.tig");
+    std::ofstream(file) << "let var a := 1 in a end\n";
+
+    auto server = Driver();
+    auto thread = std::thread([&]() { server.Serve(socket); });
+    auto request = [&](const std::vector<std::string> &args) {
+        // the server may not be listening yet
+        for (int i = 0; i < 500; ++i) {
+            if (auto result = Driver::Request(socket, args)) {
+                return *result;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return Driver::Result {-1};
+    };
+
+    auto first = request({"--sexp", file});
+    ASSERT_EQ(first.status, 0);
+    ASSERT_EQ(request({"--sexp", file}).out, first.out);
+
+    std::ofstream(file) << "let var b := 2 in b end\n";
+    auto second = request({"--sexp", file});
+    ASSERT_EQ(second.status, 0);
+    ASSERT_NE(second.out, first.out);
+    ASSERT_EQ(second.out, Driver().Compile(*Driver::ParseArgs({"--sexp", file}, second.err)).out);
+
+    std::ofstream(file) << "let var := 2 in b end\n";
+    auto broken = request({file});
+    ASSERT_EQ(broken.status, 1);
+    ASSERT_NE(broken.err.find("1 error generated."), std::string::npos);
+
+    // a path is one argument whatever it holds
+    auto odd = std::string("/tmp/tiger_driver\ntest.tig");
+    std::ofstream(odd) << "let var c := 3 in c end\n";
+    auto third = request({"--sexp", odd});
+    ASSERT_EQ(third.status, 0) << third.err;
+    ASSERT_EQ(third.out, Driver().Compile(*Driver::ParseArgs({"--sexp", odd}, third.err)).out);
+
+    ASSERT_EQ(request({"--shutdown"}).status, 0);
+    thread.join();
+    std::remove(file.c_str());
+    std::remove(odd.c_str());
+}
+
+// a client resolves the files of a batch list itself, the server may
+// run in another directory and can't read the client's stdin
+TEST(TestDriver, ForwardsAbsoluteFiles) {
+    auto list = std::string("/tmp/tiger_driver_test.list");
+    std::ofstream(list) << "a.tig\n/abs/b.tig\n";
+    auto args = std::vector<std::string> {"--sexp", "--connect=s", "--batch=" + list, "c.tig", "--cache=dir"};
+    auto err = std::string();
+    auto options = Driver::ParseArgs(args, err);
+    ASSERT_TRUE(options.has_value()) << err;
+    auto expected = std::vector<std::string> {
+        "--sexp", "--cache=/work/dir", "/work/a.tig", "/abs/b.tig", "/work/c.tig",
+    };
+    ASSERT_EQ(Driver::ForwardArgs(args, *options, "/work"), expected);
+    std::remove(list.c_str());
+}
+
+TEST(TestProfile, CountsPhaseAllocations) {
+    auto profile = Profile("x.tig");
+    {
+        auto phase = Profile::Scope(&profile, "outer");
+        {
+            auto inner = Profile::Scope(&profile, "inner");
+            auto block = std::make_unique<char[]>(1000);
+            inner.Count(3, "tokens");
+        }
+        auto v = std::vector<int>(10);
+    }
+    {
+        // nothing recorded without a profile
+        auto phase = Profile::Scope(nullptr, "none");
+    }
+    auto &phases = profile.Phases();
+    ASSERT_EQ(phases.size(), 2);
+    ASSERT_EQ(phases[0].name, "inner");
+    ASSERT_EQ(phases[0].allocs, 1);
+    ASSERT_EQ(phases[0].alloc_bytes, 1000);
+    ASSERT_EQ(phases[0].count, 3);
+    ASSERT_EQ(phases[1].name, "outer");
+    ASSERT_EQ(phases[1].allocs, 2);
+    ASSERT_EQ(phases[1].alloc_bytes, 1000 + 10 * sizeof(int));
+    ASSERT_GE(phases[1].wall_ms, phases[0].wall_ms);
+
+    auto json = std::ostringstream();
+    profile.PrintJson(json);
+    ASSERT_EQ(json.str().rfind("{\"file\": \"x.tig\", \"phases\": [{\"name\": \"inner\"", 0), 0);
+}
+
+TEST(TestDriver, TimeReport) {
+    auto err = std::string();
+    auto options = *Driver::ParseArgs({"--time-report", PREFIX + "queens.tig", PREFIX + "merge.tig"}, err);
+    auto result = Driver().Compile(options);
+    ASSERT_EQ(result.status, 0);
+    auto report = std::istringstream(result.err);
+    auto names = std::vector<std::string>();
+    for (auto line = std::string(); std::getline(report, line);) {
+        names.push_back(line.substr(0, line.find(' ')));
+    }
+    ASSERT_EQ(names, (std::vector<std::string> {
+            "=====", "phase", "read", "lex", "parse", "dump", "total",
+            "=====", "phase", "read", "lex", "parse", "dump", "total",
+    }));
+
+    options.time_report = Driver::TimeReport::JSON;
+    result = Driver().Compile(options);
+    ASSERT_EQ(result.err.front(), '[');
+    ASSERT_NE(result.err.find("\"name\": \"lex\""), std::string::npos);
+    ASSERT_EQ(result.err.substr(result.err.size() - 3), "}]\n");
+}
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+#include "tiger/env.h"
+#include "tiger/lexer.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// `depth` lets nested in one another, each binding `width` variables and
+// reading a few names of the enclosing lets
+static std::string NestedLets(int depth, int width) {
+    auto source = std::string();
+    for (int d = 0; d < depth; ++d) {
+        source += "let\n";
+        for (int w = 0; w < width; ++w) {
+            auto name = "v" + std::to_string((d * width + w) % 64);
+            source += "  var " + name + " := v" + std::to_string(w) + " + " + name + "\n";
+        }
+        source += "in\n";
+    }
+    source += "v0\n";
+    for (int d = 0; d < depth; ++d) {
+        source += "end\n";
+    }
+    return source;
+}
+
+// what EnvTable used to do: every scope is a full copy of the visible map
+template <typename T>
+class CopyingEnv {
+public:
+    using ValuePtr = std::shared_ptr<T>;
+
+    void BeginScope() {
+        auto scope = scopes_.empty()
+                ? std::unordered_map<Symbol, ValuePtr>() : scopes_.back();
+        scopes_.push_back(std::move(scope));
+    }
+
+    void EndScope() {
+        scopes_.pop_back();
+    }
+
+    ValuePtr Find(Symbol symbol) {
+        auto &scope = scopes_.back();
+        auto it = scope.find(symbol);
+        return it != scope.end() ? it->second : ValuePtr();
+    }
+
+    void Add(Symbol symbol, ValuePtr value) {
+        scopes_.back()[symbol] = std::move(value);
+    }
+
+private:
+    std::list<std::unordered_map<Symbol, ValuePtr>> scopes_;
+};
+
+// walk the tokens like a checker would: scope per let, bind each var,
+// look up every other name
+template <typename Env>
+static void BM_NestedLet(benchmark::State &state) {
+    auto symbols = SymbolPool();
+    auto source = NestedLets(state.range(0), 4);
+    auto lexer = Lexer(source, symbols);
+    auto &tokens = lexer.GetAllTokens();
+    auto value = std::make_shared<int>(0);
+    for (auto _ : state) {
+        auto env = Env();
+        env.BeginScope();
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            auto &t = tokens[i];
+            if (t.Type() == Token::Tag::LET) {
+                env.BeginScope();
+            } else if (t.Type() == Token::Tag::END) {
+                env.EndScope();
+            } else if (t.Type() == Token::Tag::VAR) {
+                env.Add(Symbol(tokens[++i].Slot()), value);
+            } else if (t.Type() == Token::Tag::ID) {
+                benchmark::DoNotOptimize(env.Find(Symbol(t.Slot())));
+            }
+        }
+        env.EndScope();
+    }
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+BENCHMARK_TEMPLATE(BM_NestedLet, CopyingEnv<int>)->RangeMultiplier(4)->Range(4, 1024);
+BENCHMARK_TEMPLATE(BM_NestedLet, EnvTable<int>)->RangeMultiplier(4)->Range(4, 1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "tiger/env.h"
+
+TEST(TestEnvTable, ScopesShadowAndRestore) {
+    auto symbols = SymbolPool();
+    auto x = symbols.Intern("x");
+    auto y = symbols.Intern("y");
+    auto env = EnvTable<int>();
+
+    env.BeginScope();
+    env.Add(x, std::make_shared<int>(1));
+    env.BeginScope();
+    ASSERT_EQ(*env.Find(x), 1);
+    env.Add(x, std::make_shared<int>(2));
+    env.Add(y, std::make_shared<int>(3));
+    env.Add(x, std::make_shared<int>(4));
+    ASSERT_EQ(*env.Find(x), 4);
+    ASSERT_TRUE(env.Remove(y));
+    ASSERT_FALSE(env.Exist(y));
+    ASSERT_FALSE(env.Remove(y));
+    env.EndScope();
+
+    ASSERT_EQ(*env.Find(x), 1);
+    ASSERT_FALSE(env.Exist(y));
+    ASSERT_FALSE(env.Exist(symbols.Intern("z")));
+    env.EndScope();
+    ASSERT_FALSE(env.Exist(x));
+    ASSERT_EQ(env.Depth(), 0);
+
+    // nothing is bound outside of a scope
+    env.EndScope();
+    env.Add(x, std::make_shared<int>(5));
+    ASSERT_FALSE(env.Exist(x));
+}
+
+TEST(TestEnvTable, OuterTable) {
+    auto symbols = SymbolPool();
+    auto x = symbols.Intern("x");
+    auto y = symbols.Intern("y");
+    auto outer = EnvTable<int>();
+    outer.BeginScope();
+    outer.Add(x, std::make_shared<int>(1));
+    outer.Add(y, std::make_shared<int>(2));
+
+    auto env = EnvTable<int>(&outer);
+    ASSERT_EQ(*env.Find(x), 1);
+    env.BeginScope();
+    env.Add(x, std::make_shared<int>(3));
+    ASSERT_EQ(*env.Find(x), 3);
+    ASSERT_EQ(*env.Find(y), 2);
+    // only what this table bound can be removed
+    ASSERT_FALSE(env.Remove(y));
+    env.EndScope();
+    ASSERT_EQ(*env.Find(x), 1);
+    ASSERT_EQ(*outer.Find(x), 1);
+    ASSERT_EQ(env.Depth(), 0);
+}
+
+TEST(TestEnvTable, DeepNesting) {
+    auto symbols = SymbolPool();
+    auto env = EnvTable<int>();
+    const int depth = 10000;
+    for (int i = 0; i < depth; ++i) {
+        env.BeginScope();
+        env.Add(symbols.Intern("v" + std::to_string(i % 10)), std::make_shared<int>(i));
+    }
+    for (int i = depth - 1; i >= 0; --i) {
+        ASSERT_EQ(*env.Find(symbols.Find("v" + std::to_string(i % 10))), i);
+        env.EndScope();
+    }
+    ASSERT_FALSE(env.Exist(symbols.Find("v0")));
+}
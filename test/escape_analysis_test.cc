@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "tiger/escape_analysis.h"
+#include "tiger/parser.h"
+#include "tiger/type_checker.h"
+#include "program_gen.h"
+#include "utils/source_buffer.h"
+
+#include <sstream>
+
+// the frames of `source`, checked then analyzed, as `name variables
+// escaping`
+static std::vector<std::string> Frames(const std::string &source, bool *checks = nullptr) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto diags = Diagnostics(source, "<input>");
+    auto ast = Parser(lexer, nodes, &diags).ParseResult();
+    auto types = TypeContext();
+    TypeChecker(types, symbols, &diags).Check(ast);
+    if (checks != nullptr) {
+        *checks = !diags.HasErrors();
+    } else {
+        EXPECT_FALSE(diags.HasErrors()) << source;
+    }
+
+    auto escapes = EscapeAnalysis(symbols);
+    escapes.Analyze(ast);
+    auto frames = std::vector<std::string>();
+    auto escaping = u64(0);
+    for (auto &frame : escapes.Frames()) {
+        auto name = frame.name.Valid() ? std::string(frame.name.Name()) : std::string("<program>");
+        frames.push_back(name + " " + std::to_string(frame.variables) + " " + std::to_string(frame.escaping));
+        EXPECT_LE(frame.escaping, frame.variables) << name;
+        escaping += frame.escaping;
+    }
+    EXPECT_EQ(escaping, escapes.Escaping());
+    return frames;
+}
+
+static const char *NESTED =
+        "let\n"
+        "  var a := 1\n"
+        "  var b := 2\n"
+        "  function f(n: int, m: int): int =\n"
+        "    let\n"
+        "      var c := m\n"
+        "      function g(): int = n + a + c\n"
+        "    in\n"
+        "      for i := 0 to 3 do\n"
+        "        let function k() = print(chr(i)) in k() end;\n"
+        "      g()\n"
+        "    end\n"
+        "  function h(x: int): int =\n"
+        "    let var a := x in a end\n"
+        "in\n"
+        "  for j := 0 to b do print(chr(f(j, h(j))));\n"
+        "  a := 2\n"
+        "end\n";
+
+TEST(TestEscapeAnalysis, NestedFunctions) {
+    // `a` and the `a` that shadows it in `h` are apart, so are the names
+    // of the same level
+    auto expected = std::vector<std::string> {
+        "<program> 3 1", "f 4 3", "g 0 0", "k 0 0", "h 2 0",
+    };
+    ASSERT_EQ(Frames(NESTED), expected);
+
+    // a variable escapes however deep the function that uses it
+    expected = {"<program> 1 1", "f 1 0", "g 0 0"};
+    ASSERT_EQ(Frames("let var v := 1 function f(p: int): int =\n"
+                     "  let function g(): int = v + 1 in p + g() end in f(v) end"), expected);
+}
+
+TEST(TestEscapeAnalysis, MarksDeclarations) {
+    auto source = std::string(NESTED);
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto let = dynamic_cast<LetStmtPtr>(Parser(lexer, nodes).ParseResult());
+    ASSERT_NE(let, nullptr);
+    auto escapes = EscapeAnalysis(symbols);
+    escapes.Analyze(let);
+
+    auto &decs = let->GetDecs()->GetDecs();
+    ASSERT_TRUE(escapes.Escapes(static_cast<VarDecPtr>(decs[0])));
+    ASSERT_FALSE(escapes.Escapes(static_cast<VarDecPtr>(decs[1])));
+    auto f = static_cast<FnDecPtr>(decs[2]);
+    ASSERT_TRUE(escapes.Escapes(f->GetArgs(), 0));
+    ASSERT_FALSE(escapes.Escapes(f->GetArgs(), 1));
+    auto h = static_cast<FnDecPtr>(decs[3]);
+    ASSERT_FALSE(escapes.Escapes(h->GetArgs(), 0));
+    auto loop = dynamic_cast<ForStmtPtr>(let->GetExprs()->GetExprs()[0]);
+    ASSERT_NE(loop, nullptr);
+    ASSERT_FALSE(escapes.Escapes(loop));
+    ASSERT_EQ(escapes.Escaping(), 4u);
+}
+
+// the initial values of attributes are a frame of the class, methods are
+// functions with `self`
+TEST(TestEscapeAnalysis, Classes) {
+    auto source = std::string(
+            "let\n"
+            "  var scale := 3\n"
+            "  var unused := 0\n"
+            "  class Counter (\n"
+            "    var step := scale\n"
+            "    method next(by: int): int =\n"
+            "      let function twice(): int = by * 2 + self.step in twice() end\n"
+            "    method same(): int = self.step\n"
+            "  )\n"
+            "  type Empty = class { method none() = () }\n"
+            "  var c := new Counter\n"
+            "in\n"
+            "  c.next(unused)\n"
+            "end\n");
+    auto expected = std::vector<std::string> {
+        "<program> 3 1", "Counter 0 0", "next 2 2", "twice 0 0", "same 1 0", "none 1 0",
+    };
+    ASSERT_EQ(Frames(source), expected);
+}
+
+TEST(TestEscapeAnalysis, BookAndGeneratedPrograms) {
+    auto source = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + "queens.tig");
+    auto expected = std::vector<std::string> {"<program> 5 5", "printboard 2 0", "try 2 0"};
+    ASSERT_EQ(Frames(std::string(source.View())), expected);
+
+    for (int i = 1; i < 49; ++i) {
+        auto name = "test" + std::to_string(i) + ".tig";
+        auto test = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + name);
+        auto checks = false;
+        Frames(std::string(test.View()), &checks);
+    }
+    for (auto &shape : std::vector<ProgramShape> {{20, 6, 3, 50, 50, 8}, {50, 3, 4, 10, 10, 2, 16}}) {
+        Frames(GenerateProgram(shape));
+    }
+}
@@ -0,0 +1,244 @@
+#include <benchmark/benchmark.h>
+#include "program_gen.h"
+#include "tiger/constant_folder.h"
+#include "tiger/escape_analysis.h"
+#include "tiger/parser.h"
+#include "tiger/type_checker.h"
+
+#include <sstream>
+#include <string>
+
+// the shapes every front end benchmark runs on, by index
+static const struct {
+    const char *name;
+    ProgramShape shape;
+} SHAPES[] = {
+    // many small functions
+    {"flat", {4000, 0, 4, 10, 10, 1}},
+    // fewer, deeply nested bodies
+    {"deep", {400, 8, 2, 10, 10, 2}},
+    // long arithmetic chains
+    {"long_expr", {1000, 1, 64, 0, 0, 3}},
+    // mostly strings and comments
+    {"text", {2000, 2, 2, 80, 80, 4}},
+    // record fields and arrays of records everywhere
+    {"records", {2000, 2, 4, 10, 10, 5, 256}},
+};
+
+static const std::string &Program(int shape) {
+    static std::string programs[std::size(SHAPES)];
+    auto &program = programs[shape];
+    if (program.empty()) {
+        program = GenerateProgram(SHAPES[shape].shape);
+    }
+    return program;
+}
+
+static void Label(benchmark::State &state, const std::string &source) {
+    state.SetLabel(std::string(SHAPES[state.range(0)].name) + " "
+                   + std::to_string(source.size() >> 10) + " KiB");
+}
+
+// MB/s and tokens/s of the lexer alone
+static void BM_FrontendLex(benchmark::State &state) {
+    auto &source = Program(state.range(0));
+    auto tokens = size_t(0);
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        auto lexer = Lexer(source, symbols);
+        tokens = lexer.GetAllTokens().size();
+        benchmark::DoNotOptimize(tokens);
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["tokens/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * tokens), benchmark::Counter::kIsRate);
+    Label(state, source);
+}
+BENCHMARK(BM_FrontendLex)->DenseRange(0, std::size(SHAPES) - 1)->Unit(benchmark::kMillisecond);
+
+// MB/s and nodes/s of lexing and parsing, streamed like the driver does
+static void BM_FrontendParse(benchmark::State &state) {
+    auto &source = Program(state.range(0));
+    auto nodes_made = size_t(0);
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        auto nodes = Arena();
+        auto lexer = Lexer(source, symbols);
+        auto ast = Parser(lexer, nodes).ParseResult();
+        benchmark::DoNotOptimize(ast);
+        nodes_made = nodes.Objects();
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["nodes/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * nodes_made), benchmark::Counter::kIsRate);
+    Label(state, source);
+}
+BENCHMARK(BM_FrontendParse)->DenseRange(0, std::size(SHAPES) - 1)->Unit(benchmark::kMillisecond);
+
+// MB/s of dump output and nodes/s of the s-expression writer
+static void BM_FrontendDump(benchmark::State &state) {
+    auto &source = Program(state.range(0));
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    auto bytes = size_t(0);
+    for (auto _ : state) {
+        auto out = std::ostringstream();
+        AstWriter(out, AstWriter::Format::SEXPR).Write(ast);
+        bytes = out.tellp();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["nodes/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * nodes.Objects()), benchmark::Counter::kIsRate);
+    Label(state, source);
+}
+BENCHMARK(BM_FrontendDump)->DenseRange(0, std::size(SHAPES) - 1)->Unit(benchmark::kMillisecond);
+
+// nodes/s of the type checker on a parsed tree, and the types it made
+static void BM_FrontendCheck(benchmark::State &state) {
+    auto &source = Program(state.range(0));
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    auto types_made = size_t(0);
+    for (auto _ : state) {
+        auto types = TypeContext();
+        auto diags = Diagnostics(source, "<bench>");
+        auto type = TypeChecker(types, symbols, &diags).Check(ast);
+        benchmark::DoNotOptimize(type);
+        if (diags.HasErrors()) {
+            state.SkipWithError("the generated program has type errors");
+            break;
+        }
+        types_made = types.Size();
+    }
+    state.counters["nodes/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * nodes.Objects()), benchmark::Counter::kIsRate);
+    state.counters["types"] = static_cast<double>(types_made);
+    Label(state, source);
+}
+BENCHMARK(BM_FrontendCheck)->DenseRange(0, std::size(SHAPES) - 1)->Unit(benchmark::kMillisecond);
+
+// nodes/s of checking the bodies of the flat shape, thousands of
+// functions in one group, on a pool of range(0) threads
+static void BM_FrontendCheckParallel(benchmark::State &state) {
+    auto &source = Program(0);
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    auto pool = ThreadPool(static_cast<u32>(state.range(0)));
+    for (auto _ : state) {
+        auto types = TypeContext();
+        auto diags = Diagnostics(source, "<bench>");
+        auto type = TypeChecker(types, symbols, &diags, &pool).Check(ast);
+        benchmark::DoNotOptimize(type);
+    }
+    state.counters["nodes/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * nodes.Objects()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_FrontendCheckParallel)->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// nodes/s of constant folding a parsed tree, and how many it removed
+static void BM_FrontendFold(benchmark::State &state) {
+    auto &source = Program(state.range(0));
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    auto parsed = nodes.Objects();
+    auto removed = u64(0);
+    for (auto _ : state) {
+        auto folded = Arena();
+        auto folder = ConstantFolder(folded);
+        benchmark::DoNotOptimize(folder.Fold(ast));
+        removed = folder.Removed();
+    }
+    state.counters["nodes/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * parsed), benchmark::Counter::kIsRate);
+    state.counters["removed"] = static_cast<double>(removed);
+    Label(state, source);
+}
+BENCHMARK(BM_FrontendFold)->DenseRange(0, std::size(SHAPES) - 1)->Unit(benchmark::kMillisecond);
+
+// nodes/s of finding the variables that escape, and how many do
+static void BM_FrontendEscapes(benchmark::State &state) {
+    auto &source = Program(state.range(0));
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    auto parsed = nodes.Objects();
+    auto escaping = u64(0);
+    for (auto _ : state) {
+        auto escapes = EscapeAnalysis(symbols);
+        escapes.Analyze(ast);
+        escaping = escapes.Escaping();
+    }
+    state.counters["nodes/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * parsed), benchmark::Counter::kIsRate);
+    state.counters["escaping"] = static_cast<double>(escaping);
+    Label(state, source);
+}
+BENCHMARK(BM_FrontendEscapes)->DenseRange(0, std::size(SHAPES) - 1)->Unit(benchmark::kMillisecond);
+
+// one group of `types` declarations like a generated schema: records
+// whose fields name types anywhere in the group, arrays of them, and
+// aliases, a quarter of the group in one chain that ends at the first
+// record
+static std::string Schema(u32 types) {
+    // whole blocks of four, so every name is declared
+    auto name = [](u32 i) {
+        return "t" + std::to_string(i);
+    };
+    auto source = std::string("let\n");
+    for (u32 i = 0; i < types; ++i) {
+        source += "  type " + name(i) + " = ";
+        if (i % 4 == 0) {
+            source += "{id: int, left: " + name((i * 7 % types) / 4 * 4 + 2)
+                      + ", right: " + name((i * 13 % types) / 4 * 4) + ", all: " + name(i + 1) + "}\n";
+        } else if (i % 4 == 1) {
+            source += "array of " + name(i - 1) + "\n";
+        } else if (i % 4 == 2) {
+            source += name(i + 4 < types ? i + 4 : 0) + "\n";
+        } else {
+            source += name(i - 3) + "\n";
+        }
+    }
+    return source + "  var v := " + name(0) + " {id = 0, left = nil, right = nil, all = "
+           + name(1) + " [0] of nil}\nin\n  v.id\nend\n";
+}
+
+// declarations/s of resolving one large group of types
+static void BM_FrontendCheckSchema(benchmark::State &state) {
+    auto types = static_cast<u32>(state.range(0));
+    auto source = Schema(types);
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    for (auto _ : state) {
+        auto context = TypeContext();
+        auto diags = Diagnostics(source, "<bench>");
+        auto type = TypeChecker(context, symbols, &diags).Check(ast);
+        benchmark::DoNotOptimize(type);
+        if (diags.HasErrors()) {
+            state.SkipWithError("the schema has type errors");
+            break;
+        }
+    }
+    state.counters["decs/s"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * types), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_FrontendCheckSchema)->RangeMultiplier(4)->Range(1 << 10, 1 << 16)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
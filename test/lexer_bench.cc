@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+#include "tiger/lexer.h"
+#include "tiger/parallel_lexer.h"
+#include "utils/source_buffer.h"
+
+#include <dirent.h>
+#include <string>
+
+// every .tig under test/testcases, concatenated
+static const std::string &Testcases() {
+    static auto all = []() {
+        auto result = std::string();
+        auto dir = opendir(TESTCASES_DIR);
+        while (auto entry = readdir(dir)) {
+            auto name = std::string(entry->d_name);
+            if (name.size() > 4 && name.substr(name.size() - 4) == ".tig") {
+                auto source = SourceBuffer::FromFile(TESTCASES_DIR + name);
+                result += source.View();
+                result += "\n";
+            }
+        }
+        closedir(dir);
+        return result;
+    }();
+    return all;
+}
+
+// the spelling of every ID or keyword token in the testcases
+static std::vector<std::string_view> Words() {
+    auto symbols = SymbolPool();
+    auto lexer = Lexer(Testcases(), symbols);
+    auto words = std::vector<std::string_view>();
+    for (auto &t : lexer.GetAllTokens()) {
+        if (t.Type() == Token::Tag::ID || Token::IsKeyword(lexer.Arena().Text(t))) {
+            words.push_back(lexer.Arena().Text(t));
+        }
+    }
+    return words;
+}
+
+// the lookup ScanNormalId used to do: build a std::string, hash it
+static void BM_KeywordUnorderedMap(benchmark::State &state) {
+    auto map = Map<std::string, Token::Tag>();
+    for (auto &kw : KEYWORDS) {
+        map.emplace(kw.name, kw.tag);
+    }
+    auto words = Words();
+    for (auto _ : state) {
+        for (auto w : words) {
+            auto it = map.find(std::string(w));
+            benchmark::DoNotOptimize(it);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * words.size());
+}
+BENCHMARK(BM_KeywordUnorderedMap);
+
+static void BM_KeywordPerfectHash(benchmark::State &state) {
+    auto words = Words();
+    for (auto _ : state) {
+        for (auto w : words) {
+            benchmark::DoNotOptimize(Token::IsKeyword(w));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * words.size());
+}
+BENCHMARK(BM_KeywordPerfectHash);
+
+static void BM_LexTestcases(benchmark::State &state) {
+    auto &source = Testcases();
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        auto lexer = Lexer(source, symbols);
+        benchmark::DoNotOptimize(lexer.GetAllTokens().size());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_LexTestcases);
+
+// the testcases repeated up to 16MB, lexed on 1..N threads
+static void BM_LexParallel(benchmark::State &state) {
+    static auto source = []() {
+        auto result = std::string();
+        while (result.size() < (16u << 20)) {
+            result += Testcases();
+        }
+        return result;
+    }();
+    auto pool = ThreadPool(state.range(0));
+    auto lexer = ParallelLexer(pool);
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        benchmark::DoNotOptimize(lexer.Lex(source, symbols).Tokens().size());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_LexParallel)->RangeMultiplier(2)
+    ->Range(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
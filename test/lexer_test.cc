@@ -1,27 +1,156 @@
 #include <gtest/gtest.h>
 #include "tiger/lexer.h"
+#include "tiger/parallel_lexer.h"
+#include "tiger/scan_kernels.h"
+#include "utils/source_buffer.h"
 
-#define ASSERT_TOKEN_EQ(token_ptr, token)                   \
+#define ASSERT_TOKEN_EQ(arena, token, tag, text)            \
     do {                                                    \
-        ASSERT_NE(token_ptr, nullptr);                      \
-        ASSERT_EQ(token_ptr->Type(), token.Type());         \
-        ASSERT_EQ(token_ptr->Value(), token.Value());       \
+        ASSERT_EQ(token.Type(), tag);                       \
+        ASSERT_EQ(arena.Text(token), text);                 \
     } while (0);
 
 TEST(TestNum, HandleComplexInput) {
-    Lexer lexer("1234");
-    ASSERT_EQ(lexer.GetNextToken()->Value(), Token(Token::Tag::NUM, "1234").Value());
-    ASSERT_EQ(lexer.GetNextToken(), nullptr);
+    SymbolPool symbols;
+    Lexer lexer("1234", symbols);
+    auto token = lexer.GetNextToken();
+    ASSERT_TRUE(token.has_value());
+    ASSERT_TOKEN_EQ(lexer.Arena(), (*token), Token::Tag::NUM, "1234");
+    ASSERT_EQ(token->Slot(), 1234);
+    ASSERT_EQ(lexer.GetNextToken(), std::nullopt);
+}
+
+// the largest int is the largest literal, a longer one is invalid as a
+// whole rather than wrapped
+TEST(TestNum, OutOfRange) {
+    SymbolPool symbols;
+    Lexer lexer("2147483647 2147483648 4294967297 99999999999999999999+", symbols);
+    auto token = lexer.GetNextToken();
+    ASSERT_TOKEN_EQ(lexer.Arena(), (*token), Token::Tag::NUM, "2147483647");
+    ASSERT_EQ(token->Slot(), 2147483647u);
+    for (auto text : {"2147483648", "4294967297", "99999999999999999999"}) {
+        token = lexer.GetNextToken();
+        ASSERT_TOKEN_EQ(lexer.Arena(), (*token), Token::Tag::INVALID, text);
+    }
+    token = lexer.GetNextToken();
+    ASSERT_EQ(token->Type(), Token::Tag::PLUS);
 }
 
 TEST(TestComment, HandleSimpleInput) {
-    Lexer lexer("/*this is comment*/");
-    auto tokens = lexer.GetAllTokens();
+    SymbolPool symbols;
+    Lexer lexer("/*this is comment*/", symbols);
+    auto &tokens = lexer.GetAllTokens();
     ASSERT_EQ(tokens.size(), 1);
-    ASSERT_TOKEN_EQ(tokens.front(), Token(Token::Tag::COMMENT, "/*this is comment*/"));
+    ASSERT_TOKEN_EQ(lexer.Arena(), tokens.front(), Token::Tag::COMMENT, "/*this is comment*/");
+}
+
+TEST(TestString, DecodesEscapes) {
+    SymbolPool symbols;
+    Lexer lexer("x := \"a\\tb\"", symbols);
+    auto &tokens = lexer.GetAllTokens();
+    ASSERT_EQ(tokens.size(), 3);
+    ASSERT_TOKEN_EQ(lexer.Arena(), tokens[0], Token::Tag::ID, "x");
+    ASSERT_TOKEN_EQ(lexer.Arena(), tokens[1], Token::Tag::ASSIGN, ":=");
+    ASSERT_TOKEN_EQ(lexer.Arena(), tokens[2], Token::Tag::STR, "a\tb");
+    ASSERT_EQ(tokens[2].Offset(), 5);
+    ASSERT_EQ(tokens[2].Length(), 6);
+}
+
+TEST(TestKeyword, PerfectHash) {
+    for (auto &kw : KEYWORDS) {
+        ASSERT_EQ(Token::IsKeyword(kw.name), kw.tag);
+        auto longer = std::string(kw.name) + "_";
+        ASSERT_FALSE(Token::IsKeyword(longer));
+        ASSERT_FALSE(Token::IsKeyword(kw.name.substr(1)));
+    }
+    ASSERT_FALSE(Token::IsKeyword("x"));
+    ASSERT_FALSE(Token::IsKeyword("iff"));
+    ASSERT_FALSE(Token::IsKeyword("Function"));
+}
+
+TEST(TestScanKernels, AgreeWithScalar) {
+    auto input = std::string();
+    for (int i = 0; i < 300; ++i) {
+        input += std::string(i % 37, i % 3 ? ' ' : '\t');
+        input += std::string(i % 41, "aZ_9"[i % 4]);
+        input += "\x80\"\\*/+"[i % 7];
+    }
+    auto all = ScanKernels::Available();
+    auto &scalar = *all.front();
+    auto end = input.data() + input.size();
+    for (auto k : all) {
+        for (auto p = input.data(); p < end; ++p) {
+            ASSERT_EQ(k->SkipBlanks(p, end), scalar.SkipBlanks(p, end)) << k->name;
+            ASSERT_EQ(k->SkipIdent(p, end), scalar.SkipIdent(p, end)) << k->name;
+            ASSERT_EQ(k->FindStar(p, end), scalar.FindStar(p, end)) << k->name;
+            ASSERT_EQ(k->FindStrStop(p, end), scalar.FindStrStop(p, end)) << k->name;
+        }
+    }
+}
+
+TEST(TestSourceBuffer, MappedFileMatchesString) {
+    auto mapped = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + "queens.tig");
+    ASSERT_TRUE(mapped.IsMapped());
+    auto copied = SourceBuffer::FromString(std::string(mapped.View()));
+    ASSERT_FALSE(copied.IsMapped());
+
+    auto symbols = SymbolPool();
+    auto lhs = Lexer(mapped.View(), symbols);
+    auto rhs = Lexer(copied.View(), symbols);
+    ASSERT_EQ(lhs.GetAllTokens(), rhs.GetAllTokens());
+}
+
+TEST(TestParallelLexer, MatchesSerial) {
+    auto source = std::string();
+    for (int i = 0; i < 40; ++i) {
+        source += "var x" + std::to_string(i) + " := \"line one\n";
+        source += "still the \\\"same\\\" string\"\n";
+        source += "/* a comment\n   \"spanning\" lines */ f(" + std::to_string(i) + ")\n";
+        source += "  \t  if a <> b then \"x\" else \"\"\n";
+    }
+    source += "/* unterminated";
+
+    auto serial_symbols = SymbolPool();
+    auto serial = Lexer(source, serial_symbols);
+    auto &expect = serial.GetAllTokens();
+
+    auto pool = ThreadPool(4);
+    for (size_t chunk : {1, 7, 16, 64, 1000, 1 << 20}) {
+        auto symbols = SymbolPool();
+        auto arena = ParallelLexer(pool, chunk).Lex(source, symbols);
+        ASSERT_EQ(arena.Tokens(), expect) << "chunk " << chunk;
+        ASSERT_EQ(symbols.Size(), serial_symbols.Size());
+        for (auto &t : expect) {
+            ASSERT_EQ(arena.Text(t), serial.Arena().Text(t));
+        }
+    }
+}
+
+TEST(TestSymbol, InternsOncePerName) {
+    auto symbols = SymbolPool();
+    auto lexer = Lexer("var x := y + x.x /* x */ _main", symbols);
+    auto &tokens = lexer.GetAllTokens();
+    ASSERT_EQ(tokens[1].Slot(), tokens[5].Slot());
+    ASSERT_EQ(tokens[1].Slot(), tokens[7].Slot());
+    ASSERT_EQ(tokens[1].Slot(), symbols.Find("x").Id());
+    ASSERT_NE(tokens[3].Slot(), tokens[1].Slot());
+    ASSERT_EQ(symbols.Name(Symbol(tokens.back().Slot())), "_main");
+    ASSERT_FALSE(symbols.Find("var").Valid());
+    ASSERT_FALSE(symbols.Find("z").Valid());
+
+    // grow well past the initial table and look every name up again
+    for (int i = 0; i < 1000; ++i) {
+        symbols.Intern("n" + std::to_string(i));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto name = "n" + std::to_string(i);
+        ASSERT_EQ(symbols.Name(symbols.Find(name)), name);
+    }
+    auto use = SymbolPool::Use(symbols);
+    ASSERT_EQ(symbols.Find("y").Name(), "y");
 }
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
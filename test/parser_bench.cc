@@ -0,0 +1,206 @@
+#include <benchmark/benchmark.h>
+#include "tiger/parser.h"
+#include "tiger/flat_ast.h"
+#include "tiger/ast_cache.h"
+#include "tiger/incremental.h"
+#include "tiger/parallel_parser.h"
+
+#include <sys/resource.h>
+#include <cstdlib>
+#include <string>
+
+// one let holding `n` groups of declarations, about 300 bytes each
+static std::string LargeProgram(int n) {
+    auto source = std::string("let\n");
+    for (int i = 0; i < n; ++i) {
+        auto k = std::to_string(i);
+        source += "  type r" + k + " = {a: int, b: string}\n";
+        source += "  var v" + k + " := intArray [ 10 ] of " + k + "\n";
+        source += "  function f" + k + "(a: int, b: int): int =\n"
+                  "    let var x := a * 2 + b - v" + k + "[a]\n"
+                  "    in if x > 10 & b <> 0 then f" + k + "(x - 1, b)\n"
+                  "       else (x := x + 1; print(\"x\"); x) end\n";
+    }
+    source += "in\n  f0(1, 2)\nend\n";
+    return source;
+}
+
+static long PeakRssKb() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// lex, parse and free the ast of a large program
+static void BM_Parse(benchmark::State &state) {
+    auto source = LargeProgram(state.range(0));
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        auto nodes = Arena();
+        auto lexer = Lexer(source, symbols);
+        auto ast = Parser(lexer, nodes).ParseResult();
+        benchmark::DoNotOptimize(ast);
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["peak_rss_kb"] = PeakRssKb();
+}
+BENCHMARK(BM_Parse)->RangeMultiplier(8)->Range(64, 32768)
+    ->Unit(benchmark::kMillisecond);
+
+// the indented text dump of the whole tree
+// one expression of `n` operators cycling through every precedence level
+static void BM_ParseChain(benchmark::State &state) {
+    static const char *OPS[] = {" + ", " * ", " - ", " / ", " < ", " & ", " | "};
+    auto source = std::string("let in 1");
+    for (int i = 0; i < state.range(0); ++i) {
+        source += OPS[i % std::size(OPS)] + std::to_string(i);
+    }
+    source += " end\n";
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        auto nodes = Arena();
+        auto lexer = Lexer(source, symbols);
+        auto ast = Parser(lexer, nodes).ParseResult();
+        benchmark::DoNotOptimize(ast);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseChain)->RangeMultiplier(8)->Range(64, 32768)
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_DumpText(benchmark::State &state) {
+    auto source = LargeProgram(state.range(0));
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ast->ToString(0).size());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_DumpText)->RangeMultiplier(8)->Range(64, 4096)
+    ->Unit(benchmark::kMillisecond);
+
+// the text dump of `depth` nested parentheses
+static void BM_DumpDeep(benchmark::State &state) {
+    auto source = std::string();
+    for (int i = 0; i < state.range(0); ++i) {
+        source += "(1 + ";
+    }
+    source += "1" + std::string(state.range(0), ')');
+    auto symbols = SymbolPool();
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ast->ToString(0).size());
+    }
+}
+BENCHMARK(BM_DumpDeep)->RangeMultiplier(4)->Range(16, 1024)
+    ->Unit(benchmark::kMillisecond);
+
+// convert the tree into the flat layout
+static void BM_Flatten(benchmark::State &state) {
+    auto source = LargeProgram(state.range(0));
+    auto symbols = SymbolPool();
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    for (auto _ : state) {
+        auto flat = FlatAst::Build(ast);
+        state.counters["nodes"] = flat.Size();
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_Flatten)->RangeMultiplier(8)->Range(64, 32768)
+    ->Unit(benchmark::kMillisecond);
+
+// a pass over every node of the flat layout: count nodes per kind
+static void BM_WalkFlat(benchmark::State &state) {
+    auto source = LargeProgram(state.range(0));
+    auto symbols = SymbolPool();
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto flat = FlatAst::Build(Parser(lexer, nodes).ParseResult());
+    for (auto _ : state) {
+        u32 counts[64] = {};
+        for (u32 n = 0; n < flat.Size(); ++n) {
+            counts[static_cast<u8>(flat.GetKind(n))] += flat.Children(n).size();
+        }
+        benchmark::DoNotOptimize(counts);
+    }
+    state.SetItemsProcessed(state.iterations() * flat.Size());
+}
+BENCHMARK(BM_WalkFlat)->RangeMultiplier(8)->Range(64, 32768)
+    ->Unit(benchmark::kMillisecond);
+
+// what a cache hit costs instead of BM_Parse: map the image and check it
+static void BM_CacheLoad(benchmark::State &state) {
+    auto source = LargeProgram(state.range(0));
+    char dir[] = "/tmp/tiger_bench_XXXXXX";
+    auto cache = AstCache(mkdtemp(dir));
+    {
+        auto symbols = SymbolPool();
+        auto use_symbols = SymbolPool::Use(symbols);
+        auto nodes = Arena();
+        auto lexer = Lexer(source, symbols);
+        cache.Store(source, FlatAst::Build(Parser(lexer, nodes).ParseResult()));
+    }
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        auto flat = cache.Load(source, symbols);
+        if (!flat) {
+            state.SkipWithError("cache miss");
+            break;
+        }
+        benchmark::DoNotOptimize(flat->Size());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+    std::system(("rm -rf " + std::string(dir)).c_str());
+}
+BENCHMARK(BM_CacheLoad)->RangeMultiplier(8)->Range(64, 32768)
+    ->Unit(benchmark::kMillisecond);
+
+// parse the pre-scanned tokens of LargeProgram(4096), serially with 0
+// threads or with ParallelParser on a pool of `threads`
+static void BM_ParseParallel(benchmark::State &state) {
+    auto source = LargeProgram(4096);
+    auto symbols = SymbolPool();
+    auto lexer = Lexer(source, symbols);
+    lexer.GetAllTokens();
+    auto threads = static_cast<u32>(state.range(0));
+    auto pool = ThreadPool(threads == 0 ? 1 : threads);
+    for (auto _ : state) {
+        auto nodes = Arena();
+        auto ast = threads == 0
+                ? Parser(lexer.Arena(), nodes).ParseResult()
+                : ParallelParser(pool).Parse(lexer.Arena(), nodes);
+        benchmark::DoNotOptimize(ast);
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(BM_ParseParallel)->Arg(0)->Arg(1)->Arg(2)->Arg(4)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// one keystroke in the middle of a large program, LargeProgram(8192)
+// is about 50k lines. The occasional full parse that drops the garbage
+// of earlier edits is part of the average.
+static void BM_IncrementalEdit(benchmark::State &state) {
+    auto n = state.range(0);
+    auto source = LargeProgram(n);
+    auto symbols = SymbolPool();
+    auto parser = IncrementalParser(source, symbols);
+    auto offset = static_cast<u32>(source.find("x := a * 2", source.size() / 2) + 9);
+    auto digit = 0;
+    for (auto _ : state) {
+        parser.Apply({offset, 1, std::to_string(digit++ % 10)});
+        benchmark::DoNotOptimize(parser.Ast());
+    }
+    state.counters["lines"] = n * 6 + 3;
+}
+BENCHMARK(BM_IncrementalEdit)->RangeMultiplier(8)->Range(64, 8192)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
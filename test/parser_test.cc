@@ -1,13 +1,23 @@
 #include <gtest/gtest.h>
 #include "tiger/parser.h"
-#include "utils/file_reader.h"
+#include "tiger/flat_ast.h"
+#include "tiger/ast_cache.h"
+#include "tiger/incremental.h"
+#include "tiger/parallel_parser.h"
+#include "program_gen.h"
+#include "utils/source_buffer.h"
+
+#include <cstdlib>
+#include <random>
+#include <sstream>
 
 void DoParse(const std::string &file) {
-    auto reader = FileReader(file.c_str());
-    auto code = reader.ReadAll();
-    auto lexer = Lexer(code);
-    auto tokens = lexer.GetAllTokens();
-    auto parser = Parser(std::move(tokens));
+    auto source = SourceBuffer::FromFile(file);
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source.View(), symbols);
+    auto parser = Parser(lexer, nodes);
     auto ast = parser.ParseResult();
     printf("\n%s\n", ast->ToString(0).c_str());
 }
@@ -18,7 +28,7 @@ TEST(ALL, ALL_CASES) {
         auto filename = "test" + std::to_string(i) + ".tig";
         files.push_back(filename);
     }
-    auto prefix = std::string("/Users/xiebei/tiger.cc/test/testcases/");
+    auto prefix = std::string(TESTCASES_DIR);
     files.emplace_back("queens.tig");
     files.emplace_back("merge.tig");
 
@@ -30,6 +40,590 @@ TEST(ALL, ALL_CASES) {
     }
 }
 
+TEST(Streaming, MatchesPreScannedTokens) {
+    auto source = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + "merge.tig");
+
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+
+    auto streaming_lexer = Lexer(source.View(), symbols);
+    auto nodes = Arena();
+    auto streaming = Parser(streaming_lexer, nodes).ParseResult();
+
+    auto lexer = Lexer(source.View(), symbols);
+    lexer.GetAllTokens();
+    auto pre_scanned = Parser(lexer.Arena(), nodes).ParseResult();
+
+    ASSERT_EQ(streaming->ToString(0), pre_scanned->ToString(0));
+}
+
+TEST(TestAstWriter, SexprAndRepeatableText) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto source = std::string("let import \"lib\" in f(a[0], \"x\\\"\\n\", 42) end");
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+
+    auto out = std::ostringstream();
+    AstWriter(out, AstWriter::Format::SEXPR).Write(ast);
+    ASSERT_EQ(out.str(),
+            "(LetExpr (Decs [(ImportDec \"lib\")]) (Exprs [(FnCall (Id f) "
+            "[(Lvar [(Elem (Id a) [(IntExpr 0)])]) (StrExpr \"x\\\"\\x0a\") (IntExpr 42)])]))\n");
+
+    // dumping leaves the tree untouched
+    auto text = ast->ToString(0);
+    ASSERT_EQ(ast->ToString(0), text);
+    ASSERT_NE(text.find("   42\n"), std::string::npos);
+}
+
+static std::string ParseSexpr(const std::string &source) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto out = std::ostringstream();
+    AstWriter(out, AstWriter::Format::SEXPR).Write(Parser(lexer, nodes).ParseResult());
+    return out.str();
+}
+
+TEST(TestBinaryExpr, PrecedenceAndAssociativity) {
+    auto body = [](const std::string &sexpr) {
+        return "(LetExpr (Decs []) (Exprs [" + sexpr + "]))\n";
+    };
+    ASSERT_EQ(ParseSexpr("let in 1 - 2 - 3 end"),
+            body("(BinaryExpr (Op \"-\") (BinaryExpr (Op \"-\") (IntExpr 1) (IntExpr 2)) (IntExpr 3))"));
+    ASSERT_EQ(ParseSexpr("let in 1 | 2 + 3 * 4 end"),
+            body("(BinaryExpr (Op \"|\") (IntExpr 1) (BinaryExpr (Op \"+\") (IntExpr 2) "
+                 "(BinaryExpr (Op \"*\") (IntExpr 3) (IntExpr 4))))"));
+    ASSERT_EQ(ParseSexpr("let in 1 * 2 < 3 & 4 <> 5 end"),
+            body("(BinaryExpr (Op \"&\") (BinaryExpr (Op \"<\") (BinaryExpr (Op \"*\") "
+                 "(IntExpr 1) (IntExpr 2)) (IntExpr 3)) (BinaryExpr (Op \"<>\") (IntExpr 4) (IntExpr 5)))"));
+    // the minus binds tighter than any binary operator
+    ASSERT_EQ(ParseSexpr("let in -1 + 2 end"),
+            body("(BinaryExpr (Op \"+\") (UnaryExpr (Op \"-\") (IntExpr 1)) (IntExpr 2))"));
+    ASSERT_EQ(ParseSexpr("let in - -a * b < c end"),
+            body("(BinaryExpr (Op \"<\") (BinaryExpr (Op \"*\") (UnaryExpr (Op \"-\") (UnaryExpr (Op \"-\") "
+                 "(Lvar [(Elem (Id a) [])]))) (Lvar [(Elem (Id b) [])])) (Lvar [(Elem (Id c) [])]))"));
+}
+
+TEST(TestBinaryExprDeathTest, ComparisonsDoNotChain) {
+    ASSERT_DEATH(ParseSexpr("let in 1 < 2 < 3 end"), "not associative");
+    ASSERT_DEATH(ParseSexpr("let in 1 = 2 + 1 <> 3 end"), "not associative");
+}
+
+TEST(TestDiagnostics, ReportsEverySyntaxError) {
+    auto source = std::string(
+            "let\n"
+            "  type t = {a: int, b: }\n"
+            "  var x := 1 +\n"
+            "  function f(a: int): int = a * 2\n"
+            "  var z := # 5\n"
+            "in\n"
+            "  f(x, );\n"
+            "  x := 1 < 2 < 3;\n"
+            "  print(\"ok\")\n"
+            "end\n");
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto diags = Diagnostics(source, "bad.tig");
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes, &diags).ParseResult();
+
+    auto positions = std::vector<std::pair<u32, u32>>();
+    for (auto &diag : diags.All()) {
+        positions.push_back(diags.Lines().LineColumn(diag.loc));
+    }
+    auto expected = std::vector<std::pair<u32, u32>> {{2, 24}, {4, 3}, {5, 12}, {7, 8}, {8, 14}};
+    ASSERT_EQ(positions, expected);
+    ASSERT_EQ(diags.ErrorCount(), 5);
+
+    // what did parse is still there
+    auto out = std::ostringstream();
+    AstWriter(out, AstWriter::Format::SEXPR).Write(ast);
+    ASSERT_NE(out.str().find("(FnDec (Id f)"), std::string::npos);
+    ASSERT_NE(out.str().find("(FnCall (Id print) [(StrExpr \"ok\")])"), std::string::npos);
+
+    auto printed = std::ostringstream();
+    diags.Print(printed);
+    ASSERT_EQ(printed.str().substr(0, printed.str().find('\n', printed.str().find('^'))),
+            "bad.tig:2:24: error: expected identifier but found right brace `}`\n"
+            "    type t = {a: int, b: }\n"
+            "                         ^");
+}
+
+// the first syntax error in `source`
+static std::string FirstError(const std::string &source) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto diags = Diagnostics(source, "bad.tig");
+    auto lexer = Lexer(source, symbols);
+    Parser(lexer, nodes, &diags).ParseResult();
+    return diags.All().empty() ? "" : diags.All()[0].message;
+}
+
+// an invalid token is named, or quoted in a few characters at most,
+// even when it runs to the end of the file
+TEST(TestDiagnostics, InvalidTokens) {
+    ASSERT_EQ(FirstError("let var a := 4294967297 + 0 in a end"),
+              "expected an expression but found integer literal `4294967297` out of range");
+    ASSERT_EQ(FirstError("let var a := " + std::string(100, '9') + " in a end"),
+              "expected an expression but found integer literal `" + std::string(24, '9') + "...` out of range");
+    ASSERT_EQ(FirstError("let in x /* never closed\nend\nmore text here\n"),
+              "expected end but found unterminated comment");
+    ASSERT_EQ(FirstError("let in print(\"never closed)\nend\nmore text here\n"),
+              "expected an expression but found unterminated string literal");
+    ASSERT_EQ(FirstError("let in print(\"a\\q\") end"),
+              "expected an expression but found invalid escape `\\q` in string literal");
+    ASSERT_EQ(FirstError("let in x # y end"), "expected end but found invalid character `#`");
+    ASSERT_EQ(FirstError("let in x \xe9 y end"), "expected end but found invalid character `\xe9`");
+}
+
+TEST(TestDiagnostics, EndOfInput) {
+    auto source = std::string("let in f(1");
+    auto symbols = SymbolPool();
+    auto nodes = Arena();
+    auto diags = Diagnostics(source, "eof.tig");
+    auto lexer = Lexer(source, symbols);
+    Parser(lexer, nodes, &diags).ParseResult();
+    ASSERT_EQ(diags.ErrorCount(), 1);
+    ASSERT_EQ(diags.All()[0].message, "expected right parenthesis but found end of input");
+    ASSERT_EQ(diags.Lines().LineColumn(diags.All()[0].loc), std::make_pair(1u, 11u));
+}
+
+TEST(TestSourceLoc, LineTable) {
+    auto lines = LineTable("ab\n\ncd\n");
+    ASSERT_EQ(lines.LineCount(), 4);
+    ASSERT_EQ(lines.LineColumn(SourceLoc(0)), std::make_pair(1u, 1u));
+    ASSERT_EQ(lines.LineColumn(SourceLoc(2)), std::make_pair(1u, 3u));
+    ASSERT_EQ(lines.LineColumn(SourceLoc(3)), std::make_pair(2u, 1u));
+    ASSERT_EQ(lines.LineColumn(SourceLoc(5)), std::make_pair(3u, 2u));
+    // unknown and past the end positions are the end of the source
+    ASSERT_EQ(lines.LineColumn(SourceLoc()), std::make_pair(4u, 1u));
+    ASSERT_EQ(lines.LineColumn(SourceLoc(100)), std::make_pair(4u, 1u));
+    ASSERT_EQ(lines.Line(3), "cd");
+    ASSERT_EQ(lines.Line(4), "");
+    ASSERT_EQ(lines.Line(5), "");
+}
+
+TEST(TestSourceLoc, EveryNodeIsLocated) {
+    auto source = std::string(
+            "let\n"
+            "  function f(a: int): int =\n"
+            "    a * 2\n"
+            "in\n"
+            "  f(1 + x[3])\n"
+            "end\n");
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto flat = FlatAst::Build(Parser(lexer, nodes).ParseResult());
+    auto lines = LineTable(source);
+
+    auto located = std::vector<std::string>();
+    for (u32 n = 0; n < flat.Size(); ++n) {
+        auto kind = flat.GetKind(n);
+        if (kind == FlatAst::Kind::LIST || kind == FlatAst::Kind::OP) {
+            ASSERT_FALSE(flat.Loc(n).IsValid());
+            continue;
+        }
+        auto [line, column] = lines.LineColumn(flat.Loc(n));
+        located.push_back(std::string(FlatAst::KindName(kind)) + "@"
+                + std::to_string(line) + ":" + std::to_string(column));
+    }
+    ASSERT_EQ(located, (std::vector<std::string> {
+            "LetExpr@1:1", "Decs@2:3", "FnDec@2:3", "Id@2:12", "TypeFields@2:14",
+            "Id@2:14", "TypeId@2:17", "TypeId@2:23", "BinaryExpr@3:7", "Lvar@3:5",
+            "Elem@3:5", "Id@3:5", "IntExpr@3:9", "Exprs@5:3", "FnCall@5:3", "Id@5:3",
+            "BinaryExpr@5:7", "IntExpr@5:5", "Lvar@5:9", "Elem@5:9", "Id@5:9", "IntExpr@5:11",
+    }));
+}
+
+TEST(TestFlatAst, MatchesTree) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto source = std::string("let var x: int := 1 + 2 in f(x, \"s\") end");
+    auto lexer = Lexer(source, symbols);
+    auto flat = FlatAst::Build(Parser(lexer, nodes).ParseResult());
+
+    ASSERT_EQ(flat.ToString(),
+            "LetExpr\n"
+            " Decs\n"
+            "  List\n"
+            "   VarDec\n"
+            "    Id x\n"
+            "    TypeId int\n"
+            "    BinaryExpr\n"
+            "     Op +\n"
+            "     IntExpr 1\n"
+            "     IntExpr 2\n"
+            " Exprs\n"
+            "  List\n"
+            "   FnCall\n"
+            "    Id f\n"
+            "    List\n"
+            "     Lvar\n"
+            "      List\n"
+            "       Elem\n"
+            "        Id x\n"
+            "        List\n"
+            "     StrExpr s\n");
+    auto let = flat.Children(0);
+    ASSERT_EQ(let.size(), 2);
+    ASSERT_EQ(flat.GetKind(let[0]), FlatAst::Kind::DECS);
+    ASSERT_EQ(flat.Sym(4), symbols.Find("x"));
+}
+
+TEST(TestFlatAst, ChildrenFollowParents) {
+    for (auto name : {"queens.tig", "merge.tig", "test30.tig", "test42.tig"}) {
+        auto source = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + name);
+        auto symbols = SymbolPool();
+        auto nodes = Arena();
+        auto lexer = Lexer(source.View(), symbols);
+        auto flat = FlatAst::Build(Parser(lexer, nodes).ParseResult());
+        ASSERT_GT(flat.Size(), 1);
+        for (u32 n = 0; n < flat.Size(); ++n) {
+            for (auto child : flat.Children(n)) {
+                ASSERT_TRUE(child == FlatAst::NONE || (child > n && child < flat.Size()));
+            }
+        }
+    }
+}
+
+static std::string Dump(const FlatAst &flat, AstWriter::Format format) {
+    auto out = std::ostringstream();
+    AstWriter(out, format).Write(flat);
+    return out.str();
+}
+
+TEST(TestFlatAst, ImageRoundTrip) {
+    for (int i = 1; i <= 51; ++i) {
+        auto name = i == 50 ? std::string("queens.tig")
+                : i == 51 ? std::string("merge.tig") : "test" + std::to_string(i) + ".tig";
+        auto source = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + name);
+        auto image = std::string();
+        auto locs = std::vector<SourceLoc>();
+        auto text = std::string();
+        auto sexpr = std::string();
+        {
+            auto symbols = SymbolPool();
+            auto use_symbols = SymbolPool::Use(symbols);
+            auto nodes = Arena();
+            auto lexer = Lexer(source.View(), symbols);
+            auto ast = Parser(lexer, nodes).ParseResult();
+            auto out = std::ostringstream();
+            AstWriter(out, AstWriter::Format::TEXT).Write(ast);
+            text = out.str();
+            out.str("");
+            AstWriter(out, AstWriter::Format::SEXPR).Write(ast);
+            sexpr = out.str();
+
+            auto flat = FlatAst::Build(ast);
+            ASSERT_EQ(Dump(flat, AstWriter::Format::TEXT), text) << name;
+            ASSERT_EQ(Dump(flat, AstWriter::Format::SEXPR), sexpr) << name;
+            image = flat.Serialize(42);
+            for (u32 n = 0; n < flat.Size(); ++n) {
+                locs.push_back(flat.Loc(n));
+            }
+        }
+        // load into a pool whose ids differ from the ones that wrote it
+        auto symbols = SymbolPool();
+        auto use_symbols = SymbolPool::Use(symbols);
+        symbols.Intern("unrelated");
+        symbols.Intern("names");
+        auto loaded = FlatAst::Load(SourceBuffer::FromString(image), 42, symbols);
+        ASSERT_TRUE(loaded.has_value()) << name;
+        ASSERT_EQ(Dump(*loaded, AstWriter::Format::TEXT), text) << name;
+        ASSERT_EQ(Dump(*loaded, AstWriter::Format::SEXPR), sexpr) << name;
+        for (u32 n = 0; n < loaded->Size(); ++n) {
+            ASSERT_EQ(loaded->Loc(n), locs[n]) << name;
+        }
+    }
+}
+
+TEST(TestFlatAst, RejectsDamagedImages) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer("let var a := f(1, \"s\") in a + 2 end", symbols);
+    auto image = FlatAst::Build(Parser(lexer, nodes).ParseResult()).Serialize(7);
+
+    ASSERT_TRUE(FlatAst::Load(SourceBuffer::FromString(image), 7, symbols).has_value());
+    ASSERT_FALSE(FlatAst::Load(SourceBuffer::FromString(image), 8, symbols).has_value());
+    ASSERT_FALSE(FlatAst::Load(SourceBuffer::FromString(""), 7, symbols).has_value());
+    for (size_t n = 0; n < image.size(); n += 7) {
+        ASSERT_FALSE(FlatAst::Load(
+                SourceBuffer::FromString(image.substr(0, n)), 7, symbols).has_value()) << n;
+    }
+    // every byte of the arrays is either checked or harmless to flip
+    for (size_t i = 0; i < image.size(); ++i) {
+        auto damaged = image;
+        damaged[i] = static_cast<char>(0xff);
+        auto flat = FlatAst::Load(SourceBuffer::FromString(damaged), 7, symbols);
+        if (flat) {
+            Dump(*flat, AstWriter::Format::SEXPR);
+        }
+    }
+}
+
+TEST(TestAstCache, HitsOnlyUnchangedSource) {
+    char dir[] = "/tmp/tiger_cache_test_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    auto cache = AstCache(std::string(dir) + "/nested");
+    auto source = std::string("let var a := 1 in a + 2 end");
+
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    ASSERT_FALSE(cache.Load(source, symbols).has_value());
+
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto ast = Parser(lexer, nodes).ParseResult();
+    ASSERT_TRUE(cache.Store(source, FlatAst::Build(ast)));
+
+    auto hit = cache.Load(source, symbols);
+    ASSERT_TRUE(hit.has_value());
+    ASSERT_EQ(Dump(*hit, AstWriter::Format::TEXT), ast->ToString(0));
+    ASSERT_FALSE(cache.Load(source + " ", symbols).has_value());
+    ASSERT_NE(AstCache::Key(source), AstCache::Key(source + " "));
+
+    std::system(("rm -rf " + std::string(dir)).c_str());
+}
+
+// the sexpr dump and every loc of `ast`
+static std::pair<std::string, std::vector<u32>> Snapshot(AstNodePtr ast) {
+    auto out = std::ostringstream();
+    AstWriter(out, AstWriter::Format::SEXPR).Write(ast);
+    auto locs = std::vector<u32>();
+    if (ast != nullptr) {
+        auto flat = FlatAst::Build(ast);
+        for (u32 n = 0; n < flat.Size(); ++n) {
+            locs.push_back(flat.Loc(n).Offset());
+        }
+    }
+    return std::make_pair(out.str(), locs);
+}
+
+// the ast, tokens and diagnostics of `parser` must be what parsing its
+// text from scratch gives
+static void ExpectFreshParse(const IncrementalParser &parser, SymbolPool &symbols) {
+    auto nodes = Arena();
+    auto lexer = Lexer(parser.Text(), symbols);
+    auto &tokens = lexer.GetAllTokens();
+    auto diags = Diagnostics(parser.Text(), "<input>");
+    auto fresh = Parser(lexer.Arena(), nodes, &diags).ParseResult();
+
+    ASSERT_EQ(Snapshot(parser.Ast()), Snapshot(fresh)) << parser.Text();
+    ASSERT_EQ(parser.Diags().ErrorCount(), diags.ErrorCount()) << parser.Text();
+
+    auto &kept = parser.Tokens().Tokens();
+    ASSERT_EQ(kept.size(), tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        ASSERT_EQ(kept[i].Type(), tokens[i].Type());
+        ASSERT_EQ(kept[i].Offset(), tokens[i].Offset());
+        ASSERT_EQ(parser.Tokens().Text(kept[i]), lexer.Arena().Text(tokens[i]));
+    }
+}
+
+TEST(TestIncremental, ReusesUntouchedDecs) {
+    auto source = std::string("let\n");
+    for (int i = 0; i < 20; ++i) {
+        auto k = std::to_string(i);
+        source += "  function f" + k + "(a: int): int = a + " + k + "\n";
+    }
+    source += "  var s := \"tiger\"\nin\n  f3(s)\nend\n";
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto parser = IncrementalParser(source, symbols);
+    ExpectFreshParse(parser, symbols);
+
+    auto at = [&](const std::string &s) {
+        return static_cast<u32>(parser.Text().find(s));
+    };
+    // one keystroke in the body of f10
+    parser.Apply({at("a + 10"), 1, "b"});
+    ExpectFreshParse(parser, symbols);
+    auto stats = parser.LastStats();
+    ASSERT_FALSE(stats.full);
+    ASSERT_EQ(stats.relexed, 1);
+    ASSERT_EQ(stats.reparsed, 2);
+    ASSERT_EQ(stats.reused, 19);
+
+    // a new declaration, a removed one, one split in two
+    parser.Apply({at("  function f5"), 0, "  type t = array of int\n"});
+    ExpectFreshParse(parser, symbols);
+    ASSERT_EQ(parser.LastStats().reused, 19);
+    parser.Apply({at("  function f7"), at("  function f8") - at("  function f7"), ""});
+    ExpectFreshParse(parser, symbols);
+    parser.Apply({at("a + 12"), 1, "a\n  function g(a: int): int = a"});
+    ExpectFreshParse(parser, symbols);
+
+    // strings, the body of the let, and in front of the declarations
+    parser.Apply({at("tiger"), 5, "lion\\n"});
+    ExpectFreshParse(parser, symbols);
+    parser.Apply({at("f3(s)"), 5, "f4(s); f5(1)"});
+    ExpectFreshParse(parser, symbols);
+    ASSERT_EQ(parser.LastStats().reparsed, 2);
+    parser.Apply({at("  function f0"), 0, "  type u = int\n"});
+    ExpectFreshParse(parser, symbols);
+    ASSERT_TRUE(parser.LastStats().full);
+
+    // a syntax error, and its fix
+    parser.Apply({at("a + 15"), 6, "a +"});
+    ExpectFreshParse(parser, symbols);
+    ASSERT_TRUE(parser.Diags().HasErrors());
+    parser.Apply({at("a +\n"), 3, "a + 1"});
+    ExpectFreshParse(parser, symbols);
+    ASSERT_FALSE(parser.Diags().HasErrors());
+}
+
+// random keystrokes, most of them breaking the program for a while
+TEST(TestIncremental, RandomEditsMatchFullParse) {
+    static const std::string PIECES[] = {
+        " ", "\n", "a", "1", "\"", "/*", "*/", "+", "(", ")", ":=", ";",
+        "function g(x: int) = x", "var y := 2", "type z = int", "let", "in", "end",
+    };
+    auto prefix = std::string(TESTCASES_DIR);
+    auto random = std::mt19937(16);
+    for (auto name : {"queens.tig", "merge.tig", "test42.tig"}) {
+        auto source = SourceBuffer::FromFile(prefix + name);
+        auto symbols = SymbolPool();
+        auto use_symbols = SymbolPool::Use(symbols);
+        auto parser = IncrementalParser(std::string(source.View()), symbols);
+        for (int i = 0; i < 200; ++i) {
+            auto size = static_cast<u32>(parser.Text().size());
+            auto offset = static_cast<u32>(random() % (size + 1));
+            auto removed = std::min<u32>(size - offset, random() % 4);
+            auto inserted = random() % 3 == 0 ? std::string() : PIECES[random() % std::size(PIECES)];
+            parser.Apply({offset, removed, inserted});
+            ExpectFreshParse(parser, symbols);
+        }
+    }
+}
+
+static std::string ManyDecs(int n, bool let) {
+    auto source = std::string(let ? "let\n" : "");
+    for (int i = 0; i < n; ++i) {
+        auto k = std::to_string(i);
+        source += "/* group " + k + " */\n";
+        source += "type r" + k + " = {a: int, b: string}\n";
+        source += "type K" + k + " = class extends Object { var m := 1 }\n";
+        source += "class C" + k + " extends Object ( var n := " + k + " method get(): int = n )\n";
+        source += "function f" + k + "(a: int): int =\n"
+                  "  let var x := a * 2 function g(y: int): int = y + x\n"
+                  "  in if x > 10 then f" + k + "(x - 1) else g(x) end\n";
+        source += "var v" + k + " := r" + k + " {a = " + k + ", b = \"s\"}\n";
+    }
+    source += let ? "in\n  f0(1)\nend\n" : "";
+    return source;
+}
+
+TEST(TestParallelParser, MatchesSerial) {
+    auto sources = std::vector<std::string> {
+        ManyDecs(30, false),
+        ManyDecs(30, true),
+        // a syntax error in the middle, and a let that is an operand
+        ManyDecs(10, true) + ManyDecs(10, false).replace(400, 1, ":= ("),
+        ManyDecs(10, true) + " + 1",
+        "let in 1 end",
+    };
+    auto prefix = std::string(TESTCASES_DIR);
+    for (auto name : {"queens.tig", "merge.tig", "test42.tig", "test45.tig"}) {
+        sources.emplace_back(SourceBuffer::FromFile(prefix + name).View());
+    }
+
+    auto pool = ThreadPool(4);
+    for (size_t i = 0; i < sources.size(); ++i) {
+        auto &source = sources[i];
+        auto symbols = SymbolPool();
+        auto use_symbols = SymbolPool::Use(symbols);
+        auto lexer = Lexer(source, symbols);
+        lexer.GetAllTokens();
+
+        auto serial_nodes = Arena();
+        auto serial_diags = Diagnostics(source, "<input>");
+        auto serial = Parser(lexer.Arena(), serial_nodes, &serial_diags).ParseResult();
+        auto expect_diags = std::ostringstream();
+        serial_diags.Print(expect_diags);
+
+        for (u32 group : {1, 7, 64, 1 << 20}) {
+            auto nodes = Arena();
+            auto diags = Diagnostics(source, "<input>");
+            auto parser = ParallelParser(pool, group);
+            auto ast = parser.Parse(lexer.Arena(), nodes, &diags);
+            ASSERT_EQ(Snapshot(ast), Snapshot(serial)) << "group " << group;
+            if (i < 2 && group < 64) {
+                ASSERT_GT(parser.Groups(), 1) << "group " << group;
+            }
+            auto out = std::ostringstream();
+            diags.Print(out);
+            ASSERT_EQ(out.str(), expect_diags.str()) << "group " << group;
+        }
+    }
+}
+
+TEST(TestProgramGen, DeterministicAndWellFormed) {
+    auto shapes = std::vector<ProgramShape> {
+        {}, {0}, {50, 0, 1, 0, 0, 7}, {20, 6, 3, 50, 50, 8}, {10, 1, 64, 100, 100, 9},
+    };
+    for (auto &shape : shapes) {
+        auto source = GenerateProgram(shape);
+        ASSERT_EQ(GenerateProgram(shape), source);
+        auto other = shape;
+        ++other.seed;
+        if (shape.functions > 0) {
+            ASSERT_NE(GenerateProgram(other), source);
+        }
+
+        auto symbols = SymbolPool();
+        auto nodes = Arena();
+        auto lexer = Lexer(source, symbols);
+        auto diags = Diagnostics(source, "<generated>");
+        auto ast = Parser(lexer, nodes, &diags).ParseResult();
+        auto printed = std::ostringstream();
+        diags.Print(printed);
+        ASSERT_FALSE(diags.HasErrors()) << printed.str() << source;
+        ASSERT_NE(dynamic_cast<LetStmtPtr>(ast), nullptr);
+    }
+
+    // the knobs show up in the text
+    auto plain = GenerateProgram({30, 2, 2, 0, 0, 5});
+    ASSERT_EQ(plain.find("/*"), std::string::npos);
+    ASSERT_EQ(plain.find('"'), std::string::npos);
+    auto text = GenerateProgram({30, 2, 2, 100, 100, 5});
+    ASSERT_NE(text.find("/*"), std::string::npos);
+    ASSERT_NE(text.find("print(\""), std::string::npos);
+}
+
+TEST(TestArena, AlignsAndKeepsBigBlocksApart) {
+    auto arena = Arena();
+    auto c = static_cast<char *>(arena.Allocate(1, 1));
+    auto d = arena.New<double>(1.5);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(d) % alignof(double), 0);
+    ASSERT_EQ(*d, 1.5);
+
+    // a big array gets its own block, small objects keep bumping after c
+    auto big = arena.Copy(std::vector<u64>(Arena::BLOCK_SIZE, 7));
+    auto e = static_cast<char *>(arena.Allocate(1, 1));
+    ASSERT_EQ(big.size(), Arena::BLOCK_SIZE);
+    ASSERT_EQ(big.back(), 7);
+    ASSERT_LT(e - c, 64);
+
+    ASSERT_TRUE(arena.Copy(std::vector<int>()).empty());
+    ASSERT_EQ(arena.Copy(std::string_view("tiger")), "tiger");
+
+    // adopted blocks outlive the arena they came from
+    auto other = Arena();
+    auto f = other.New<double>(2.5);
+    arena.Adopt(std::move(other));
+    ASSERT_EQ(*f, 2.5);
+    ASSERT_EQ(other.Reserved(), 0);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,220 @@
+#ifndef TIGER_CC_PROGRAM_GEN_H
+#define TIGER_CC_PROGRAM_GEN_H
+
+#include "tiger/common.h"
+
+#include <iterator>
+#include <random>
+#include <string>
+
+/**
+ * @brief shape of a synthetic program, see GenerateProgram.
+ */
+struct ProgramShape {
+    // top level functions, each calls only the ones before it
+    u32 functions {100};
+    // let / if / while / sequence levels in every function body
+    u32 depth {2};
+    // binary operators in every arithmetic expression
+    u32 expr_length {4};
+    // chance, in percent, of a print("...") in front of an expression
+    // and of a comment in front of a declaration or expression
+    u32 string_percent {10};
+    u32 comment_percent {10};
+    u64 seed {1};
+    // mutually recursive record and array types, one global of each
+    // record, and field accesses and records made in the functions
+    u32 types {0};
+};
+
+/**
+ * @brief writes deterministic tiger programs for benchmarks and tests:
+ * the same shape gives the same text on every platform, the random
+ * choices come straight from mt19937_64 without any distribution.
+ * Programs are well formed and well typed, all of them ints, strings,
+ * one int array and `types` records.
+ */
+class ProgramGen {
+public:
+    explicit ProgramGen(const ProgramShape &shape): shape_(shape), random_(shape.seed) {}
+
+    std::string Generate() {
+        if (shape_.functions == 0) {
+            return "let\n  var table := 0\nin\n  table\nend\n";
+        }
+        out_ = "let\n";
+        out_ += "  type intArray = array of int\n";
+        out_ += "  var table := intArray [ 64 ] of 0\n";
+        Types();
+        for (function_ = 0; function_ < shape_.functions; ++function_) {
+            Comment("  ");
+            auto f = std::to_string(function_);
+            out_ += "  function f" + f + "(a: int, b: int): int =\n    ";
+            Body(shape_.depth, 4);
+            out_ += "\n";
+        }
+        out_ += "in\n  f" + std::to_string(shape_.functions - 1) + "(1, 2)\nend\n";
+        return out_;
+    }
+
+private:
+    u32 Pick(u32 n) {
+        return static_cast<u32>(random_() % n);
+    }
+
+    bool Chance(u32 percent) {
+        return Pick(100) < percent;
+    }
+
+    void Indent(u32 indent) {
+        out_ += "\n" + std::string(indent, ' ');
+    }
+
+    void Comment(const char *indent) {
+        if (Chance(shape_.comment_percent)) {
+            out_ += indent;
+            out_ += "/* step " + std::to_string(Pick(1000)) + ": keep a and b in range */\n";
+        }
+    }
+
+    // an int expression of `depth` nested levels
+    void Body(u32 depth, u32 indent) {
+        if (Chance(shape_.comment_percent)) {
+            out_ += "/* level " + std::to_string(depth) + " */ ";
+        }
+        if (depth == 0) {
+            Expr();
+            return;
+        }
+        auto next = indent + 2;
+        switch (Pick(4)) {
+            case 0:
+                out_ += "let var x" + std::to_string(depth) + " := ";
+                if (shape_.types > 0) {
+                    Record();
+                } else {
+                    Expr();
+                }
+                out_ += " in";
+                Indent(next);
+                Body(depth - 1, next);
+                Indent(indent);
+                out_ += "end";
+                break;
+            case 1:
+                out_ += "if ";
+                Expr();
+                out_ += " > " + std::to_string(Pick(100)) + " then";
+                Indent(next);
+                Body(depth - 1, next);
+                Indent(indent);
+                out_ += "else";
+                Indent(next);
+                Body(depth - 1, next);
+                break;
+            case 2:
+                out_ += "(while a < b & a < 64 do table[a] := table[a] + 1;";
+                Indent(next);
+                Body(depth - 1, next);
+                out_ += ")";
+                break;
+            default:
+                out_ += "(";
+                if (Chance(shape_.string_percent)) {
+                    Print();
+                    out_ += "; ";
+                }
+                out_ += "a := ";
+                Expr();
+                out_ += ";";
+                Indent(next);
+                Body(depth - 1, next);
+                out_ += ")";
+                break;
+        }
+    }
+
+    // rK = {id: int, name: string, next: rK+1, items: aK}, aK = array of
+    // rK, the last record points back at the first
+    void Types() {
+        for (u32 k = 0; k < shape_.types; ++k) {
+            auto r = std::to_string(k);
+            out_ += "  type r" + r + " = {id: int, name: string, next: r" + std::to_string((k + 1) % shape_.types)
+                    + ", items: a" + r + "}\n";
+            out_ += "  type a" + r + " = array of r" + r + "\n";
+        }
+        for (u32 k = 0; k < shape_.types; ++k) {
+            auto r = std::to_string(k);
+            out_ += "  var v" + r + " := r" + r + " {id = " + r + ", name = \"v" + r
+                    + "\", next = nil, items = a" + r + " [ 4 ] of nil}\n";
+        }
+    }
+
+    void Record() {
+        auto k = Pick(shape_.types);
+        auto r = std::to_string(k);
+        out_ += "r" + r + " {id = ";
+        Expr();
+        out_ += ", name = \"x\", next = v" + std::to_string((k + 1) % shape_.types)
+                + ", items = a" + r + " [ 2 ] of v" + r + "}";
+    }
+
+    void Print() {
+        static const char *WORDS[] = {"tiger", "lexer", "parser", "node", "\\\"quoted\\\"", "line\\n", "tab\\t"};
+        out_ += "print(\"";
+        for (u32 i = 0, n = 1 + Pick(6); i < n; ++i) {
+            out_ += (i == 0 ? "" : " ") + std::string(WORDS[Pick(std::size(WORDS))]);
+        }
+        out_ += "\")";
+    }
+
+    // expr_length operators over small operands
+    void Expr() {
+        static const char *OPS[] = {" + ", " - ", " * ", " / "};
+        Operand();
+        for (u32 i = 0; i < shape_.expr_length; ++i) {
+            out_ += OPS[Pick(std::size(OPS))];
+            Operand();
+        }
+    }
+
+    void Operand() {
+        switch (Pick(shape_.types > 0 ? 7 : 6)) {
+            case 0:
+                out_ += "a";
+                break;
+            case 1:
+                out_ += "b";
+                break;
+            case 2:
+                out_ += "table[" + std::to_string(Pick(64)) + "]";
+                break;
+            case 6: {
+                auto v = "v" + std::to_string(Pick(shape_.types));
+                out_ += Chance(50) ? v + ".next.id" : v + ".items[" + std::to_string(Pick(4)) + "].next.id";
+                break;
+            }
+            case 3:
+                if (function_ > 0) {
+                    out_ += "f" + std::to_string(Pick(function_)) + "(a, " + std::to_string(Pick(10)) + ")";
+                    break;
+                }
+                // fall through
+            default:
+                out_ += std::to_string(1 + Pick(999));
+                break;
+        }
+    }
+
+private:
+    ProgramShape shape_;
+    std::mt19937_64 random_;
+    std::string out_;
+    u32 function_ {0};
+};
+
+inline std::string GenerateProgram(const ProgramShape &shape) {
+    return ProgramGen(shape).Generate();
+}
+
+#endif // TIGER_CC_PROGRAM_GEN_H
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+#include "tiger/lexer.h"
+#include "tiger/scan_kernels.h"
+
+#include <string>
+
+// run of `n` bytes that `kernel` should skip, followed by its stop byte
+static std::string MakeRun(const std::string &kind, size_t n) {
+    auto s = std::string();
+    if (kind == "blanks") {
+        for (size_t i = 0; i < n; ++i) {
+            s.push_back(i % 7 == 0 ? '\t' : ' ');
+        }
+        s.push_back('x');
+    } else if (kind == "ident") {
+        const char alnum[] = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+        for (size_t i = 0; i < n; ++i) {
+            s.push_back(alnum[i % (sizeof(alnum) - 1)]);
+        }
+        s.push_back(' ');
+    } else if (kind == "comment") {
+        for (size_t i = 0; i < n; ++i) {
+            s.push_back("lorem ipsum dolor sit amet / "[i % 29]);
+        }
+        s += "*/";
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            s.push_back("the quick brown fox "[i % 20]);
+        }
+        s.push_back('"');
+    }
+    return s;
+}
+
+static ScanKernels::Kernel Pick(const ScanKernels &k, const std::string &kind) {
+    if (kind == "blanks") {
+        return k.SkipBlanks;
+    } else if (kind == "ident") {
+        return k.SkipIdent;
+    } else if (kind == "comment") {
+        return k.FindStar;
+    }
+    return k.FindStrStop;
+}
+
+static void BM_Kernel(benchmark::State &state, const ScanKernels *k, std::string kind) {
+    auto input = MakeRun(kind, state.range(0));
+    auto kernel = Pick(*k, kind);
+    auto begin = input.data();
+    auto end = begin + input.size();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernel(begin, end));
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+// what ScanComment used to do: one bounds checked character at a time,
+// copying every byte into the token's string.
+static void BM_CommentCharLoop(benchmark::State &state) {
+    auto input = MakeRun("comment", state.range(0));
+    for (auto _ : state) {
+        size_t index = 0;
+        auto next = [&]() { return index < input.size() ? input[index++] : '\0'; };
+        std::string comment = "/*";
+        char c;
+        while ((c = next()) != '*' && c != '\0') {
+            comment.push_back(c);
+        }
+        benchmark::DoNotOptimize(comment);
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_CommentCharLoop)->Range(64, 64 << 10);
+
+// lex a source made of long comments and long identifiers end to end
+static void BM_LexCommentHeavy(benchmark::State &state) {
+    auto source = std::string();
+    while (source.size() < (1u << 20)) {
+        source += "/*" + MakeRun("comment", 400) + "\n";
+        source += "var " + MakeRun("ident", 40) + ":= \"" + MakeRun("string", 60) + "\n";
+    }
+    for (auto _ : state) {
+        auto symbols = SymbolPool();
+        auto lexer = Lexer(source, symbols);
+        benchmark::DoNotOptimize(lexer.GetAllTokens().size());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.SetLabel(ScanKernels::Get().name);
+}
+BENCHMARK(BM_LexCommentHeavy);
+
+int main(int argc, char **argv) {
+    for (auto k : ScanKernels::Available()) {
+        for (auto kind : {"blanks", "ident", "comment", "string"}) {
+            auto name = std::string("BM_Kernel/") + k->name + "/" + kind;
+            benchmark::RegisterBenchmark(name.c_str(), BM_Kernel, k, kind)->Range(8, 64 << 10);
+        }
+    }
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include "tiger/parser.h"
+#include "tiger/type_checker.h"
+#include "program_gen.h"
+#include "utils/source_buffer.h"
+
+#include <set>
+#include <sstream>
+
+// parse and check `source`, the type errors as `line:col: message`, and
+// the type of the program in `type`
+static std::vector<std::string> Check(const std::string &source, std::string *type = nullptr,
+                                      ThreadPool *pool = nullptr) {
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto diags = Diagnostics(source, "<input>");
+    auto ast = Parser(lexer, nodes, &diags).ParseResult();
+    EXPECT_FALSE(diags.HasErrors()) << source;
+
+    auto types = TypeContext();
+    auto result = TypeChecker(types, symbols, &diags, pool).Check(ast);
+    if (type != nullptr) {
+        *type = result->ToString();
+    }
+    auto messages = std::vector<std::string>();
+    for (auto &diag : diags.All()) {
+        auto [line, column] = diags.Lines().LineColumn(diag.loc);
+        messages.push_back(std::to_string(line) + ":" + std::to_string(column) + ": " + diag.message);
+    }
+    return messages;
+}
+
+static std::string Join(const std::vector<std::string> &messages) {
+    auto out = std::string();
+    for (auto &m : messages) {
+        out += m + "\n";
+    }
+    return out;
+}
+
+// the test suite of the tiger book, the comment on top of each file says
+// if it is wrong; test49 is a syntax error
+TEST(TestTypeChecker, BookTestCases) {
+    auto wrong = std::set<int> {9, 10, 11, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26,
+                                28, 29, 31, 32, 33, 34, 35, 36, 38, 39, 40, 43, 45};
+    auto files = std::vector<std::pair<std::string, bool>> {{"queens.tig", false}, {"merge.tig", false}};
+    for (int i = 1; i < 49; ++i) {
+        files.emplace_back("test" + std::to_string(i) + ".tig", wrong.count(i) != 0);
+    }
+    for (auto &[name, is_wrong] : files) {
+        auto source = SourceBuffer::FromFile(std::string(TESTCASES_DIR) + name);
+        auto messages = Check(std::string(source.View()));
+        if (is_wrong) {
+            EXPECT_FALSE(messages.empty()) << name;
+        } else {
+            EXPECT_TRUE(messages.empty()) << name << "\n" << Join(messages);
+        }
+    }
+}
+
+TEST(TestTypeChecker, ReportsAndGoesOn) {
+    auto messages = Check(
+            "let\n"
+            "  type rec = {a: int, b: string}\n"
+            "  var r := rec {a = 1, b = 2}\n"
+            "  var n := nil\n"
+            "  function f(x: int): int = x + \"s\"\n"
+            "in\n"
+            "  r.c := 1;\n"
+            "  g(1);\n"
+            "  f(1, 2);\n"
+            "  for i := 0 to 3 do i := 1;\n"
+            "  if 1 then 2;\n"
+            "  break;\n"
+            "  r.a := undeclared + 1\n"
+            "end\n");
+    auto expected = std::vector<std::string> {
+        "3:28: field `b` should be string, not int",
+        "4:12: the type of `n` must be declared, nil has no type of its own",
+        "5:33: the operands of `+` should be int, not string",
+        "7:5: rec has no field `c`",
+        "8:3: undeclared function `g`",
+        "9:3: `f` takes 1 arguments but 2 were given",
+        "10:22: cannot assign to the loop index `i`",
+        "11:13: an `if` without `else` should be void, not int",
+        "12:3: `break` outside of a loop",
+        "13:10: undeclared variable `undeclared`",
+    };
+    ASSERT_EQ(messages, expected);
+}
+
+TEST(TestTypeChecker, RecursiveTypesAndFunctions) {
+    auto type = std::string();
+    auto messages = Check(
+            "let\n"
+            "  type list = {head: int, tail: list}\n"
+            "  type tree = {key: int, children: forest}\n"
+            "  type forest = array of tree\n"
+            "  type alias = forest\n"
+            "  function depth(t: tree): int =\n"
+            "    if t = nil then 0 else 1 + widest(t.children, size(\"x\"))\n"
+            "  function widest(f: alias, n: int): int = depth(f[n - 1])\n"
+            "  var l := list {head = 1, tail = list {head = 2, tail = nil}}\n"
+            "in\n"
+            "  l.tail.tail.head;\n"
+            "  l\n"
+            "end\n", &type);
+    ASSERT_TRUE(messages.empty()) << Join(messages);
+    ASSERT_EQ(type, "list");
+
+    messages = Check(
+            "let\n"
+            "  type a = b\n"
+            "  type b = c\n"
+            "  type c = a\n"
+            "  type d = {x: int}\n"
+            "  var x: d := nil\n"
+            "  type e = {x: int}\n"
+            "in\n"
+            "  x := e {x = 1}\n"
+            "end\n");
+    auto expected = std::vector<std::string> {
+        "2:8: type `a` is an alias of itself",
+        "9:8: the value assigned should be d, not e",
+    };
+    ASSERT_EQ(messages, expected);
+}
+
+TEST(TestTypeChecker, TypeGroups) {
+    // a long chain of aliases, each naming the next, and a record whose
+    // fields are given through it
+    auto source = std::string("let\n  type top = {a: t0, b: t1999}\n");
+    for (int i = 0; i < 2000; ++i) {
+        source += "  type t" + std::to_string(i) + " = t" + std::to_string(i + 1) + "\n";
+    }
+    source += "  type t2000 = top\nin\n  top {a = nil, b = nil}\nend\n";
+    auto type = std::string();
+    auto messages = Check(source, &type);
+    ASSERT_TRUE(messages.empty()) << Join(messages);
+    ASSERT_EQ(type, "top");
+
+    // aliases leading into a cycle are errors, the cycle is reported once
+    // at its first name; a subclass may come before its parent
+    messages = Check(
+            "let\n"
+            "  type a = b\n"
+            "  type b = c\n"
+            "  type c = d\n"
+            "  type d = c\n"
+            "  type e = a\n"
+            "  type Square = class extends Shape { method area(): int = self.side }\n"
+            "  type Shape = class { var side := 1 }\n"
+            "  type P = class extends Q {}\n"
+            "  type Q = class extends P {}\n"
+            "  var s := new Square\n"
+            "in\n"
+            "  s.side + s.area()\n"
+            "end\n");
+    auto expected = std::vector<std::string> {
+        "4:8: type `c` is an alias of itself",
+        "10:26: class Q inherits from itself",
+    };
+    ASSERT_EQ(messages, expected);
+}
+
+TEST(TestTypeChecker, Classes) {
+    auto messages = Check(
+            "let\n"
+            "  class Shape extends Object (\n"
+            "    var sides := 0\n"
+            "    method area(): int = 0\n"
+            "    method grow(by: int) = self.sides := self.sides + by\n"
+            "  )\n"
+            "  type Square = class extends Shape {\n"
+            "    var side := 2\n"
+            "    method area(): int = self.side * self.side\n"
+            "  }\n"
+            "  var s: Shape := new Square\n"
+            "  var q := new Square\n"
+            "in\n"
+            "  s.grow(1);\n"
+            "  q.side + q.sides + s.area()\n"
+            "end\n");
+    ASSERT_TRUE(messages.empty()) << Join(messages);
+
+    messages = Check(
+            "let\n"
+            "  class A (\n"
+            "    method m(x: int): int = x\n"
+            "  )\n"
+            "  class B extends A (\n"
+            "    method m(x: string): int = 0\n"
+            "  )\n"
+            "  var a := new A\n"
+            "  var b: B := a\n"
+            "in\n"
+            "  a.n()\n"
+            "end\n");
+    auto expected = std::vector<std::string> {
+        "6:12: method `m` should have the type function(int): int of the method it overrides, "
+        "not function(string): int",
+        "9:15: the initial value of `b` should be B, not A",
+        "11:5: A has no method `n`",
+    };
+    ASSERT_EQ(messages, expected);
+}
+
+TEST(TestTypeChecker, TypesAreInterned) {
+    auto source = std::string(
+            "let\n"
+            "  type point = {x: int, y: int}\n"
+            "  type same = {x: int, y: int}\n"
+            "  function f(a: int, b: string): point = nil\n"
+            "  function g(c: int, d: string): point = nil\n"
+            "in\n"
+            "  f(1, \"a\")\n"
+            "end\n");
+    auto symbols = SymbolPool();
+    auto use_symbols = SymbolPool::Use(symbols);
+    auto nodes = Arena();
+    auto lexer = Lexer(source, symbols);
+    auto diags = Diagnostics(source, "<input>");
+    auto ast = Parser(lexer, nodes, &diags).ParseResult();
+
+    // checking again gives the very same types, and makes no new one
+    auto types = TypeContext();
+    auto first = TypeChecker(types, symbols, &diags).Check(ast);
+    auto size = types.Size();
+    auto second = TypeChecker(types, symbols, &diags).Check(ast);
+    ASSERT_FALSE(diags.HasErrors());
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(types.Size(), size);
+    ASSERT_EQ(first->ToString(), "point");
+
+    // function types are structural, records are one per declaration
+    auto fn = types.Function({types.Int(), types.String()}, first);
+    ASSERT_EQ(types.Function({types.Int(), types.String()}, first), fn);
+    ASSERT_NE(types.Function({types.Int()}, first), fn);
+    ASSERT_EQ(types.Size(), size + 1);
+    auto point = types.Record(&source, symbols.Find("point"));
+    ASSERT_EQ(types.Record(&source, symbols.Find("point")), point);
+    ASSERT_NE(types.Record(&first, symbols.Find("point")), point);
+    ASSERT_FALSE(point->Accepts(types.Record(&first, symbols.Find("point"))));
+    ASSERT_TRUE(point->Accepts(types.Nil()));
+    ASSERT_TRUE(types.Object()->Accepts(types.Nil()));
+    ASSERT_FALSE(types.Int()->Accepts(types.Nil()));
+}
+
+TEST(TestTypeChecker, GeneratedProgramsCheck) {
+    auto shapes = std::vector<ProgramShape> {
+        {}, {0}, {20, 6, 3, 50, 50, 8}, {50, 3, 4, 10, 10, 2, 16}, {10, 1, 8, 0, 0, 3, 1},
+    };
+    for (auto &shape : shapes) {
+        auto source = GenerateProgram(shape);
+        auto type = std::string();
+        auto messages = Check(source, &type);
+        ASSERT_TRUE(messages.empty()) << Join(messages) << source;
+        ASSERT_EQ(type, "int");
+    }
+}
+
+// the bodies of a group checked on a pool report the same errors, in the
+// same order, as when checked one after the other
+TEST(TestTypeChecker, ParallelBodies) {
+    auto pool = ThreadPool(4);
+    auto source = std::string("let\n  type point = {x: int, y: int}\n");
+    for (int i = 0; i < 200; ++i) {
+        auto f = "f" + std::to_string(i);
+        if (i % 3 == 0) {
+            source += "  function " + f + "(p: point): int = p.z + " + std::to_string(i) + "\n";
+        } else if (i % 3 == 1) {
+            source += "  function " + f + "(n: int): string =\n"
+                      "    let type pair = {a: point, b: point}\n"
+                      "        function g(q: pair): int = q.a.x + n\n"
+                      "    in g(nil); n end\n";
+        } else {
+            source += "  function " + f + "(n: int): int = f" + std::to_string(i - 1) + "(n) + " + f + "(n - 1)\n";
+        }
+    }
+    source += "  class C (\n";
+    for (int i = 0; i < 50; ++i) {
+        source += "    method m" + std::to_string(i) + "(): int = self.m" + std::to_string(i + 1) + "()\n";
+    }
+    source += "  )\nin\n  0\nend\n";
+
+    auto serial = Check(source);
+    ASSERT_EQ(serial.size(), 67u + 67 + 66 + 1);
+    ASSERT_EQ(Check(source, nullptr, &pool), serial);
+
+    for (auto &shape : std::vector<ProgramShape> {{400, 3, 4, 10, 10, 9}, {300, 2, 3, 10, 10, 2, 8}}) {
+        auto type = std::string();
+        auto messages = Check(GenerateProgram(shape), &type, &pool);
+        ASSERT_TRUE(messages.empty()) << Join(messages);
+        ASSERT_EQ(type, "int");
+    }
+}